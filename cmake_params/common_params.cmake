@@ -4,6 +4,7 @@
 
 set(VULKAN_INCLUDE_DIR "C:/VulkanSDK/1.3.250.1/Include")
 set(VULKAN_LIB_DIR "C:/VulkanSDK/1.3.250.1/Lib")
+set(VULKAN_BIN_DIR "C:/VulkanSDK/1.3.250.1/Bin")
 set(GLFW_INCLUDE_DIR "D:/BinaryLibs/glfw-3.3.8.bin.WIN64/include")
 set(GLFW_LIB_DIR "D:/BinaryLibs/glfw-3.3.8.bin.WIN64/lib-vc2022")
 set(GLM_INCLUDE_DIR "D:/BinaryLibs/glm")
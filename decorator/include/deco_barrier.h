@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace Deco
+{
+	// Pipeline barrier helpers. The general forms take the stages and access masks explicitly, the
+	// named ones cover the hazards compute work runs into every frame.
+	class DecoBarrier
+	{
+	public:
+		static void memory(
+			VkCommandBuffer command_buffer,
+			VkPipelineStageFlags src_stage,
+			VkAccessFlags src_access,
+			VkPipelineStageFlags dst_stage,
+			VkAccessFlags dst_access);
+
+		static void buffer(
+			VkCommandBuffer command_buffer,
+			VkBuffer buffer,
+			VkPipelineStageFlags src_stage,
+			VkAccessFlags src_access,
+			VkPipelineStageFlags dst_stage,
+			VkAccessFlags dst_access,
+			VkDeviceSize size = VK_WHOLE_SIZE,
+			VkDeviceSize offset = 0);
+
+		// layout transition of mip levels [base_mip, base_mip + level_count) of every layer
+		static void image(
+			VkCommandBuffer command_buffer,
+			VkImage image,
+			VkImageAspectFlags aspect,
+			VkImageLayout old_layout,
+			VkImageLayout new_layout,
+			VkPipelineStageFlags src_stage,
+			VkAccessFlags src_access,
+			VkPipelineStageFlags dst_stage,
+			VkAccessFlags dst_access,
+			uint32_t base_mip = 0,
+			uint32_t level_count = VK_REMAINING_MIP_LEVELS);
+
+		// storage writes of a dispatch read by the next dispatch
+		static void computeToCompute(VkCommandBuffer command_buffer);
+		// like computeToCompute, and the writes may also be dispatch arguments of vkCmdDispatchIndirect
+		static void computeToIndirectCompute(VkCommandBuffer command_buffer);
+		// storage writes of dispatches consumed by later draws: indirect arguments, vertex and index
+		// data, and shader reads in any graphics stage
+		static void computeToGraphics(VkCommandBuffer command_buffer);
+	};
+}
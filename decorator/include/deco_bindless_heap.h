@@ -0,0 +1,77 @@
+#pragma once
+
+#include "deco_descriptors.h"
+#include "deco_device.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Deco
+{
+	// One descriptor set holding large arrays of storage buffers and combined image samplers, bound
+	// once per frame at SET_INDEX. Resources get a stable slot that shaders index with a value from a
+	// push constant, so draws neither allocate nor bind descriptor sets of their own.
+	// Needs DecoDevice::supportsBindless().
+	class DecoBindlessHeap
+	{
+	public:
+		static constexpr uint32_t SET_INDEX = 1;
+		static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+		// last binding, its size is the variable descriptor count of the set
+		static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+		static constexpr uint32_t INVALID_SLOT = ~0u;
+
+		// other_set_resources is the descriptor count of the sets bound alongside the heap, they share the
+		// per stage resource limit with it; both counts are capped by the device's update-after-bind limits
+		DecoBindlessHeap(DecoDevice& device, uint32_t other_set_resources, uint32_t max_storage_buffers = 4096, uint32_t max_sampled_images = 4096);
+
+		DecoBindlessHeap(const DecoBindlessHeap&) = delete;
+		DecoBindlessHeap& operator=(const DecoBindlessHeap&) = delete;
+
+		// throw once every slot is taken
+		uint32_t addStorageBuffer(const VkDescriptorBufferInfo& buffer_info);
+		uint32_t addSampledImage(const VkDescriptorImageInfo& image_info);
+
+		// repoints a slot, frames still in flight must not index it any more
+		void updateStorageBuffer(uint32_t slot, const VkDescriptorBufferInfo& buffer_info);
+		void updateSampledImage(uint32_t slot, const VkDescriptorImageInfo& image_info);
+
+		// the slot is handed out again once the frames that may still index it have finished
+		void releaseStorageBuffer(uint32_t slot);
+		void releaseSampledImage(uint32_t slot);
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return m_set_layout->getDescriptorSetLayout(); }
+		VkDescriptorSet getDescriptorSet() const { return m_descriptor_set; }
+		uint32_t getStorageBufferCapacity() const { return m_storage_buffer_slots->m_capacity; }
+		uint32_t getSampledImageCapacity() const { return m_sampled_image_slots->m_capacity; }
+
+	private:
+		struct SlotAllocator
+		{
+			std::mutex m_mutex;
+			uint32_t m_capacity{ 0 };
+			uint32_t m_next{ 0 };
+			std::vector<uint32_t> m_free;
+
+			uint32_t allocate();
+			void free(uint32_t slot);
+		};
+
+		void write(uint32_t binding, uint32_t slot, const VkDescriptorBufferInfo* buffer_info, const VkDescriptorImageInfo* image_info);
+		void release(const std::shared_ptr<SlotAllocator>& slots, uint32_t slot);
+
+	private:
+		DecoDevice& m_deco_device;
+
+		std::unique_ptr<DecoDescriptorSetLayout> m_set_layout;
+		std::unique_ptr<DecoDescriptorPool> m_pool;
+		VkDescriptorSet m_descriptor_set{ VK_NULL_HANDLE };
+		// descriptor set updates are externally synchronized
+		std::mutex m_write_mutex;
+
+		// shared with the deletion queue entries that hand released slots back
+		std::shared_ptr<SlotAllocator> m_storage_buffer_slots;
+		std::shared_ptr<SlotAllocator> m_sampled_image_slots;
+	};
+}
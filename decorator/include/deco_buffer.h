@@ -2,6 +2,10 @@
 
 #include "deco_device.h"
 
+// std
+#include <utility>
+#include <vector>
+
 namespace Deco {
 
 	class DecoBuffer {
@@ -13,15 +17,33 @@ namespace Deco {
 			VkBufferUsageFlags usageFlags,
 			VkMemoryPropertyFlags memoryPropertyFlags,
 			VkDeviceSize minOffsetAlignment = 1);
+		// memory from the first candidate the device has, getMemoryPropertyFlags reports what it got
+		DecoBuffer(
+			DecoDevice& device,
+			VkDeviceSize instanceSize,
+			uint32_t instanceCount,
+			VkBufferUsageFlags usageFlags,
+			const std::vector<VkMemoryPropertyFlags>& memoryCandidates,
+			VkDeviceSize minOffsetAlignment = 1);
 		~DecoBuffer();
 
+		// for buffers the CPU rewrites every frame and keeps mapped: device local and host visible
+		// (resizable BAR) first, then host coherent, then plain host visible with flushed dirty ranges.
+		// Write such memory sequentially and never read it back, it is usually write-combined.
+		static std::vector<VkMemoryPropertyFlags> uploadMemoryCandidates();
+
 		DecoBuffer(const DecoBuffer&) = delete;
 		DecoBuffer& operator=(const DecoBuffer&) = delete;
+		// moving transfers ownership of the vulkan handles, the source is left empty
+		DecoBuffer(DecoBuffer&& other) noexcept;
+		DecoBuffer& operator=(DecoBuffer&& other) noexcept;
 
 		VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		void unmap();
 
+		// also marks the range dirty
 		void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+		// ranges are widened to nonCoherentAtomSize, a no-op on coherent memory
 		VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
@@ -31,19 +53,33 @@ namespace Deco {
 		VkDescriptorBufferInfo descriptorInfoForIndex(int index);
 		VkResult invalidateIndex(int index);
 
+		// for writes made through getMappedMemory; the ranges are flushed by flushDirty or a DecoUploadBatch
+		void markDirty(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+		// appends the dirty ranges, aligned to nonCoherentAtomSize and merged, and forgets them
+		void collectDirtyRanges(std::vector<VkMappedMemoryRange>& ranges);
+		// flushes every dirty range in one call
+		VkResult flushDirty();
+		bool isCoherent() const { return (m_memory_property_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0; }
+
 		VkBuffer getBuffer() const { return buffer; }
 		void* getMappedMemory() const { return mapped; }
 		uint32_t getInstanceCount() const { return m_instance_count; }
 		VkDeviceSize getInstanceSize() const { return m_instance_size; }
-		VkDeviceSize getAlignmentSize() const { return m_instance_size; }
+		VkDeviceSize getAlignmentSize() const { return m_alignment_size; }
 		VkBufferUsageFlags getUsageFlags() const { return m_usage_flags; }
 		VkMemoryPropertyFlags getMemoryPropertyFlags() const { return m_memory_property_flags; }
 		VkDeviceSize getBufferSize() const { return m_buffer_size; }
 
-	private:
+		// rounds instanceSize up to a multiple of minOffsetAlignment (a power of two)
 		static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
 
-		DecoDevice& m_device;
+	private:
+		void release();
+		// offset rounded down and size rounded up to nonCoherentAtomSize, VK_WHOLE_SIZE past the end
+		VkMappedMemoryRange alignedRange(VkDeviceSize size, VkDeviceSize offset) const;
+
+		// non-owning, a pointer so the buffer stays move assignable
+		DecoDevice* m_device;
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
 		VkDeviceMemory memory = VK_NULL_HANDLE;
@@ -54,6 +90,8 @@ namespace Deco {
 		VkDeviceSize m_alignment_size;
 		VkBufferUsageFlags m_usage_flags;
 		VkMemoryPropertyFlags m_memory_property_flags;
+		// [begin, end) byte ranges written since the last flush, only kept for non-coherent memory
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> dirtyRanges;
 	};
 
 }  // namespace Deco
\ No newline at end of file
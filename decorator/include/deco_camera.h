@@ -4,6 +4,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
+
 namespace Deco
 {
 	class DecoCamera
@@ -18,9 +20,17 @@ namespace Deco
 
 		const glm::mat4 getProjection() const { return m_projection_matrix; }
 		const glm::mat4 getView() const { return m_view_matrix; }
+		float getNearClip() const { return m_near; }
+		float getFarClip() const { return m_far; }
+
+		// world space corners of the perspective frustum between view depths near and far, the four on
+		// the near plane first; e.g. one shadow cascade's slice of the view
+		std::array<glm::vec3, 8> getFrustumCorners(float near, float far) const;
 
 	private:
 		glm::mat4 m_projection_matrix{ 1.0f };
 		glm::mat4 m_view_matrix{ 1.0f };
+		float m_near{ 0.0f };
+		float m_far{ 1.0f };
 	};
 }
\ No newline at end of file
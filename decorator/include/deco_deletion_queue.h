@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Deco
+{
+	// Defers destruction of GPU objects until the frames that may still reference them have
+	// finished. Every entry is tagged with the frame being recorded when it was released and is
+	// destroyed once the renderer reports that frame's in-flight fence as signaled.
+	class DecoDeletionQueue
+	{
+	public:
+		DecoDeletionQueue() = default;
+		~DecoDeletionQueue();
+
+		DecoDeletionQueue(const DecoDeletionQueue&) = delete;
+		DecoDeletionQueue& operator=(const DecoDeletionQueue&) = delete;
+
+		// deleter runs on the thread that calls collect()/flush(), may be called from any thread
+		void push(std::function<void()> deleter);
+
+		// keeps the last reference alive until the GPU is done with it (DecoBuffer, DecoModel, ...)
+		template <typename T>
+		void release(std::shared_ptr<T> resource)
+		{
+			if (resource)
+			{
+				push([resource]() mutable { resource.reset(); });
+			}
+		}
+
+		template <typename T>
+		void release(std::unique_ptr<T> resource)
+		{
+			release(std::shared_ptr<T>(std::move(resource)));
+		}
+
+		// frame number new releases are tagged with
+		void setCurrentFrame(uint64_t frame_number);
+		uint64_t getCurrentFrame() const;
+
+		// destroys every entry tagged with a frame < completed_frame_count
+		void collect(uint64_t completed_frame_count);
+
+		// destroys everything, the caller must know the device is idle
+		void flush();
+
+		size_t size() const;
+
+	private:
+		struct Entry
+		{
+			uint64_t m_frame;
+			std::function<void()> m_deleter;
+		};
+
+		mutable std::mutex m_mutex;
+		std::deque<Entry> m_entries;
+		uint64_t m_current_frame{ 0 };
+	};
+}
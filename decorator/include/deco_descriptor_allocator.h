@@ -0,0 +1,74 @@
+#pragma once
+
+#include "deco_device.h"
+
+#include <mutex>
+#include <vector>
+
+namespace Deco
+{
+	// descriptors of one type per set in a pool, e.g. { UNIFORM_BUFFER, 2.0f } sizes a pool of N sets
+	// with 2N uniform buffers
+	struct DecoDescriptorPoolRatio
+	{
+		VkDescriptorType m_type;
+		float m_ratio;
+	};
+
+	// Hands out descriptor sets without fixed pool sizes. Pools are created from per-type ratios and
+	// a new, larger one is added whenever the current one reports VK_ERROR_OUT_OF_POOL_MEMORY or
+	// VK_ERROR_FRAGMENTED_POOL. Persistent sets live as long as the allocator; transient sets come
+	// from per-frame pools that resetFrame recycles in bulk.
+	class DecoDescriptorAllocator
+	{
+	public:
+		static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+		DecoDescriptorAllocator(
+			DecoDevice& device,
+			uint32_t frames_in_flight,
+			uint32_t initial_sets_per_pool = 64,
+			const std::vector<DecoDescriptorPoolRatio>& ratios = defaultRatios());
+		~DecoDescriptorAllocator();
+
+		DecoDescriptorAllocator(const DecoDescriptorAllocator&) = delete;
+		DecoDescriptorAllocator& operator=(const DecoDescriptorAllocator&) = delete;
+
+		static std::vector<DecoDescriptorPoolRatio> defaultRatios();
+
+		// both throw on errors other than an exhausted pool; safe to call from any thread
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, uint32_t variable_descriptor_count = 0);
+		// valid until resetFrame is called for the same frame index
+		VkDescriptorSet allocateTransient(uint32_t frame_index, VkDescriptorSetLayout layout, uint32_t variable_descriptor_count = 0);
+
+		// once the frame's in-flight fence has signaled: resets every transient pool of that frame
+		void resetFrame(uint32_t frame_index);
+
+		size_t getPoolCount() const;
+
+	private:
+		struct PoolList
+		{
+			// the last pool is the one being allocated from
+			std::vector<VkDescriptorPool> m_pools;
+		};
+
+		VkDescriptorSet allocateFrom(PoolList& pools, VkDescriptorSetLayout layout, uint32_t variable_descriptor_count);
+		// a reset spare if there is one, otherwise a new pool
+		VkDescriptorPool acquirePool();
+		VkDescriptorPool createPool(uint32_t set_count);
+
+	private:
+		DecoDevice& m_deco_device;
+		std::vector<DecoDescriptorPoolRatio> m_ratios;
+
+		mutable std::mutex m_mutex;
+		PoolList m_persistent;
+		std::vector<PoolList> m_transient;
+		// reset transient pools, ready to be handed out again
+		std::vector<VkDescriptorPool> m_spare_pools;
+		// grows by half with every new pool, capped by MAX_SETS_PER_POOL
+		uint32_t m_sets_per_pool;
+		size_t m_pool_count{ 0 };
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "deco_descriptor_allocator.h"
 #include "deco_device.h"
 
 // std
@@ -15,25 +16,36 @@ namespace Deco {
 		public:
 			Builder(Deco::DecoDevice& deco_device) : m_deco_device{ deco_device } {}
 
+			// bindingFlags (PARTIALLY_BOUND, UPDATE_AFTER_BIND, ...) need descriptor indexing, see
+			// DecoDevice::supportsBindless
 			Builder& addBinding(
 				uint32_t binding,
 				VkDescriptorType descriptorType,
 				VkShaderStageFlags stageFlags,
-				uint32_t count = 1);
+				uint32_t count = 1,
+				VkDescriptorBindingFlags bindingFlags = 0);
+			Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
 			std::unique_ptr<DecoDescriptorSetLayout> build() const;
 
 		private:
 			Deco::DecoDevice& m_deco_device;
 			std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+			std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+			VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
 		};
 
+		// the handle comes from the device's layout cache, identical layouts share it
 		DecoDescriptorSetLayout(
-			DecoDevice& deco_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
-		~DecoDescriptorSetLayout();
+			DecoDevice& deco_device,
+			std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+			const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+			VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
 		DecoDescriptorSetLayout(const DecoDescriptorSetLayout&) = delete;
 		DecoDescriptorSetLayout& operator=(const DecoDescriptorSetLayout&) = delete;
 
 		VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+		// descriptors across all bindings, what a bound set counts against the per stage limits
+		uint32_t getDescriptorCount() const;
 
 	private:
 		DecoDevice& m_deco_device;
@@ -41,6 +53,7 @@ namespace Deco {
 		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
 
 		friend class DecoDescriptorWriter;
+		friend class DecoDescriptorUpdateTemplate;
 	};
 
 	class DecoDescriptorPool {
@@ -70,8 +83,11 @@ namespace Deco {
 		DecoDescriptorPool(const DecoDescriptorPool&) = delete;
 		DecoDescriptorPool& operator=(const DecoDescriptorPool&) = delete;
 
+		// variableDescriptorCount sizes the layout's VARIABLE_DESCRIPTOR_COUNT binding, 0 if it has none
 		bool allocateDescriptor(
-			const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+			const VkDescriptorSetLayout descriptorSetLayout,
+			VkDescriptorSet& descriptor,
+			uint32_t variableDescriptorCount = 0) const;
 
 		void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
 
@@ -84,20 +100,110 @@ namespace Deco {
 		friend class DecoDescriptorWriter;
 	};
 
+	class DecoDescriptorBatchWriter;
+
 	class DecoDescriptorWriter {
 	public:
 		DecoDescriptorWriter(DecoDescriptorSetLayout& setLayout, DecoDescriptorPool& pool);
+		// build() takes a persistent set from the allocator, it never runs out
+		DecoDescriptorWriter(DecoDescriptorSetLayout& setLayout, DecoDescriptorAllocator& allocator);
 
 		DecoDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
 		DecoDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
 
 		bool build(VkDescriptorSet& set);
 		void overwrite(VkDescriptorSet& set);
+		// like build/overwrite, but the writes are queued on batch and applied by its submit()
+		bool build(VkDescriptorSet& set, DecoDescriptorBatchWriter& batch);
+		void overwrite(VkDescriptorSet set, DecoDescriptorBatchWriter& batch) const;
 
 	private:
 		DecoDescriptorSetLayout& setLayout;
-		DecoDescriptorPool& pool;
+		// exactly one of the two is set
+		DecoDescriptorPool* pool = nullptr;
+		DecoDescriptorAllocator* allocator = nullptr;
+		std::vector<VkWriteDescriptorSet> writes;
+	};
+
+	// Collects writes for any number of sets and applies them with a single vkUpdateDescriptorSets.
+	// Descriptor infos are copied, so they may be temporaries. Meant for bulk work such as creating
+	// or hot reloading thousands of material sets.
+	class DecoDescriptorBatchWriter {
+	public:
+		DecoDescriptorBatchWriter(DecoDevice& deco_device) : m_deco_device{ deco_device } {}
+		DecoDescriptorBatchWriter(const DecoDescriptorBatchWriter&) = delete;
+		DecoDescriptorBatchWriter& operator=(const DecoDescriptorBatchWriter&) = delete;
+
+		DecoDescriptorBatchWriter& writeBuffer(
+			VkDescriptorSet set,
+			uint32_t binding,
+			VkDescriptorType descriptorType,
+			const VkDescriptorBufferInfo& bufferInfo,
+			uint32_t arrayElement = 0);
+		DecoDescriptorBatchWriter& writeImage(
+			VkDescriptorSet set,
+			uint32_t binding,
+			VkDescriptorType descriptorType,
+			const VkDescriptorImageInfo& imageInfo,
+			uint32_t arrayElement = 0);
+
+		size_t size() const { return writes.size(); }
+		// applies everything queued so far and starts a new batch
+		void submit();
+
+	private:
+		// the info vectors may reallocate while writes are queued, the pointers are resolved in submit
+		struct InfoRef {
+			bool isImage;
+			size_t index;
+		};
+
+		DecoDevice& m_deco_device;
 		std::vector<VkWriteDescriptorSet> writes;
+		std::vector<InfoRef> infoRefs;
+		std::vector<VkDescriptorBufferInfo> bufferInfos;
+		std::vector<VkDescriptorImageInfo> imageInfos;
+	};
+
+	// Writes a fixed group of bindings of one layout from a packed struct with a single call, e.g.
+	// re-pointing a per-frame set at that frame's buffers. Every entry reads its descriptors
+	// (VkDescriptorBufferInfo, VkDescriptorImageInfo or VkBufferView, by binding type) at offset,
+	// stride bytes apart. Uses a VkDescriptorUpdateTemplate when the device supports one, otherwise
+	// the same entries go through one vkUpdateDescriptorSets call.
+	class DecoDescriptorUpdateTemplate {
+	public:
+		class Builder {
+		public:
+			Builder(DecoDevice& deco_device, DecoDescriptorSetLayout& setLayout)
+				: m_deco_device{ deco_device }, setLayout{ setLayout } {}
+
+			// stride 0 means tightly packed infos
+			Builder& addEntry(uint32_t binding, size_t offset, uint32_t count = 1, size_t stride = 0);
+			std::unique_ptr<DecoDescriptorUpdateTemplate> build() const;
+
+		private:
+			DecoDevice& m_deco_device;
+			DecoDescriptorSetLayout& setLayout;
+			std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+		};
+
+		DecoDescriptorUpdateTemplate(
+			DecoDevice& deco_device,
+			DecoDescriptorSetLayout& setLayout,
+			const std::vector<VkDescriptorUpdateTemplateEntry>& entries);
+		~DecoDescriptorUpdateTemplate();
+		DecoDescriptorUpdateTemplate(const DecoDescriptorUpdateTemplate&) = delete;
+		DecoDescriptorUpdateTemplate& operator=(const DecoDescriptorUpdateTemplate&) = delete;
+
+		// set must not be in use by a pending command buffer
+		void update(VkDescriptorSet set, const void* data) const;
+
+		bool isTemplated() const { return updateTemplate != VK_NULL_HANDLE; }
+
+	private:
+		DecoDevice& m_deco_device;
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+		VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
 	};
 
 }  // namespace Deco
\ No newline at end of file
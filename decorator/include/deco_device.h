@@ -1,8 +1,14 @@
 #pragma once
 
+#include "deco_deletion_queue.h"
+#include "deco_layout_cache.h"
+#include "deco_memory_manager.h"
+#include "deco_sampler_cache.h"
 #include "deco_window.h"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -22,6 +28,8 @@ namespace Deco {
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
+	class DecoSingleTimeCommands;
+
 	class DecoDevice {
 	public:
 #ifdef NDEBUG
@@ -33,23 +41,57 @@ namespace Deco {
 		DecoDevice(DecoWindow& window);
 		~DecoDevice();
 
-		// Not copyable or movable
-		//DecoDevice(const DecoDevice&) = delete;
-		//DecoDevice& operator=(const DecoDevice&) = delete;
-		//DecoDevice(DecoDevice&&) = delete;
-		//DecoDevice& operator=(DecoDevice&&) = delete;
+		// Not copyable or movable, everything else holds a non-owning reference
+		DecoDevice(const DecoDevice&) = delete;
+		DecoDevice& operator=(const DecoDevice&) = delete;
+		DecoDevice(DecoDevice&&) = delete;
+		DecoDevice& operator=(DecoDevice&&) = delete;
 
 		VkCommandPool getCommandPool() { return commandPool; }
 		VkDevice device() { return device_; }
+		VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
 
+		// queues are externally synchronized, hold this around every submit/present/wait idle
+		std::unique_lock<std::mutex> lockQueues() { return std::unique_lock<std::mutex>(queueMutex); }
+		void waitIdle();
+
+		// objects released here are destroyed once the frames that used them have finished
+		DecoDeletionQueue& getDeletionQueue() { return deletionQueue; }
+
+		// shared descriptor set and pipeline layouts, destroyed with the device
+		DecoLayoutCache& getLayoutCache() { return *layoutCache; }
+		// every VkDeviceMemory goes through it, printReport shows the per heap budget
+		DecoMemoryManager& getMemoryManager() { return *memoryManager; }
+		// shared samplers, destroyed with the device
+		DecoSamplerCache& getSamplerCache() { return *samplerCache; }
+
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+		// Vulkan 1.3 core or VK_KHR_dynamic_rendering, enabled on the device whenever available
+		bool supportsDynamicRendering() const { return dynamicRenderingSupported; }
+		void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo);
+		void cmdEndRendering(VkCommandBuffer commandBuffer);
+		// Vulkan 1.2 descriptor indexing: runtime sized, partially bound, update-after-bind arrays
+		bool supportsBindless() const { return descriptorIndexingSupported; }
+		const VkPhysicalDeviceDescriptorIndexingProperties& getDescriptorIndexingProperties() const {
+			return descriptorIndexingProperties;
+		}
+		// BC1-BC7 block compressed images, enabled on the device whenever available (all desktop GPUs)
+		bool supportsTextureCompressionBC() const { return textureCompressionBCSupported; }
+		// Vulkan 1.1 descriptor update templates, DecoDescriptorUpdateTemplate falls back without them
+		bool supportsDescriptorUpdateTemplates() const {
+			return instanceApiVersion >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1;
+		}
+
+		// like findMemoryType, but reports a missing type instead of throwing
+		bool tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& memoryType);
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
 		VkFormat findSupportedFormat(
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+		VkFormatProperties getFormatProperties(VkFormat format);
 
 		// Buffer Helper Functions
 		void createBuffer(
@@ -57,9 +99,18 @@ namespace Deco {
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& bufferMemory);
-		VkCommandBuffer beginSingleTimeCommands();
-		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+			VkDeviceMemory& bufferMemory,
+			DecoMemoryCategory category = DecoMemoryCategory::Other);
+		// takes the first of candidates the memory manager can place, returns the chosen type's full flags
+		VkMemoryPropertyFlags createBuffer(
+			VkDeviceSize size,
+			VkBufferUsageFlags usage,
+			const std::vector<VkMemoryPropertyFlags>& candidates,
+			VkBuffer& buffer,
+			VkDeviceMemory& bufferMemory,
+			DecoMemoryCategory category = DecoMemoryCategory::Other);
+		// safe to call from worker threads, the returned commands hold singleTimeMutex until they are destroyed
+		DecoSingleTimeCommands beginSingleTimeCommands();
 		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 		void copyBufferToImage(
 			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -68,7 +119,8 @@ namespace Deco {
 			const VkImageCreateInfo& imageInfo,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
-			VkDeviceMemory& imageMemory);
+			VkDeviceMemory& imageMemory,
+			DecoMemoryCategory category = DecoMemoryCategory::Image);
 
 		VkPhysicalDeviceProperties properties;
 
@@ -79,6 +131,9 @@ namespace Deco {
 		void pickPhysicalDevice();
 		void createLogicalDevice();
 		void createCommandPool();
+		void queryDynamicRenderingSupport();
+		void queryDescriptorIndexingSupport();
+		void queryMemoryBudgetSupport();
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice device);
@@ -95,6 +150,16 @@ namespace Deco {
 		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 		DecoWindow& window;
 		VkCommandPool commandPool;
+		// separate pool so single time commands on a worker never touch the frame command pool
+		VkCommandPool singleTimeCommandPool;
+
+		std::mutex queueMutex;
+		std::mutex singleTimeMutex;
+
+		DecoDeletionQueue deletionQueue;
+		std::unique_ptr<DecoLayoutCache> layoutCache;
+		std::unique_ptr<DecoMemoryManager> memoryManager;
+		std::unique_ptr<DecoSamplerCache> samplerCache;
 
 		VkDevice device_;
 		VkSurfaceKHR surface_;
@@ -103,6 +168,41 @@ namespace Deco {
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+		// negotiated in createInstance, the device may support less (see properties.apiVersion)
+		uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+		bool dynamicRenderingSupported = false;
+		// pre 1.3 devices need the extension enabled and its entry points
+		bool dynamicRenderingExtension = false;
+		PFN_vkCmdBeginRenderingKHR beginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR endRendering = nullptr;
+		bool descriptorIndexingSupported = false;
+		VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+		bool memoryBudgetSupported = false;
+		bool textureCompressionBCSupported = false;
+
+		friend class DecoSingleTimeCommands;
+	};
+
+	// A one-off command buffer from the device's single time pool, recorded on any thread. submit()
+	// runs it and waits for it; the destructor frees it and unlocks the pool whether or not it was
+	// submitted, so a throw while recording cannot block later uploads.
+	class DecoSingleTimeCommands {
+	public:
+		explicit DecoSingleTimeCommands(DecoDevice& device);
+		~DecoSingleTimeCommands();
+
+		DecoSingleTimeCommands(const DecoSingleTimeCommands&) = delete;
+		DecoSingleTimeCommands& operator=(const DecoSingleTimeCommands&) = delete;
+
+		VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+		void submit();
+
+	private:
+		DecoDevice& device;
+		std::unique_lock<std::mutex> poolLock;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		bool submitted = false;
 	};
 
 }  // namespace Deco
\ No newline at end of file
@@ -2,12 +2,47 @@
 
 #include "deco_camera.h"
 #include "deco_game_object.h"
+#include "deco_gpu_profiler.h"
+#include "deco_render_queue.h"
+#include "deco_uniform_arena.h"
+#include "deco_upload_batch.h"
 
 // lib
 #include <vulkan/vulkan.h>
 
 namespace Deco
 {
+	// render queue layers, submitted in this order
+	enum RenderLayer : uint8_t
+	{
+		RENDER_LAYER_DEPTH_PREPASS = 0,
+		RENDER_LAYER_OPAQUE = 1,
+		RENDER_LAYER_LIGHTS = 2,
+		// additive, after everything that writes depth
+		RENDER_LAYER_PARTICLES = 3,
+	};
+
+	// cascades of the directional light's shadow map, SHADOW_CASCADE_COUNT in the shaders
+	constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+
+	// layout matches GlobalUbo in the shaders
+	struct GlobalUbo
+	{
+		glm::mat4 projection{ 1.0f };
+		glm::mat4 view{ 1.0f };
+		glm::vec4 ambinetLightColor{ 1.f, 1.f, 1.f, .02f }; // w is intensity
+		// x, y, z: light cluster grid size, w: point lights in the light buffer
+		glm::uvec4 cluster_grid{ 0 };
+		// x, y: cluster tile size in pixels, z, w: depth slice = log(view z) * z - w
+		glm::vec4 cluster_params{ 0.0f };
+		// xyz: direction the directional light travels in
+		glm::vec4 directional_light_direction{ 0.0f, 1.0f, 0.0f, 0.0f };
+		glm::vec4 directional_light_color{ 0.0f }; // w is intensity
+		// view depth each cascade ends at, no shadows past the last
+		glm::vec4 cascade_splits{ 0.0f };
+		glm::mat4 cascade_view_projections[SHADOW_CASCADE_COUNT]{};
+	};
+
 	struct FrameInfo
 	{
 		int frame_index;
@@ -16,5 +51,14 @@ namespace Deco
 		DecoCamera& camera;
 		VkDescriptorSet global_descriptor_set;
 		DecoGameObject::Map& game_objects;
+		// optional, systems wrap their passes in timestamp scopes when set
+		DecoGpuProfiler* gpu_profiler = nullptr;
+		// systems push their draws here, the frame sorts and submits them in one go
+		DecoRenderQueue* render_queue = nullptr;
+		// per-frame constants; global_descriptor_set reads GlobalUbo at global_ubo_offset, its dynamic offset
+		DecoUniformArena* uniform_arena = nullptr;
+		uint32_t global_ubo_offset = 0;
+		// buffers written through their mapping this frame go here, flushed together before submit
+		DecoUploadBatch* upload_batch = nullptr;
 	};
 }
\ No newline at end of file
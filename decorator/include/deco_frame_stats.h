@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Deco
+{
+	// Keeps the last WINDOW samples of one timing and their distribution over fixed millisecond buckets.
+	class DecoRollingHistogram
+	{
+	public:
+		static constexpr size_t WINDOW = 256;
+		// upper bucket edges in ms, the last bucket catches everything above
+		static constexpr std::array<double, 10> BUCKET_EDGES{ 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 66.7, 1.0e9 };
+
+		void add(double value_ms);
+
+		double average() const;
+		double max() const;
+		// p in [0, 1], computed over the current window
+		double percentile(double p) const;
+		size_t count() const { return m_count; }
+		const std::array<uint32_t, BUCKET_EDGES.size()>& buckets() const { return m_buckets; }
+
+	private:
+		static size_t bucketOf(double value_ms);
+
+		std::array<double, WINDOW> m_samples{};
+		std::array<uint32_t, BUCKET_EDGES.size()> m_buckets{};
+		size_t m_next{ 0 };
+		size_t m_count{ 0 };
+		double m_sum{ 0.0 };
+	};
+
+	// where one frame's wall time went, in milliseconds
+	struct DecoFrameTimings
+	{
+		double m_pace_ms{ 0.0 };        // frame limiter sleep/spin
+		double m_fence_wait_ms{ 0.0 };  // in-flight fences (frame slot and swap chain image)
+		double m_acquire_ms{ 0.0 };     // vkAcquireNextImageKHR
+		double m_record_ms{ 0.0 };      // CPU between beginFrame and endFrame
+		double m_submit_ms{ 0.0 };      // vkQueueSubmit
+		double m_present_ms{ 0.0 };     // vkQueuePresentKHR
+		double m_frame_ms{ 0.0 };       // begin of one frame to the begin of the next
+	};
+
+	enum class DecoFrameBound
+	{
+		Unknown,
+		Cpu,
+		Gpu,
+		VSync,
+		Paced,
+	};
+
+	const char* getFrameBoundName(DecoFrameBound bound);
+
+	class DecoFrameStats
+	{
+	public:
+		void addFrame(const DecoFrameTimings& timings);
+
+		// the largest average wait decides: fences mean the GPU is behind, acquire/present block
+		// on the display, the pacer on the limiter, and none of them means the CPU is the limit
+		DecoFrameBound classify() const;
+
+		const DecoRollingHistogram& pace() const { return m_pace; }
+		const DecoRollingHistogram& fenceWait() const { return m_fence_wait; }
+		const DecoRollingHistogram& acquire() const { return m_acquire; }
+		const DecoRollingHistogram& record() const { return m_record; }
+		const DecoRollingHistogram& submit() const { return m_submit; }
+		const DecoRollingHistogram& present() const { return m_present; }
+		const DecoRollingHistogram& frame() const { return m_frame; }
+
+		void print(std::ostream& out) const;
+
+	private:
+		DecoRollingHistogram m_pace;
+		DecoRollingHistogram m_fence_wait;
+		DecoRollingHistogram m_acquire;
+		DecoRollingHistogram m_record;
+		DecoRollingHistogram m_submit;
+		DecoRollingHistogram m_present;
+		DecoRollingHistogram m_frame;
+	};
+
+	// Holds frames to a fixed interval: sleeps until shortly before the deadline, then spins the rest
+	// because OS sleeps overshoot by up to a scheduler tick.
+	class DecoFramePacer
+	{
+	public:
+		// 0 disables the limiter
+		void setTargetFrameRate(double frames_per_second);
+		bool isEnabled() const { return m_interval.count() > 0; }
+
+		// returns the time spent waiting, in milliseconds
+		double wait();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr std::chrono::microseconds SPIN_THRESHOLD{ 1500 };
+
+		Clock::duration m_interval{ 0 };
+		Clock::time_point m_next_deadline{};
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace Deco
+{
+	// The six planes of a view projection's clip volume (Vulkan depth range 0..1), normals pointing
+	// inwards. Used to cull bounding spheres for the camera and for every shadow cascade alike.
+	class DecoFrustum
+	{
+	public:
+		enum Plane : uint32_t
+		{
+			PLANE_LEFT = 0,
+			PLANE_RIGHT,
+			PLANE_TOP,
+			PLANE_BOTTOM,
+			PLANE_NEAR,
+			PLANE_FAR,
+			PLANE_COUNT
+		};
+
+		DecoFrustum() = default;
+		explicit DecoFrustum(const glm::mat4& view_projection);
+
+		// sphere is xyz center and w radius; a plane outside test_planes (bit per Plane) never culls,
+		// e.g. shadow casters between the light and a cascade skip the near plane
+		bool intersectsSphere(const glm::vec4& sphere, uint32_t test_planes = (1u << PLANE_COUNT) - 1) const;
+
+		// a model space bounding sphere moved by model_matrix, the radius grows with the largest scale
+		static glm::vec4 transformSphere(const glm::mat4& model_matrix, const glm::vec4& sphere);
+
+	private:
+		// xyz unit normal, w distance: inside when dot(normal, p) + w >= 0
+		std::array<glm::vec4, PLANE_COUNT> m_planes{};
+	};
+}
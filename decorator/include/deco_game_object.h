@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deco_model.h"
+#include "deco_texture.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -21,6 +22,13 @@ namespace Deco
 		glm::mat3 normalMatrix();
 	};
 
+	struct PointLightComponent
+	{
+		float m_light_intensity = 1.0f;
+		// distance at which the light fades out completely, bounds the clusters it is binned into
+		float m_range = 1.0f;
+	};
+
 	class DecoGameObject
 	{
 	public:
@@ -38,13 +46,20 @@ namespace Deco
 			return DecoGameObject{ current_id++ };
 		}
 
+		static DecoGameObject makePointLight(float intensity = 1.0f, float range = 1.0f, glm::vec3 color = glm::vec3(1.0f));
+
 		GameObjectID getId() { return m_id; }
 
 	public:
 		std::shared_ptr<DecoModel> m_model{};
+		// sampled by the bindless shaders once ready, untextured until then
+		std::shared_ptr<DecoTexture> m_texture{};
 		glm::vec3 m_color{};
 		TransformComponent m_transform{};
 
+		// optional components
+		std::unique_ptr<PointLightComponent> m_point_light = nullptr;
+
 	private:
 		DecoGameObject(GameObjectID object_id) : m_id(object_id) {}
 
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "deco_device.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Deco
+{
+	// GPU timestamps around named scopes of a frame. Every frame slot owns its own range of queries,
+	// which are read back when the slot comes around again, so nothing ever waits on the GPU.
+	class DecoGpuProfiler
+	{
+	public:
+		static constexpr uint32_t MAX_SCOPES = 32;
+		static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+		DecoGpuProfiler(DecoDevice& device, uint32_t frames_in_flight);
+		~DecoGpuProfiler();
+
+		DecoGpuProfiler(const DecoGpuProfiler&) = delete;
+		DecoGpuProfiler& operator=(const DecoGpuProfiler&) = delete;
+
+		// false if the graphics queue has no timestamp support, all calls are no-ops then
+		bool isSupported() const { return m_query_pool != VK_NULL_HANDLE; }
+
+		// after vkBeginCommandBuffer, outside a render pass, once the slot's fence has signaled
+		void beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+
+		uint32_t beginScope(VkCommandBuffer command_buffer, const char* name);
+		void endScope(VkCommandBuffer command_buffer, uint32_t scope);
+
+		// (name, milliseconds) averaged over roughly the last 64 frames, in first-seen order
+		const std::vector<std::pair<std::string, double>>& getScopeTimes() const { return m_scope_times; }
+		void print(std::ostream& out) const;
+
+	private:
+		void collectResults(uint32_t frame_index);
+		uint32_t firstQuery(uint32_t frame_index) const { return frame_index * MAX_SCOPES * 2; }
+
+	private:
+		DecoDevice& m_deco_device;
+		VkQueryPool m_query_pool{ VK_NULL_HANDLE };
+		uint64_t m_timestamp_mask{ 0 };
+		double m_timestamp_period_ns{ 1.0 };
+
+		uint32_t m_frame_index{ 0 };
+		// scope names recorded into each slot's command buffer, still waiting for results
+		std::vector<std::vector<std::string>> m_slot_scopes;
+		std::vector<std::pair<std::string, double>> m_scope_times;
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Deco
+{
+	// Device-wide owner of descriptor set layouts and pipeline layouts. Layouts are keyed by their
+	// canonical description (bindings sorted by binding number, push constant ranges sorted by offset),
+	// so identical requests share one handle. Shared set layouts also make pipeline layouts that use
+	// them compatible for descriptor set binding across systems. Handles live as long as the device.
+	class DecoLayoutCache
+	{
+	public:
+		DecoLayoutCache(VkDevice device) : m_device(device) {}
+		~DecoLayoutCache();
+
+		DecoLayoutCache(const DecoLayoutCache&) = delete;
+		DecoLayoutCache& operator=(const DecoLayoutCache&) = delete;
+
+		// binding_flags is empty or parallel to bindings; immutable samplers are not supported
+		VkDescriptorSetLayout getDescriptorSetLayout(
+			const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+			VkDescriptorSetLayoutCreateFlags flags = 0,
+			const std::vector<VkDescriptorBindingFlags>& binding_flags = {});
+
+		VkPipelineLayout getPipelineLayout(
+			const std::vector<VkDescriptorSetLayout>& set_layouts,
+			const std::vector<VkPushConstantRange>& push_constant_ranges = {});
+
+		size_t getDescriptorSetLayoutCount() const;
+		size_t getPipelineLayoutCount() const;
+
+	private:
+		struct SetLayoutKey
+		{
+			// sorted by binding, m_binding_flags parallel to it
+			std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+			std::vector<VkDescriptorBindingFlags> m_binding_flags;
+			VkDescriptorSetLayoutCreateFlags m_flags;
+
+			bool operator==(const SetLayoutKey& other) const;
+		};
+
+		struct PipelineLayoutKey
+		{
+			std::vector<VkDescriptorSetLayout> m_set_layouts;
+			// sorted by offset, then stages
+			std::vector<VkPushConstantRange> m_push_constant_ranges;
+
+			bool operator==(const PipelineLayoutKey& other) const;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const SetLayoutKey& key) const;
+			size_t operator()(const PipelineLayoutKey& key) const;
+		};
+
+	private:
+		VkDevice m_device;
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, KeyHash> m_set_layouts;
+		std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> m_pipeline_layouts;
+	};
+}
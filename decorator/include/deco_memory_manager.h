@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace Deco
+{
+	// what an allocation is for, only used for reporting
+	enum class DecoMemoryCategory
+	{
+		Mesh,
+		Uniform,
+		Storage,
+		Depth,
+		Image,
+		Staging,
+		Other,
+		Count
+	};
+
+	const char* getMemoryCategoryName(DecoMemoryCategory category);
+
+	struct DecoMemoryHeapBudget
+	{
+		VkDeviceSize m_size{ 0 };
+		VkMemoryHeapFlags m_flags{ 0 };
+		// VK_EXT_memory_budget's numbers (every process on the GPU) when available, otherwise 80% of the
+		// heap and what this device allocated
+		VkDeviceSize m_budget{ 0 };
+		VkDeviceSize m_usage{ 0 };
+		// allocated through this manager
+		VkDeviceSize m_allocated{ 0 };
+	};
+
+	// Owns every VkDeviceMemory of the device. Memory types are picked from a list of candidate property
+	// sets: a candidate whose heap would go past PRESSURE_THRESHOLD of its budget is passed over while a
+	// later one still fits, and an allocation that fails with out-of-memory moves on to the next candidate
+	// instead of throwing. Allocations are tracked per heap and per category for the budget report.
+	class DecoMemoryManager
+	{
+	public:
+		// share of a heap's budget above which the heap counts as under pressure
+		static constexpr float PRESSURE_THRESHOLD = 0.9f;
+		// host visible device local heaps without resizable BAR are small (often 256 MiB), a single
+		// allocation may take at most this share of one before it goes to system memory
+		static constexpr VkDeviceSize BAR_ALLOCATION_DIVISOR = 16;
+
+		struct Allocation
+		{
+			VkDeviceMemory m_memory{ VK_NULL_HANDLE };
+			uint32_t m_memory_type{ 0 };
+			VkMemoryPropertyFlags m_property_flags{ 0 };
+		};
+
+		// memory_budget: VK_EXT_memory_budget is enabled and vkGetPhysicalDeviceMemoryProperties2 available
+		DecoMemoryManager(VkPhysicalDevice physical_device, VkDevice device, bool memory_budget);
+		~DecoMemoryManager();
+
+		DecoMemoryManager(const DecoMemoryManager&) = delete;
+		DecoMemoryManager& operator=(const DecoMemoryManager&) = delete;
+
+		// all thread safe; throws once no candidate can be allocated
+		Allocation allocate(
+			const VkMemoryRequirements& requirements,
+			const std::vector<VkMemoryPropertyFlags>& candidates,
+			DecoMemoryCategory category);
+		// for callers that already chose the memory type
+		VkDeviceMemory allocateType(VkDeviceSize size, uint32_t memory_type, DecoMemoryCategory category);
+		// VK_NULL_HANDLE is ignored
+		void free(VkDeviceMemory memory);
+
+		static DecoMemoryCategory categoryForBufferUsage(VkBufferUsageFlags usage);
+
+		bool hasMemoryBudget() const { return m_memory_budget; }
+		std::vector<DecoMemoryHeapBudget> queryBudgets() const;
+		VkDeviceSize getCategoryUsage(DecoMemoryCategory category) const;
+		void printReport(std::ostream& out) const;
+
+	private:
+		struct Record
+		{
+			uint32_t m_heap;
+			DecoMemoryCategory m_category;
+			VkDeviceSize m_size;
+		};
+
+		// m_mutex held
+		std::vector<DecoMemoryHeapBudget> queryBudgetsLocked() const;
+		bool fitsBudget(
+			uint32_t memory_type,
+			VkMemoryPropertyFlags properties,
+			VkDeviceSize size,
+			const std::vector<DecoMemoryHeapBudget>& budgets) const;
+		VkResult tryAllocate(VkDeviceSize size, uint32_t memory_type, DecoMemoryCategory category, VkDeviceMemory& memory);
+
+	private:
+		VkPhysicalDevice m_physical_device;
+		VkDevice m_device;
+		bool m_memory_budget;
+		VkPhysicalDeviceMemoryProperties m_memory_properties{};
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<VkDeviceMemory, Record> m_allocations;
+		std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heap_usage{};
+		std::array<VkDeviceSize, static_cast<size_t>(DecoMemoryCategory::Count)> m_category_usage{};
+	};
+}
@@ -7,7 +7,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Deco
@@ -37,10 +39,19 @@ namespace Deco
 			std::vector<uint32_t> m_indices{};
 
 			void loadModel(const std::string& file_path);
+
+			// same as loadModel, but reads/writes a binary mesh cache next to the source file
+			void loadModelCached(const std::string& file_path);
+
+		private:
+			bool readCache(const std::string& cache_path, uint64_t source_size, int64_t source_time);
+			void writeCache(const std::string& cache_path, uint64_t source_size, int64_t source_time) const;
 		};
 
 	public:
 		DecoModel(DecoDevice &device, const DecoModel::Builder& builder);
+		// creates an empty model whose buffers are filled later by DecoModelLoader
+		DecoModel(DecoDevice& device);
 		~DecoModel();
 
 		DecoModel(const DecoModel&) = delete;
@@ -49,14 +60,56 @@ namespace Deco
 		static std::unique_ptr<DecoModel> createModelFromFile(DecoDevice& device, const std::string& file_path);
 
 		void bind(VkCommandBuffer command_buffer);
-		void draw(VkCommandBuffer command_buffer);
+		// gl_InstanceIndex runs from first_instance, e.g. into a buffer of per instance transforms
+		void draw(VkCommandBuffer command_buffer, uint32_t instance_count = 1, uint32_t first_instance = 0);
+
+		// false until the GPU copy of the vertex/index data has completed
+		bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+		// the source could not be loaded, the model stays empty and never becomes ready
+		bool hasFailed() const { return m_failed.load(std::memory_order_acquire); }
+
+		// bytes of device memory held by the vertex and index buffers, 0 when they belong to another model
+		VkDeviceSize getMemorySize() const;
+
+		// unique per mesh for the lifetime of the process, used to group draws by mesh; a model that
+		// shares another's buffers shares its id
+		uint32_t getId() const { return m_id; }
+
+		// hash of the vertex and index data, set by DecoModelLoader once the file is parsed; 0 otherwise
+		uint64_t getContentHash() const { return m_content_hash; }
+
+		// the model whose buffers this one draws with when its content was already loaded, null otherwise
+		std::shared_ptr<DecoModel> getBufferOwner() const { return m_buffer_owner; }
+
+		// model space bounding sphere, xyz center and w radius; valid once isReady()
+		glm::vec4 getBoundingSphere() const { return m_bounding_sphere; }
 
 	private:
 		void createVertexBuffers(const std::vector<Vertex>& vertices);
 		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		void computeBounds(const std::vector<Vertex>& vertices);
+
+		// records the staging -> device local copies into command_buffer, staging buffers must outlive the submission
+		void recordUpload(VkCommandBuffer command_buffer, const Builder& builder, std::vector<std::unique_ptr<DecoBuffer>>& staging_buffers);
+		std::unique_ptr<DecoBuffer> recordBufferUpload(
+			VkCommandBuffer command_buffer,
+			const void* data,
+			uint32_t element_size,
+			uint32_t element_count,
+			VkBufferUsageFlags usage,
+			std::vector<std::unique_ptr<DecoBuffer>>& staging_buffers);
+		void markReady() { m_ready.store(true, std::memory_order_release); }
+		void markFailed() { m_failed.store(true, std::memory_order_release); }
+		// draws with the buffers of a ready model with the same content instead of uploading a copy
+		void shareBuffers(std::shared_ptr<DecoModel> owner);
+		static uint32_t nextId();
+
+		friend class DecoModelLoader;
 
 	private:
-		DecoDevice m_deco_device;
+		// non-owning, the device outlives every model
+		DecoDevice& m_deco_device;
+		uint32_t m_id{ nextId() };
 
 		// vertex buffer
 		std::unique_ptr<DecoBuffer> m_vertex_buffer;
@@ -66,5 +119,15 @@ namespace Deco
 		bool m_has_index_buffer{ false };
 		std::unique_ptr<DecoBuffer> m_index_buffer;
 		uint32_t m_index_count;
+
+		// centered on the vertices' bounding box, published by markReady
+		glm::vec4 m_bounding_sphere{ 0.0f };
+
+		uint64_t m_content_hash{ 0 };
+		// keeps the shared buffers alive, and visible to the registry's use count
+		std::shared_ptr<DecoModel> m_buffer_owner;
+
+		std::atomic<bool> m_ready{ false };
+		std::atomic<bool> m_failed{ false };
 	};
 }
\ No newline at end of file
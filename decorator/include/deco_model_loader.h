@@ -0,0 +1,80 @@
+#pragma once
+
+#include "deco_device.h"
+#include "deco_buffer.h"
+#include "deco_model.h"
+#include "deco_thread_pool.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Deco
+{
+	// Streams models in the background: worker threads parse (or read the mesh cache of) the
+	// file, the main thread records the GPU copies in update(), and the model reports isReady()
+	// once the fence of that copy has signaled.
+	class DecoModelLoader
+	{
+	public:
+		DecoModelLoader(DecoDevice& device, uint32_t worker_count = 0);
+		~DecoModelLoader();
+
+		DecoModelLoader(const DecoModelLoader&) = delete;
+		DecoModelLoader& operator=(const DecoModelLoader&) = delete;
+
+		// returns immediately, the model is not ready until a later update() sees its upload finish
+		std::shared_ptr<DecoModel> createModelFromFile(const std::string& file_path);
+
+		// asked on the main thread with the content hash of every parsed model before it is uploaded;
+		// a ready model with that content is shared instead of uploading the same data again
+		using DuplicateResolver = std::function<std::shared_ptr<DecoModel>(uint64_t content_hash)>;
+		void setDuplicateResolver(DuplicateResolver resolver) { m_duplicate_resolver = std::move(resolver); }
+
+		// call once per frame from the thread that submits to the graphics queue
+		void update();
+
+		// blocks until every requested model is ready
+		void waitIdle();
+
+		bool isIdle() const;
+
+	private:
+		struct ParsedModel
+		{
+			std::shared_ptr<DecoModel> m_model;
+			std::unique_ptr<DecoModel::Builder> m_builder;
+			std::string m_file_path;
+			std::string m_error;
+			uint64_t m_content_hash{ 0 };
+		};
+
+		struct PendingUpload
+		{
+			std::vector<std::shared_ptr<DecoModel>> m_models;
+			std::vector<std::unique_ptr<DecoBuffer>> m_staging_buffers;
+			VkCommandBuffer m_command_buffer{ VK_NULL_HANDLE };
+			VkFence m_fence{ VK_NULL_HANDLE };
+		};
+
+		void submitParsedModels();
+		void retireUploads(bool wait);
+
+	private:
+		DecoDevice& m_deco_device;
+
+		std::mutex m_parsed_mutex;
+		std::vector<ParsedModel> m_parsed_models;
+		std::vector<PendingUpload> m_pending_uploads;
+		DuplicateResolver m_duplicate_resolver;
+
+		// requested models that have not been handed to the GPU yet
+		std::atomic<uint32_t> m_unsubmitted_count{ 0 };
+
+		// declared last so the workers are joined before the state they touch is destroyed
+		DecoThreadPool m_thread_pool;
+	};
+}
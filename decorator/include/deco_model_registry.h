@@ -0,0 +1,64 @@
+#pragma once
+
+#include "deco_model.h"
+#include "deco_model_loader.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Deco
+{
+	// Shares one DecoModel per asset. Paths are canonicalized and keyed together with the file's size
+	// and write time, so two paths to the same mesh resolve to the same GPU buffers without the
+	// calling thread ever reading the file. Different files with the same content are found by the
+	// hash DecoModelLoader computes after parsing; the later one shares the loaded model's buffers and
+	// its key is pointed at that model. A model whose only owners are the registry's keys is unused
+	// and gets evicted, least recently used first, once the resident size goes over the memory budget.
+	// Main thread only.
+	class DecoModelRegistry
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_MEMORY_BUDGET = 256ull * 1024ull * 1024ull;
+
+		DecoModelRegistry(DecoDevice& device, DecoModelLoader& loader, VkDeviceSize memory_budget = DEFAULT_MEMORY_BUDGET);
+		~DecoModelRegistry();
+
+		DecoModelRegistry(const DecoModelRegistry&) = delete;
+		DecoModelRegistry& operator=(const DecoModelRegistry&) = delete;
+
+		// returns the shared model for file_path, starting an asynchronous load on first use
+		std::shared_ptr<DecoModel> acquire(const std::string& file_path);
+
+		// call once per frame; forgets models that failed to load, so acquiring them again retries, and
+		// evicts unused models while over budget, through the deletion queue so frames still in flight
+		// keep their buffers
+		void collectGarbage();
+
+		void setMemoryBudget(VkDeviceSize memory_budget) { m_memory_budget = memory_budget; }
+		VkDeviceSize getMemoryBudget() const { return m_memory_budget; }
+		VkDeviceSize getResidentMemory() const;
+		size_t getModelCount() const { return m_entries.size(); }
+
+	private:
+		struct ModelEntry
+		{
+			std::shared_ptr<DecoModel> m_model;
+			uint64_t m_last_used;
+		};
+
+		static std::string canonicalPath(const std::string& file_path);
+		// a ready model that owns its buffers and has this content, null if none is loaded
+		std::shared_ptr<DecoModel> findLoadedModel(uint64_t content_hash) const;
+
+	private:
+		DecoDevice& m_deco_device;
+		DecoModelLoader& m_model_loader;
+		VkDeviceSize m_memory_budget;
+
+		// canonical path, size and write time; several keys share a model when their content matches
+		std::unordered_map<std::string, ModelEntry> m_entries;
+		uint64_t m_use_clock{ 0 };
+	};
+}
@@ -26,31 +26,65 @@ namespace Deco
 		VkPipelineLayout m_pipeline_layout = nullptr;
 		VkRenderPass m_render_pass = nullptr;
 		uint32_t m_subpass = 0;
+		// used instead of the render pass when it is VK_NULL_HANDLE (dynamic rendering)
+		VkFormat m_color_attachment_format = VK_FORMAT_UNDEFINED;
+		VkFormat m_depth_attachment_format = VK_FORMAT_UNDEFINED;
+	};
+
+	struct ComputePipelineConfigInfo
+	{
+		VkPipelineLayout m_pipeline_layout = nullptr;
+		// must match the local_size the shader declares, dispatchThreads rounds up by it
+		VkExtent3D m_workgroup_size{ 64, 1, 1 };
+		// optional specialization constants, m_specialization_data holds the values the entries point into
+		std::vector<VkSpecializationMapEntry> m_specialization_entries{};
+		std::vector<uint8_t> m_specialization_data{};
 	};
 
 	class DecoPipeline
 	{
 	public:
+		// an empty frag_file_path builds a vertex only pipeline, e.g. for depth-only passes
 		DecoPipeline(DecoDevice& device, const std::string& vert_file_path, const std::string& frag_file_path, const PipelineConfigInfo& config_info);
+		DecoPipeline(DecoDevice& device, const std::string& comp_file_path, const ComputePipelineConfigInfo& config_info);
 		~DecoPipeline();
 
 		DecoPipeline(const DecoPipeline&) = delete;
 		DecoPipeline& operator=(const DecoPipeline&) = delete;
+		DecoPipeline(DecoPipeline&& other) noexcept;
+		DecoPipeline& operator=(DecoPipeline&& other) noexcept;
 
 		void bind(VkCommandBuffer command_buffer);
 
+		bool isCompute() const { return m_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE; }
+		VkExtent3D getWorkgroupSize() const { return m_workgroup_size; }
+
+		// compute pipelines only, bind() first
+		void dispatch(VkCommandBuffer command_buffer, uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1);
+		// enough workgroups to cover the given thread counts, the shader bounds checks the remainder
+		void dispatchThreads(VkCommandBuffer command_buffer, uint32_t thread_count_x, uint32_t thread_count_y = 1, uint32_t thread_count_z = 1);
+		// group counts read from a VkDispatchIndirectCommand at offset in buffer
+		void dispatchIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset = 0);
+
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& config_info);
-	private:
+		// whole file as bytes, e.g. SPIR-V for a shader module
 		static std::vector<char> readFile(const std::string& file_path);
+	private:
 
 		void createGraphicsPipeline(const std::string& vert_file_path, const std::string& frag_file_path, const PipelineConfigInfo& config_info);
+		void createComputePipeline(const std::string& comp_file_path, const ComputePipelineConfigInfo& config_info);
 
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module);
+		void release();
 
-		DecoDevice& m_device;
-		VkPipeline m_graphics_pipeline;
-		VkShaderModule m_vert_shader_module;
-		VkShaderModule m_frag_shader_module;
+		// non-owning, a pointer so the pipeline stays move assignable
+		DecoDevice* m_device;
+		VkPipeline m_pipeline{ VK_NULL_HANDLE };
+		VkPipelineBindPoint m_bind_point{ VK_PIPELINE_BIND_POINT_GRAPHICS };
+		VkShaderModule m_vert_shader_module{ VK_NULL_HANDLE };
+		VkShaderModule m_frag_shader_module{ VK_NULL_HANDLE };
+		VkShaderModule m_comp_shader_module{ VK_NULL_HANDLE };
+		VkExtent3D m_workgroup_size{ 1, 1, 1 };
 	};
 }
 
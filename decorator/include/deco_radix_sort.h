@@ -0,0 +1,165 @@
+#pragma once
+
+#include "deco_thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace Deco
+{
+	// key + payload (usually an index into the array being ordered)
+	template <typename Key>
+	struct DecoSortEntry
+	{
+		Key m_key;
+		uint32_t m_value;
+	};
+
+	// Maps a float to an unsigned key with the same ordering, negative values included.
+	inline uint32_t floatToSortKey(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		// negative: flip everything so larger magnitudes sort first; positive: set the sign bit
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	// Stable LSD radix sort on 8 bit digits, ascending by key. scratch is resized as needed and can be
+	// kept between calls to avoid reallocations. Passes where every key has the same digit are skipped,
+	// so mostly-constant upper bytes (small depth ranges, few pipelines) cost one histogram scan.
+	template <typename Key>
+	void radixSort(std::vector<DecoSortEntry<Key>>& entries, std::vector<DecoSortEntry<Key>>& scratch)
+	{
+		static_assert(std::is_unsigned<Key>::value, "radixSort needs an unsigned key");
+		constexpr size_t DIGIT_COUNT = sizeof(Key);
+
+		const size_t count = entries.size();
+		if (count < 2)
+		{
+			return;
+		}
+
+		// all digit histograms in a single pass over the keys
+		std::array<std::array<uint32_t, 256>, DIGIT_COUNT> histograms{};
+		for (const auto& entry : entries)
+		{
+			for (size_t digit = 0; digit < DIGIT_COUNT; digit++)
+			{
+				histograms[digit][(entry.m_key >> (digit * 8)) & 0xff]++;
+			}
+		}
+
+		scratch.resize(count);
+		auto* source = &entries;
+		auto* destination = &scratch;
+
+		for (size_t digit = 0; digit < DIGIT_COUNT; digit++)
+		{
+			auto& histogram = histograms[digit];
+			if (histogram[((*source)[0].m_key >> (digit * 8)) & 0xff] == count)
+			{
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (auto& bucket : histogram)
+			{
+				uint32_t bucket_count = bucket;
+				bucket = offset;
+				offset += bucket_count;
+			}
+
+			for (const auto& entry : *source)
+			{
+				(*destination)[histogram[(entry.m_key >> (digit * 8)) & 0xff]++] = entry;
+			}
+			std::swap(source, destination);
+		}
+
+		if (source != &entries)
+		{
+			entries.swap(scratch);
+		}
+	}
+
+	// Same result as radixSort. Each pass histograms and scatters fixed chunks on the pool; chunk order is
+	// kept so the sort stays stable. Small inputs are sorted on the calling thread, the fan-out costs more.
+	template <typename Key>
+	void parallelRadixSort(
+		std::vector<DecoSortEntry<Key>>& entries, std::vector<DecoSortEntry<Key>>& scratch, DecoThreadPool& thread_pool)
+	{
+		static_assert(std::is_unsigned<Key>::value, "parallelRadixSort needs an unsigned key");
+		constexpr size_t DIGIT_COUNT = sizeof(Key);
+		constexpr size_t MIN_CHUNK_SIZE = 4096;
+
+		const size_t count = entries.size();
+		const size_t chunk_count = std::min<size_t>(thread_pool.getWorkerCount() + 1, count / MIN_CHUNK_SIZE);
+		if (chunk_count < 2)
+		{
+			radixSort(entries, scratch);
+			return;
+		}
+		const size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+		scratch.resize(count);
+		auto* source = &entries;
+		auto* destination = &scratch;
+		std::vector<std::array<uint32_t, 256>> histograms(chunk_count);
+
+		for (size_t digit = 0; digit < DIGIT_COUNT; digit++)
+		{
+			const size_t shift = digit * 8;
+
+			thread_pool.parallelFor(static_cast<uint32_t>(chunk_count), [&](uint32_t chunk)
+				{
+					auto& histogram = histograms[chunk];
+					histogram.fill(0);
+					const size_t end = std::min(count, (chunk + 1) * chunk_size);
+					for (size_t i = chunk * chunk_size; i < end; i++)
+					{
+						histogram[((*source)[i].m_key >> shift) & 0xff]++;
+					}
+				});
+
+			// bucket by bucket, chunk by chunk: where each chunk starts writing each digit value
+			uint32_t offset = 0;
+			bool single_bucket = false;
+			for (size_t bucket = 0; bucket < 256; bucket++)
+			{
+				const uint32_t bucket_start = offset;
+				for (auto& histogram : histograms)
+				{
+					uint32_t bucket_count = histogram[bucket];
+					histogram[bucket] = offset;
+					offset += bucket_count;
+				}
+				single_bucket = single_bucket || (offset - bucket_start == count);
+			}
+			if (single_bucket)
+			{
+				continue;
+			}
+
+			thread_pool.parallelFor(static_cast<uint32_t>(chunk_count), [&](uint32_t chunk)
+				{
+					auto& histogram = histograms[chunk];
+					const size_t end = std::min(count, (chunk + 1) * chunk_size);
+					for (size_t i = chunk * chunk_size; i < end; i++)
+					{
+						const auto& entry = (*source)[i];
+						(*destination)[histogram[(entry.m_key >> shift) & 0xff]++] = entry;
+					}
+				});
+			std::swap(source, destination);
+		}
+
+		if (source != &entries)
+		{
+			entries.swap(scratch);
+		}
+	}
+}
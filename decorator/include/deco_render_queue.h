@@ -0,0 +1,114 @@
+#pragma once
+
+#include "deco_gpu_profiler.h"
+#include "deco_model.h"
+#include "deco_pipeline.h"
+#include "deco_radix_sort.h"
+#include "deco_thread_pool.h"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Deco
+{
+	struct DecoDrawCommand
+	{
+		static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+
+		// draws of a lower layer are submitted first (e.g. depth pre-pass before shading)
+		uint8_t m_layer = 0;
+		DecoPipeline* m_pipeline = nullptr;
+		VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+		// bound to set 0
+		VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+		// one per dynamic binding of set 0 in binding order, e.g. DecoUniformArena allocations
+		std::array<uint32_t, MAX_DYNAMIC_OFFSETS> m_dynamic_offsets{};
+		uint32_t m_dynamic_offset_count = 0;
+		// DecoBindlessHeap set, bound to set 1 when not VK_NULL_HANDLE
+		VkDescriptorSet m_bindless_set = VK_NULL_HANDLE;
+		// nullptr draws m_vertex_count vertices m_instance_count times without vertex buffers
+		DecoModel* m_model = nullptr;
+		uint32_t m_vertex_count = 0;
+		uint32_t m_instance_count = 1;
+		// without a model: the counts come from the VkDrawIndirectCommand at m_indirect_offset instead,
+		// e.g. written by a compute pass
+		VkBuffer m_indirect_buffer = VK_NULL_HANDLE;
+		VkDeviceSize m_indirect_offset = 0;
+		VkShaderStageFlags m_push_constant_stages = 0;
+		// view space depth, closer draws go first within the same state
+		float m_depth = 0.0f;
+	};
+
+	struct DecoRenderQueueStats
+	{
+		uint32_t m_draws{ 0 };
+		uint32_t m_pipeline_binds{ 0 };
+		uint32_t m_descriptor_set_binds{ 0 };
+		uint32_t m_vertex_buffer_binds{ 0 };
+		// binds an unsorted submit loop would have issued (one of each per draw)
+		uint32_t m_naive_binds{ 0 };
+	};
+
+	// Collects a frame's draws, orders them by a 64 bit key (layer | pipeline | descriptor set | model | depth)
+	// and submits them, binding state only when it differs from the previous draw.
+	class DecoRenderQueue
+	{
+	public:
+		static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+		static constexpr uint8_t MAX_LAYER = 15;
+
+		// thread_pool is optional, large queues are sorted on it
+		DecoRenderQueue(DecoThreadPool* thread_pool = nullptr);
+
+		DecoRenderQueue(const DecoRenderQueue&) = delete;
+		DecoRenderQueue& operator=(const DecoRenderQueue&) = delete;
+
+		// start of every frame
+		void clear();
+
+		void push(const DecoDrawCommand& command, const void* push_constants = nullptr, uint32_t push_constant_size = 0);
+
+		void sort();
+
+		// inside the render pass; with a profiler every layer gets its own timestamp scope
+		void submit(VkCommandBuffer command_buffer, DecoGpuProfiler* gpu_profiler = nullptr);
+
+		void setLayerName(uint8_t layer, const std::string& name) { m_layer_names[layer] = name; }
+
+		size_t size() const { return m_commands.size(); }
+		const DecoRenderQueueStats& getStats() const { return m_stats; }
+		void printStats(std::ostream& out) const;
+
+	private:
+		struct QueuedCommand
+		{
+			DecoDrawCommand m_command;
+			uint32_t m_push_constant_offset;
+			uint32_t m_push_constant_size;
+		};
+
+		uint64_t makeKey(const DecoDrawCommand& command);
+		// small ids in order of first use this frame, so the key fields stay narrow
+		template <typename Handle>
+		static uint32_t idOf(std::unordered_map<Handle, uint32_t>& ids, Handle handle);
+
+	private:
+		DecoThreadPool* m_thread_pool;
+
+		std::vector<QueuedCommand> m_commands;
+		std::vector<uint8_t> m_push_constant_data;
+		std::vector<DecoSortEntry<uint64_t>> m_sorted;
+		std::vector<DecoSortEntry<uint64_t>> m_sort_scratch;
+		bool m_is_sorted{ true };
+
+		std::unordered_map<DecoPipeline*, uint32_t> m_pipeline_ids;
+		std::unordered_map<VkDescriptorSet, uint32_t> m_descriptor_set_ids;
+		std::array<std::string, MAX_LAYER + 1> m_layer_names{};
+
+		DecoRenderQueueStats m_stats{};
+	};
+}
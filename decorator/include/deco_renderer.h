@@ -1,41 +1,98 @@
 #pragma once
 
 #include "deco_device.h"
+#include "deco_frame_stats.h"
+#include "deco_gpu_profiler.h"
+#include "deco_pipeline.h"
 #include "deco_swap_chain.h"
 #include "deco_window.h"
 
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <vector>
 
 namespace Deco
 {
+	// rolling input-to-present measurements, in milliseconds
+	struct DecoLatencyStats
+	{
+		// input sampled -> vkQueuePresentKHR returned
+		double m_input_to_present_ms{ 0.0 };
+		// input sampled -> the frame's fence observed signaled (upper bound of GPU completion)
+		double m_input_to_complete_ms{ 0.0 };
+		uint64_t m_sample_count{ 0 };
+	};
+
+	struct DecoRendererSettings
+	{
+		DecoLatencyMode m_latency_mode = DecoLatencyMode::Balanced;
+		// capped by the device, see DecoSwapChain
+		VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+		// falls back to the render pass path on devices without Vulkan 1.3 / VK_KHR_dynamic_rendering
+		bool m_dynamic_rendering = false;
+		// 0 leaves the frame rate uncapped
+		double m_target_frame_rate = 0.0;
+	};
+
 	class DecoRenderer
 	{
 	public:
-		DecoRenderer(DecoWindow& window, DecoDevice& device);
+		DecoRenderer(DecoWindow& window, DecoDevice& device, const DecoRendererSettings& settings = DecoRendererSettings{});
 		~DecoRenderer();
 
 		DecoRenderer(const DecoRenderer&) = delete;
 		DecoRenderer& operator=(const DecoRenderer&) = delete;
 
 		VkRenderPass getSwapChainRenderPass() const;
+		VkSampleCountFlagBits getSampleCount() const;
+		// points a pipeline config at the swap chain render pass (or its attachment formats with
+		// dynamic rendering) and matches its sample count
+		void configurePipeline(PipelineConfigInfo& config_info) const;
 		float getAspectRatio() const;
+		VkExtent2D getSwapChainExtent() const;
 		bool isFrameInProgress() const;
 
 		VkCommandBuffer getCurrentCommandBuffer() const;
 
 		int getFrameIndex() const;
+		uint32_t getFramesInFlight() const { return m_swap_chain_config.m_frames_in_flight; }
+		DecoLatencyMode getLatencyMode() const { return m_latency_mode; }
+
+		// call right before sampling input: runs the frame limiter if one is set and, in low-latency
+		// mode, moves the frame fence wait here so input is read as late as possible
+		void waitForNextFrame();
+		// caps the frame rate with the sleep + spin pacer, 0 turns the limiter off
+		void setTargetFrameRate(double frames_per_second) { m_frame_pacer.setTargetFrameRate(frames_per_second); }
+		// per-stage timings of the last frames and what bounds them
+		const DecoFrameStats& getFrameStats() const { return m_frame_stats; }
+		// timestamp scopes inside the frame's command buffer, reset by beginFrame
+		DecoGpuProfiler& getGpuProfiler() { return m_gpu_profiler; }
+		// timestamp of the input the next frame is built from
+		void markInputSampled();
+		const DecoLatencyStats& getLatencyStats() const { return m_latency_stats; }
+		// monotonically increasing count of frames begun, tags entries of the deletion queue
+		uint64_t getFrameNumber() const { return m_frame_number; }
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
+		// compute work of the frame is recorded between these, after beginFrame and before the render
+		// pass; endComputePass makes its storage writes visible to the draws that follow
+		void beginComputePass(VkCommandBuffer command_buffer);
+		void endComputePass(VkCommandBuffer command_buffer);
 		void beginSwapChainRenderPass(VkCommandBuffer command_buffer);
 		void endSwapChainRenderPass(VkCommandBuffer command_buffer);
 
 	private:
 		void createCommandBuffers();
 		void freeCommandBuffers();
-		void recreateSwapChain();
+		// returns false while the window is minimized
+		bool recreateSwapChain();
+		void beginDynamicRendering(VkCommandBuffer command_buffer, const VkClearValue& color_clear, const VkClearValue& depth_clear);
+		void endDynamicRendering(VkCommandBuffer command_buffer);
+
+		using Clock = std::chrono::steady_clock;
+		void recordLatency(double& average_ms, Clock::time_point input_time);
 
 	private:
 		DecoWindow& m_deco_window;
@@ -43,9 +100,29 @@ namespace Deco
 		std::unique_ptr<DecoSwapChain> m_deco_swap_chain;
 		std::vector<VkCommandBuffer> m_command_buffers;
 
+		DecoLatencyMode m_latency_mode;
+		DecoSwapChainConfig m_swap_chain_config;
+		DecoGpuProfiler m_gpu_profiler;
+
+		DecoLatencyStats m_latency_stats{};
+		Clock::time_point m_input_time{};
+		// input time of the frame last submitted on each slot, for the completion latency
+		std::vector<Clock::time_point> m_slot_input_times;
+
+		DecoFramePacer m_frame_pacer;
+		DecoFrameStats m_frame_stats;
+		double m_pace_ms{ 0.0 };
+		Clock::time_point m_record_start{};
+		Clock::time_point m_last_frame_end{};
+
 		uint32_t m_current_image_index{ 0 };
 		int m_current_frame_index{ 0 };
+		uint64_t m_frame_number{ 0 };
 		bool  m_is_frame_started{ false };
+		bool m_is_compute_pass_started{ false };
+		bool m_is_render_pass_started{ false };
+		uint32_t m_compute_scope{ 0 };
+		bool m_swap_chain_outdated{ false };
 	};
 }
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace Deco
+{
+	// Device-wide owner of VkSamplers. Samplers are keyed by their create info, so every texture
+	// asking for the same filtering and addressing shares one handle; they live as long as the device.
+	class DecoSamplerCache
+	{
+	public:
+		DecoSamplerCache(VkDevice device, const VkPhysicalDeviceProperties& properties)
+			: m_device(device), m_max_anisotropy(properties.limits.maxSamplerAnisotropy) {}
+		~DecoSamplerCache();
+
+		DecoSamplerCache(const DecoSamplerCache&) = delete;
+		DecoSamplerCache& operator=(const DecoSamplerCache&) = delete;
+
+		// pNext chains are not part of the key and must be null
+		VkSampler getSampler(const VkSamplerCreateInfo& sampler_info);
+
+		// trilinear, anisotropic at the device maximum, every mip level
+		VkSampler getLinearSampler(VkSamplerAddressMode address_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+		size_t getSamplerCount() const;
+
+	private:
+		struct SamplerKey
+		{
+			VkSamplerCreateInfo m_info;
+
+			bool operator==(const SamplerKey& other) const;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const SamplerKey& key) const;
+		};
+
+	private:
+		VkDevice m_device;
+		float m_max_anisotropy;
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<SamplerKey, VkSampler, KeyHash> m_samplers;
+	};
+}
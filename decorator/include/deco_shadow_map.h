@@ -0,0 +1,57 @@
+#pragma once
+
+#include "deco_device.h"
+
+#include <vector>
+
+namespace Deco
+{
+	// A depth-only 2D array image with one layer per shadow cascade, the render pass that fills a layer
+	// and the comparison sampler the shaders read it through (sampler2DArrayShadow).
+	class DecoShadowMap
+	{
+	public:
+		DecoShadowMap(DecoDevice& device, uint32_t resolution, uint32_t cascade_count);
+		~DecoShadowMap();
+
+		DecoShadowMap(const DecoShadowMap&) = delete;
+		DecoShadowMap& operator=(const DecoShadowMap&) = delete;
+
+		// for pipelines drawing into a cascade: depth attachment only, no color
+		VkRenderPass getRenderPass() const { return m_render_pass; }
+		VkFormat getFormat() const { return m_format; }
+		uint32_t getResolution() const { return m_resolution; }
+		uint32_t getCascadeCount() const { return m_cascade_count; }
+
+		// every cascade, in the layout the render pass leaves it in
+		VkDescriptorImageInfo getDescriptorInfo() const;
+
+		// clears the cascade's layer and sets the viewport and scissor to it; the render pass waits for
+		// the previous frame's fragment shader reads and makes the depth visible to this frame's
+		void beginCascade(VkCommandBuffer command_buffer, uint32_t cascade);
+		void endCascade(VkCommandBuffer command_buffer);
+
+	private:
+		void createImage();
+		void createRenderPass();
+		void createFramebuffers();
+		void createSampler();
+
+	private:
+		DecoDevice& m_deco_device;
+		uint32_t m_resolution;
+		uint32_t m_cascade_count;
+		VkFormat m_format{ VK_FORMAT_UNDEFINED };
+
+		VkImage m_image{ VK_NULL_HANDLE };
+		VkDeviceMemory m_image_memory{ VK_NULL_HANDLE };
+		// all layers, sampled
+		VkImageView m_array_view{ VK_NULL_HANDLE };
+		// one layer each, rendered to
+		std::vector<VkImageView> m_layer_views;
+		std::vector<VkFramebuffer> m_framebuffers;
+		VkRenderPass m_render_pass{ VK_NULL_HANDLE };
+		// owned by the device's sampler cache
+		VkSampler m_sampler{ VK_NULL_HANDLE };
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deco_device.h"
+#include "deco_frame_stats.h"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -12,25 +13,54 @@
 
 namespace Deco
 {
+	enum class DecoLatencyMode
+	{
+		// 2 frames in flight, mailbox if available, otherwise v-sync
+		Balanced,
+		// 1 frame in flight and the CPU waits for it just before sampling input
+		LowLatency,
+		// 3 frames in flight, mailbox or immediate, otherwise v-sync
+		Throughput,
+	};
+
+	const char* getLatencyModeName(DecoLatencyMode mode);
+
+	struct DecoSwapChainConfig
+	{
+		uint32_t m_frames_in_flight = 2;
+		// first supported mode wins, FIFO is the fallback every device has
+		std::vector<VkPresentModeKHR> m_present_modes{ VK_PRESENT_MODE_MAILBOX_KHR };
+		bool m_wait_before_input = false;
+		// requested MSAA sample count, lowered to what the device supports for color and depth
+		VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+		// render with vkCmdBeginRendering instead of a render pass and framebuffers, if the device can
+		bool m_dynamic_rendering = false;
+
+		static DecoSwapChainConfig fromLatencyMode(DecoLatencyMode mode);
+	};
 
 	class DecoSwapChain
 	{
 	public:
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		// upper bound for the runtime frames in flight
+		static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
 
-		DecoSwapChain(DecoDevice& device_ref, VkExtent2D window_extent);
-		DecoSwapChain(DecoDevice& device_ref, VkExtent2D window_extent, std::shared_ptr<DecoSwapChain> previous);
+		DecoSwapChain(DecoDevice& device_ref, VkExtent2D window_extent, const DecoSwapChainConfig& config);
+		DecoSwapChain(DecoDevice& device_ref, VkExtent2D window_extent, const DecoSwapChainConfig& config, std::shared_ptr<DecoSwapChain> previous);
 
 		~DecoSwapChain();
 
 		DecoSwapChain(const DecoSwapChain&) = delete;
 		DecoSwapChain& operator=(const DecoSwapChain&) = delete;
 
+		// both VK_NULL_HANDLE on the dynamic rendering path
 		VkFramebuffer getFrameBuffer(int index) { return m_swap_chain_frame_buffers[index]; }
 		VkRenderPass getRenderPass() { return m_render_pass; }
+		VkImage getImage(int index) { return m_swap_chain_images[index]; }
 		VkImageView getImageView(int index) { return m_swap_chain_image_views[index]; }
 		size_t imageCount() { return m_swap_chain_images.size(); }
 		VkFormat getSwapChainImageFormat() { return m_swap_chain_image_format; }
+		VkFormat getSwapChainDepthFormat() { return m_swap_chain_depth_format; }
 		VkExtent2D getSwapChainExtent() { return m_swap_chain_extent; }
 		uint32_t width() { return m_swap_chain_extent.width; }
 		uint32_t height() { return m_swap_chain_extent.height; }
@@ -41,16 +71,50 @@ namespace Deco
 		}
 		VkFormat findDepthFormat();
 
+		uint32_t getFramesInFlight() const { return m_config.m_frames_in_flight; }
+		const DecoSwapChainConfig& getConfig() const { return m_config; }
+		VkPresentModeKHR getPresentMode() const { return m_present_mode; }
+		// sample count of the render pass attachments, pipelines have to rasterize with it
+		VkSampleCountFlagBits getSampleCount() const { return m_msaa_samples; }
+		bool usesDynamicRendering() const { return m_dynamic_rendering; }
+		// the shared attachments, for the barriers the dynamic rendering path records itself;
+		// the color attachment only exists with MSAA
+		VkImage getDepthImage() const { return m_depth_attachment.m_image; }
+		VkImageView getDepthImageView() const { return m_depth_attachment.m_view; }
+		VkImage getColorImage() const { return m_color_attachment.m_image; }
+		VkImageView getColorImageView() const { return m_color_attachment.m_view; }
+
+		// waits for the in-flight fence of the frame slot acquireNextImage will use next
+		void waitForCurrentFrame();
+
 		VkResult acquireNextImage(uint32_t* image_index);
 		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* image_index);
 
+		// fence, acquire, submit and present times accumulated since the last call
+		DecoFrameTimings takeFrameTimings();
+
 		bool compareSwapFormats(const DecoSwapChain& swap_chain) const
 		{
 			return swap_chain.m_swap_chain_depth_format == m_swap_chain_depth_format &&
-				swap_chain.m_swap_chain_image_format == m_swap_chain_image_format;
+				swap_chain.m_swap_chain_image_format == m_swap_chain_image_format &&
+				swap_chain.m_msaa_samples == m_msaa_samples;
 		}
 
+		// size of the depth allocation; lazily allocated memory may commit less than this
+		VkDeviceSize getDepthMemorySize() const { return m_depth_attachment.m_memory_size; }
+
 	private:
+		// an image that only lives inside the render pass: never sampled, never stored
+		struct Attachment
+		{
+			VkImage m_image = VK_NULL_HANDLE;
+			VkDeviceMemory m_memory = VK_NULL_HANDLE;
+			VkDeviceSize m_memory_size = 0;
+			uint32_t m_memory_type = 0;
+			VkImageView m_view = VK_NULL_HANDLE;
+			bool m_lazily_allocated = false;
+		};
+
 		void init();
 		void createSwapChain();
 		void createImageViews();
@@ -58,27 +122,49 @@ namespace Deco
 		void createRenderPass();
 		void createFramebuffers();
 		void createSyncObjects();
+		void createColorResources();
+		void createAttachment(
+			Attachment& attachment,
+			VkFormat format,
+			VkImageUsageFlags usage,
+			VkImageAspectFlags aspect,
+			VkSampleCountFlagBits samples,
+			Attachment* previous);
+		void destroyAttachment(Attachment& attachment);
+
+		// recreation helpers, take over what the retired swap chain no longer needs
+		bool adoptRenderPass(DecoSwapChain& previous);
+		void adoptSyncObjects(DecoSwapChain& previous);
 
 		// Helper functions
 		VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats);
 		VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_presentModes);
 		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+		VkSampleCountFlagBits chooseSampleCount(VkSampleCountFlagBits requested_samples);
 
 		VkFormat m_swap_chain_image_format;
 		VkFormat m_swap_chain_depth_format;
 		VkExtent2D m_swap_chain_extent;
 
 		std::vector<VkFramebuffer> m_swap_chain_frame_buffers;
-		VkRenderPass m_render_pass;
-
-		std::vector<VkImage> m_depth_images;
-		std::vector<VkDeviceMemory> m_depth_image_memorys;
-		std::vector<VkImageView> m_depth_image_views;
+		VkRenderPass m_render_pass = VK_NULL_HANDLE;
+
+		// one depth image for all frames: depth is cleared at the start of the render pass and never
+		// stored, and the render pass dependency (the renderer's barriers with dynamic rendering)
+		// orders each frame's clear after the previous frame's writes
+		Attachment m_depth_attachment;
+		// multisampled color, resolved into the swap chain image at the end of the render pass;
+		// shared by all frames like depth, unused without MSAA
+		Attachment m_color_attachment;
+		VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+		bool m_dynamic_rendering = false;
 		std::vector<VkImage> m_swap_chain_images;
 		std::vector<VkImageView> m_swap_chain_image_views;
 
 		DecoDevice& device;
 		VkExtent2D m_window_extent;
+		DecoSwapChainConfig m_config;
+		VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
 
 		VkSwapchainKHR m_swap_chain;
 		std::shared_ptr<DecoSwapChain> m_old_swap_chain;
@@ -88,6 +174,8 @@ namespace Deco
 		std::vector<VkFence> m_in_flight_fences;
 		std::vector<VkFence> m_images_in_flight;
 		size_t m_current_frame = 0;
+
+		DecoFrameTimings m_frame_timings{};
 	};
 
 }  // namespace Deco
\ No newline at end of file
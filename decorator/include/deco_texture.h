@@ -0,0 +1,114 @@
+#pragma once
+
+#include "deco_bindless_heap.h"
+#include "deco_device.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Deco
+{
+	struct DecoImageLevel
+	{
+		size_t m_offset{ 0 };
+		size_t m_size{ 0 };
+		uint32_t m_width{ 0 };
+		uint32_t m_height{ 0 };
+	};
+
+	// A decoded 2D image in CPU memory, tightly packed mip levels with level 0 the largest.
+	struct DecoImageData
+	{
+		VkFormat m_format{ VK_FORMAT_UNDEFINED };
+		uint32_t m_width{ 0 };
+		uint32_t m_height{ 0 };
+		std::vector<DecoImageLevel> m_levels;
+		std::vector<uint8_t> m_data;
+
+		// .ktx2 (RGBA8 or BCn, no supercompression) or .dds (DX10 header, legacy 32 bit RGBA or
+		// DXT1/DXT5/ATI2), throws on anything else; a single level uncompressed file gets its mip chain
+		// generated on the GPU
+		static DecoImageData loadFile(const std::string& file_path);
+		static DecoImageData loadKtx2(const std::vector<uint8_t>& file, const std::string& file_path);
+		static DecoImageData loadDds(const std::vector<uint8_t>& file, const std::string& file_path);
+		// 1x1 R8G8B8A8_UNORM, rgba packed as 0xAABBGGRR
+		static DecoImageData solidColor(uint32_t rgba);
+
+		// floor(log2(max(width, height))) + 1
+		static uint32_t fullMipCount(uint32_t width, uint32_t height);
+		// bytes of one width x height level of format, 0 for formats the loaders do not know
+		static size_t levelSize(VkFormat format, uint32_t width, uint32_t height);
+		// BC1-BC7, stored as 4x4 blocks and never blit
+		static bool isBlockCompressed(VkFormat format);
+		static bool isSrgb(VkFormat format);
+		static VkFormat dxgiToVkFormat(uint32_t dxgi_format);
+
+		const uint8_t* levelData(uint32_t level) const { return m_data.data() + m_levels[level].m_offset; }
+	};
+
+	// A sampled 2D image whose mip levels become resident coarsest first. Until isReady() the texture has
+	// no view; afterwards the view (and bindless slot) covers the levels that have arrived so far, so they
+	// may change between frames while DecoTextureLoader streams in finer levels.
+	class DecoTexture
+	{
+	public:
+		DecoTexture(DecoDevice& device, DecoBindlessHeap* bindless_heap = nullptr);
+		~DecoTexture();
+
+		DecoTexture(const DecoTexture&) = delete;
+		DecoTexture& operator=(const DecoTexture&) = delete;
+
+		// true once at least the coarsest mip level is on the GPU
+		bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+		// every mip level is resident
+		bool isComplete() const { return isReady() && m_resident_mip == 0; }
+
+		VkImage getImage() const { return m_image; }
+		VkImageView getImageView() const { return m_image_view; }
+		VkSampler getSampler() const { return m_sampler; }
+		VkDescriptorImageInfo getDescriptorInfo() const;
+
+		// DecoBindlessHeap::INVALID_SLOT until ready or without a heap
+		uint32_t getBindlessSlot() const { return m_bindless_slot; }
+
+		VkFormat getFormat() const { return m_format; }
+		uint32_t getWidth() const { return m_width; }
+		uint32_t getHeight() const { return m_height; }
+		uint32_t getMipLevels() const { return m_mip_levels; }
+		// finest level currently resident, m_mip_levels while nothing is
+		uint32_t getResidentMip() const { return m_resident_mip; }
+
+	private:
+		void createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels, VkImageUsageFlags usage);
+		// marks [first_level, first_level + level_count) resident and republishes the view if the
+		// resident chain grew, main thread only
+		void completeLevels(uint32_t first_level, uint32_t level_count);
+		void releaseView();
+
+		friend class DecoTextureLoader;
+
+	private:
+		// non-owning, the device outlives every texture
+		DecoDevice& m_deco_device;
+		// non-owning, nullptr without bindless mode
+		DecoBindlessHeap* m_bindless_heap;
+
+		VkImage m_image{ VK_NULL_HANDLE };
+		VkDeviceMemory m_image_memory{ VK_NULL_HANDLE };
+		VkImageView m_image_view{ VK_NULL_HANDLE };
+		VkSampler m_sampler{ VK_NULL_HANDLE };
+		uint32_t m_bindless_slot{ DecoBindlessHeap::INVALID_SLOT };
+
+		VkFormat m_format{ VK_FORMAT_UNDEFINED };
+		uint32_t m_width{ 0 };
+		uint32_t m_height{ 0 };
+		uint32_t m_mip_levels{ 0 };
+		uint32_t m_resident_mip{ 0 };
+		// bit per mip level whose upload has completed
+		uint32_t m_completed_levels{ 0 };
+
+		std::atomic<bool> m_ready{ false };
+	};
+}
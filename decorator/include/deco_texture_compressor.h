@@ -0,0 +1,58 @@
+#pragma once
+
+#include "deco_device.h"
+#include "deco_texture.h"
+#include "deco_thread_pool.h"
+
+#include <string>
+
+namespace Deco
+{
+	enum class DecoTextureCompression
+	{
+		None,
+		// BC7, else BC1: opaque color, 4-8x smaller than RGBA8
+		Color,
+		// BC7, else BC3: color with alpha, 4x smaller
+		ColorAlpha,
+		// BC5: two channel tangent space normals (z is reconstructed), 4x smaller
+		Normal
+	};
+
+	// the compressed format a texture gets, picked by whether its source is sRGB
+	struct DecoCompressedFormats
+	{
+		VkFormat m_linear{ VK_FORMAT_R8G8B8A8_UNORM };
+		VkFormat m_srgb{ VK_FORMAT_R8G8B8A8_SRGB };
+	};
+
+	// CPU block compression of RGBA8 images into BC1/BC3/BC4/BC5/BC7 (BC7 as single subset mode 6
+	// blocks). The encoders favour speed over the last bit of quality; they are meant to run once per
+	// source image, the result is cached next to the source and reused while the source is unchanged.
+	class DecoTextureCompressor
+	{
+	public:
+		// the first format of the compression the device can sample with linear filtering, through
+		// findSupportedFormat; RGBA8 when the device has none of them
+		static DecoCompressedFormats chooseFormats(DecoDevice& device, DecoTextureCompression compression);
+
+		// whether compress() has an encoder for format (BC1/BC3/BC4/BC5/BC7, UNORM or sRGB)
+		static bool canEncode(VkFormat format);
+
+		// encodes source (RGBA8 or BGRA8, its own mip levels are ignored) into a full mip chain of
+		// format; the blocks are spread over thread_pool, nullptr runs everything on the calling thread
+		static DecoImageData compress(const DecoImageData& source, VkFormat format, DecoThreadPool* thread_pool = nullptr);
+
+		// reads file_path + ".texcache" if it was made from the current file in one of formats,
+		// otherwise loads file_path, compresses it and writes the cache; files that already hold
+		// block compressed data are returned as they are
+		static DecoImageData loadCompressed(
+			const std::string& file_path,
+			const DecoCompressedFormats& formats,
+			DecoThreadPool* thread_pool = nullptr);
+
+	private:
+		static bool readCache(const std::string& cache_path, uint64_t source_size, int64_t source_time, const DecoCompressedFormats& formats, DecoImageData& image);
+		static void writeCache(const std::string& cache_path, uint64_t source_size, int64_t source_time, const DecoImageData& image);
+	};
+}
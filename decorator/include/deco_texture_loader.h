@@ -0,0 +1,117 @@
+#pragma once
+
+#include "deco_bindless_heap.h"
+#include "deco_buffer.h"
+#include "deco_device.h"
+#include "deco_texture.h"
+#include "deco_texture_compressor.h"
+#include "deco_thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Deco
+{
+	// Streams textures in the background: worker threads read and decode the file, the main thread
+	// records the uploads in update(). Mip levels go up coarsest first and at most upload_budget bytes
+	// per update, so a texture is sampleable (blurry) after its first small level and sharpens over
+	// the following frames without a large upload stalling any one of them. Images that come without
+	// a mip chain are uploaded whole and the chain is blitted on the GPU. Compressed requests are
+	// encoded to BCn once by DecoTextureCompressor on a separate pool and read from its cache after.
+	class DecoTextureLoader
+	{
+	public:
+		// with a bindless heap every texture gets a sampled image slot once it is ready
+		DecoTextureLoader(
+			DecoDevice& device,
+			DecoBindlessHeap* bindless_heap = nullptr,
+			uint32_t worker_count = 0,
+			VkDeviceSize upload_budget = 8 * 1024 * 1024);
+		~DecoTextureLoader();
+
+		DecoTextureLoader(const DecoTextureLoader&) = delete;
+		DecoTextureLoader& operator=(const DecoTextureLoader&) = delete;
+
+		// return immediately, the texture is not ready until a later update() sees a level arrive;
+		// VK_NULL_HANDLE samples with the sampler cache's linear repeat sampler. Uncompressed sources
+		// are block compressed when the device supports a format of compression.
+		std::shared_ptr<DecoTexture> createTextureFromFile(
+			const std::string& file_path,
+			VkSampler sampler = VK_NULL_HANDLE,
+			DecoTextureCompression compression = DecoTextureCompression::None);
+		std::shared_ptr<DecoTexture> createTexture(DecoImageData image, VkSampler sampler = VK_NULL_HANDLE);
+
+		// call once per frame from the thread that submits to the graphics queue
+		void update();
+
+		// blocks until every requested texture is complete
+		void waitIdle();
+
+		bool isIdle() const;
+
+	private:
+		struct DecodedTexture
+		{
+			std::shared_ptr<DecoTexture> m_texture;
+			DecoImageData m_image;
+			VkSampler m_sampler{ VK_NULL_HANDLE };
+			std::string m_file_path;
+			std::string m_error;
+		};
+
+		struct StreamingTexture
+		{
+			std::shared_ptr<DecoTexture> m_texture;
+			DecoImageData m_image;
+			// levels still to upload, the next one is m_remaining_levels - 1
+			uint32_t m_remaining_levels{ 0 };
+			bool m_generate_mips{ false };
+		};
+
+		struct UploadedLevels
+		{
+			std::shared_ptr<DecoTexture> m_texture;
+			uint32_t m_first_level;
+			uint32_t m_level_count;
+		};
+
+		struct PendingUpload
+		{
+			std::vector<UploadedLevels> m_levels;
+			std::unique_ptr<DecoBuffer> m_staging_buffer;
+			VkCommandBuffer m_command_buffer{ VK_NULL_HANDLE };
+			VkFence m_fence{ VK_NULL_HANDLE };
+		};
+
+		// takes the decoded images and creates their GPU images
+		void startDecodedTextures();
+		void submitUploads(bool ignore_budget);
+		void retireUploads(bool wait);
+
+		void recordLevelUpload(VkCommandBuffer command_buffer, const StreamingTexture& streaming, uint32_t level, VkBuffer staging_buffer, VkDeviceSize staging_offset);
+		void recordMipGeneration(VkCommandBuffer command_buffer, const DecoTexture& texture);
+
+	private:
+		DecoDevice& m_deco_device;
+		// non-owning, may be nullptr
+		DecoBindlessHeap* m_bindless_heap;
+		VkDeviceSize m_upload_budget;
+
+		std::mutex m_decoded_mutex;
+		std::vector<DecodedTexture> m_decoded_textures;
+		std::vector<StreamingTexture> m_streaming_textures;
+		std::vector<PendingUpload> m_pending_uploads;
+
+		// requested textures that have not been handed to the GPU yet
+		std::atomic<uint32_t> m_undecoded_count{ 0 };
+
+		// declared last so the workers are joined before the state they touch is destroyed
+		// the decode workers block on encodes, which must not queue behind them on the same pool;
+		// created with the first compressed request
+		std::unique_ptr<DecoThreadPool> m_encode_thread_pool;
+		DecoThreadPool m_thread_pool;
+	};
+}
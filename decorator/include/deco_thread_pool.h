@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Deco
+{
+	class DecoThreadPool
+	{
+	public:
+		// worker_count == 0 picks hardware_concurrency - 1 (at least one worker)
+		DecoThreadPool(uint32_t worker_count = 0);
+		~DecoThreadPool();
+
+		DecoThreadPool(const DecoThreadPool&) = delete;
+		DecoThreadPool& operator=(const DecoThreadPool&) = delete;
+
+		void enqueue(std::function<void()> task);
+
+		// runs task(0) .. task(task_count - 1) on the workers and the calling thread, returns when all
+		// of them have finished; only waits for its own tasks, unlike waitIdle
+		void parallelFor(uint32_t task_count, const std::function<void(uint32_t)>& task);
+
+		// blocks until the queue is empty and every worker is idle
+		void waitIdle();
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	private:
+		void workerLoop();
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_tasks;
+
+		std::mutex m_mutex;
+		std::condition_variable m_task_available;
+		std::condition_variable m_idle;
+
+		uint32_t m_busy_workers{ 0 };
+		bool m_stopping{ false };
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "deco_buffer.h"
+#include "deco_device.h"
+#include "deco_upload_batch.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace Deco
+{
+	// A persistently mapped uniform buffer split into one region per frame in flight. Allocations bump
+	// a pointer through the current frame's region and come back as dynamic offsets, so per-frame,
+	// per-pass and per-draw constants need neither buffers nor descriptor sets of their own: one set
+	// with a UNIFORM_BUFFER_DYNAMIC binding (see descriptorInfo) reaches all of them.
+	class DecoUniformArena
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 256 * 1024;
+
+		// the buffer uses DecoBuffer::uploadMemoryCandidates, see addToBatch for non-coherent memory
+		DecoUniformArena(DecoDevice& device, uint32_t frames_in_flight, VkDeviceSize frame_size = DEFAULT_FRAME_SIZE);
+
+		DecoUniformArena(const DecoUniformArena&) = delete;
+		DecoUniformArena& operator=(const DecoUniformArena&) = delete;
+
+		struct Allocation
+		{
+			void* m_data;
+			// pass to vkCmdBindDescriptorSets as the binding's dynamic offset
+			uint32_t m_dynamic_offset;
+		};
+
+		// once the frame's in-flight fence has signaled: rewinds that frame's region
+		void beginFrame(uint32_t frame_index);
+
+		// thread safe, throws when the frame region is exhausted; offsets honour minUniformBufferOffsetAlignment
+		Allocation allocate(VkDeviceSize size);
+
+		template <typename T>
+		uint32_t push(const T& value)
+		{
+			Allocation allocation = allocate(sizeof(T));
+			std::memcpy(allocation.m_data, &value, sizeof(T));
+			return allocation.m_dynamic_offset;
+		}
+
+		// after the frame's last allocation: queues everything allocated this frame as one range
+		void addToBatch(DecoUploadBatch& batch);
+
+		// for a UNIFORM_BUFFER_DYNAMIC binding that reads range bytes; every allocation bound through it
+		// must be at least range bytes so offset + range stays inside the buffer
+		VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+
+		VkDeviceSize getFrameSize() const { return m_frame_size; }
+		// bytes allocated in the current frame, and the most any frame has used
+		VkDeviceSize getFrameUsage() const { return m_head.load() - m_frame_begin; }
+		VkDeviceSize getPeakUsage() const { return m_peak_usage; }
+
+	private:
+		std::unique_ptr<DecoBuffer> m_buffer;
+		VkDeviceSize m_min_alignment;
+		VkDeviceSize m_frame_size;
+
+		VkDeviceSize m_frame_begin{ 0 };
+		std::atomic<VkDeviceSize> m_head{ 0 };
+		VkDeviceSize m_peak_usage{ 0 };
+	};
+}
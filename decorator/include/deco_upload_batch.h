@@ -0,0 +1,40 @@
+#pragma once
+
+#include "deco_buffer.h"
+#include "deco_device.h"
+
+#include <mutex>
+#include <vector>
+
+namespace Deco
+{
+	// Gathers the buffers written during a frame and flushes all of their dirty ranges with a single
+	// vkFlushMappedMemoryRanges call. Coherent buffers (see DecoBuffer::uploadMemoryCandidates) have
+	// nothing to flush and cost nothing here.
+	class DecoUploadBatch
+	{
+	public:
+		DecoUploadBatch(DecoDevice& device) : m_deco_device(device) {}
+
+		DecoUploadBatch(const DecoUploadBatch&) = delete;
+		DecoUploadBatch& operator=(const DecoUploadBatch&) = delete;
+
+		// after writing it (writeToBuffer or markDirty); adding a buffer twice is harmless. Thread safe.
+		void add(DecoBuffer& buffer);
+
+		// before the frame's command buffer is submitted
+		VkResult flush();
+
+		// ranges passed to the last flush
+		uint32_t getFlushedRangeCount() const { return m_flushed_range_count; }
+
+	private:
+		DecoDevice& m_deco_device;
+
+		std::mutex m_mutex;
+		std::vector<DecoBuffer*> m_buffers;
+		std::vector<VkMappedMemoryRange> m_ranges;
+
+		uint32_t m_flushed_range_count{ 0 };
+	};
+}
@@ -0,0 +1,164 @@
+#include "deco_bindless_heap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace Deco
+{
+	uint32_t DecoBindlessHeap::SlotAllocator::allocate()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_free.empty())
+		{
+			const uint32_t slot = m_free.back();
+			m_free.pop_back();
+			return slot;
+		}
+		return m_next < m_capacity ? m_next++ : INVALID_SLOT;
+	}
+
+	void DecoBindlessHeap::SlotAllocator::free(uint32_t slot)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_free.push_back(slot);
+	}
+
+	DecoBindlessHeap::DecoBindlessHeap(DecoDevice& device, uint32_t other_set_resources, uint32_t max_storage_buffers, uint32_t max_sampled_images)
+		: m_deco_device(device)
+	{
+		if (!m_deco_device.supportsBindless())
+		{
+			throw std::runtime_error("Bindless descriptors need descriptor indexing support");
+		}
+
+		const auto& limits = m_deco_device.getDescriptorIndexingProperties();
+		m_storage_buffer_slots = std::make_shared<SlotAllocator>();
+		m_storage_buffer_slots->m_capacity = std::min({
+			max_storage_buffers,
+			limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+		m_sampled_image_slots = std::make_shared<SlotAllocator>();
+		m_sampled_image_slots->m_capacity = std::min({
+			max_sampled_images,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+		// both arrays are visible to every stage, together they must fit the per stage resource limit
+		const uint32_t resource_budget = limits.maxPerStageUpdateAfterBindResources > other_set_resources ?
+			limits.maxPerStageUpdateAfterBindResources - other_set_resources : 0;
+		if (m_storage_buffer_slots->m_capacity + m_sampled_image_slots->m_capacity > resource_budget)
+		{
+			m_storage_buffer_slots->m_capacity = std::min(m_storage_buffer_slots->m_capacity, resource_budget / 2);
+			m_sampled_image_slots->m_capacity = std::min(m_sampled_image_slots->m_capacity, resource_budget - m_storage_buffer_slots->m_capacity);
+		}
+		if (m_storage_buffer_slots->m_capacity == 0 || m_sampled_image_slots->m_capacity == 0)
+		{
+			throw std::runtime_error("Device limits leave no room for a bindless heap");
+		}
+
+		// slots are filled in any order and rewritten while earlier frames are still executing
+		const VkDescriptorBindingFlags binding_flags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		const VkShaderStageFlags stages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+		m_set_layout = DecoDescriptorSetLayout::Builder(m_deco_device)
+			.addBinding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, m_storage_buffer_slots->m_capacity, binding_flags)
+			.addBinding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stages, m_sampled_image_slots->m_capacity,
+				binding_flags | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
+			.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.build();
+
+		m_pool = DecoDescriptorPool::Builder(m_deco_device)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_storage_buffer_slots->m_capacity)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_sampled_image_slots->m_capacity)
+			.build();
+
+		if (!m_pool->allocateDescriptor(m_set_layout->getDescriptorSetLayout(), m_descriptor_set, m_sampled_image_slots->m_capacity))
+		{
+			throw std::runtime_error("Failed to allocate the bindless descriptor set");
+		}
+
+		std::cout << "Bindless heap: " << m_storage_buffer_slots->m_capacity << " storage buffers, "
+			<< m_sampled_image_slots->m_capacity << " sampled images" << std::endl;
+	}
+
+	uint32_t DecoBindlessHeap::addStorageBuffer(const VkDescriptorBufferInfo& buffer_info)
+	{
+		const uint32_t slot = m_storage_buffer_slots->allocate();
+		if (slot == INVALID_SLOT)
+		{
+			throw std::runtime_error("Bindless heap is out of storage buffer slots");
+		}
+		write(STORAGE_BUFFER_BINDING, slot, &buffer_info, nullptr);
+		return slot;
+	}
+
+	uint32_t DecoBindlessHeap::addSampledImage(const VkDescriptorImageInfo& image_info)
+	{
+		const uint32_t slot = m_sampled_image_slots->allocate();
+		if (slot == INVALID_SLOT)
+		{
+			throw std::runtime_error("Bindless heap is out of sampled image slots");
+		}
+		write(SAMPLED_IMAGE_BINDING, slot, nullptr, &image_info);
+		return slot;
+	}
+
+	void DecoBindlessHeap::updateStorageBuffer(uint32_t slot, const VkDescriptorBufferInfo& buffer_info)
+	{
+		assert(slot < m_storage_buffer_slots->m_capacity && "Storage buffer slot out of range");
+		write(STORAGE_BUFFER_BINDING, slot, &buffer_info, nullptr);
+	}
+
+	void DecoBindlessHeap::updateSampledImage(uint32_t slot, const VkDescriptorImageInfo& image_info)
+	{
+		assert(slot < m_sampled_image_slots->m_capacity && "Sampled image slot out of range");
+		write(SAMPLED_IMAGE_BINDING, slot, nullptr, &image_info);
+	}
+
+	void DecoBindlessHeap::releaseStorageBuffer(uint32_t slot)
+	{
+		release(m_storage_buffer_slots, slot);
+	}
+
+	void DecoBindlessHeap::releaseSampledImage(uint32_t slot)
+	{
+		release(m_sampled_image_slots, slot);
+	}
+
+	void DecoBindlessHeap::release(const std::shared_ptr<SlotAllocator>& slots, uint32_t slot)
+	{
+		if (slot == INVALID_SLOT)
+		{
+			return;
+		}
+		assert(slot < slots->m_capacity && "Bindless slot out of range");
+
+		// the descriptor stays as it is (partially bound), only reuse has to wait for the GPU
+		m_deco_device.getDeletionQueue().push([slots, slot]() { slots->free(slot); });
+	}
+
+	void DecoBindlessHeap::write(uint32_t binding, uint32_t slot, const VkDescriptorBufferInfo* buffer_info, const VkDescriptorImageInfo* image_info)
+	{
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptor_set;
+		write.dstBinding = binding;
+		write.dstArrayElement = slot;
+		write.descriptorCount = 1;
+		write.descriptorType = binding == STORAGE_BUFFER_BINDING ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pBufferInfo = buffer_info;
+		write.pImageInfo = image_info;
+
+		std::lock_guard<std::mutex> lock(m_write_mutex);
+		vkUpdateDescriptorSets(m_deco_device.device(), 1, &write, 0, nullptr);
+	}
+}
@@ -8,6 +8,7 @@
 #include "deco_buffer.h"
 
  // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -36,20 +37,109 @@ namespace Deco {
         VkBufferUsageFlags usage_flags,
         VkMemoryPropertyFlags memory_property_flags,
         VkDeviceSize min_offset_alignment)
-        : m_device{ device },
+        : m_device{ &device },
         m_instance_size{ instance_size },
         m_instance_count{ instance_count },
         m_usage_flags{ usage_flags },
         m_memory_property_flags{ memory_property_flags } {
         m_alignment_size = getAlignment(instance_size, min_offset_alignment);
         m_buffer_size = m_alignment_size * instance_count;
-        device.createBuffer(m_buffer_size, usage_flags, memory_property_flags, buffer, memory);
+        device.createBuffer(
+            m_buffer_size,
+            usage_flags,
+            memory_property_flags,
+            buffer,
+            memory,
+            DecoMemoryManager::categoryForBufferUsage(usage_flags));
+    }
+
+    DecoBuffer::DecoBuffer(
+        DecoDevice& device,
+        VkDeviceSize instance_size,
+        uint32_t instance_count,
+        VkBufferUsageFlags usage_flags,
+        const std::vector<VkMemoryPropertyFlags>& memory_candidates,
+        VkDeviceSize min_offset_alignment)
+        : m_device{ &device },
+        m_instance_size{ instance_size },
+        m_instance_count{ instance_count },
+        m_usage_flags{ usage_flags } {
+        m_alignment_size = getAlignment(instance_size, min_offset_alignment);
+        m_buffer_size = m_alignment_size * instance_count;
+        m_memory_property_flags = device.createBuffer(
+            m_buffer_size,
+            usage_flags,
+            memory_candidates,
+            buffer,
+            memory,
+            DecoMemoryManager::categoryForBufferUsage(usage_flags));
+    }
+
+    std::vector<VkMemoryPropertyFlags> DecoBuffer::uploadMemoryCandidates() {
+        return {
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        };
     }
 
     DecoBuffer::~DecoBuffer() {
+        release();
+    }
+
+    DecoBuffer::DecoBuffer(DecoBuffer&& other) noexcept
+        : m_device{ other.m_device },
+        mapped{ other.mapped },
+        buffer{ other.buffer },
+        memory{ other.memory },
+        m_buffer_size{ other.m_buffer_size },
+        m_instance_count{ other.m_instance_count },
+        m_instance_size{ other.m_instance_size },
+        m_alignment_size{ other.m_alignment_size },
+        m_usage_flags{ other.m_usage_flags },
+        m_memory_property_flags{ other.m_memory_property_flags },
+        dirtyRanges{ std::move(other.dirtyRanges) } {
+        other.mapped = nullptr;
+        other.buffer = VK_NULL_HANDLE;
+        other.memory = VK_NULL_HANDLE;
+    }
+
+    DecoBuffer& DecoBuffer::operator=(DecoBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+
+            m_device = other.m_device;
+            mapped = other.mapped;
+            buffer = other.buffer;
+            memory = other.memory;
+            m_buffer_size = other.m_buffer_size;
+            m_instance_count = other.m_instance_count;
+            m_instance_size = other.m_instance_size;
+            m_alignment_size = other.m_alignment_size;
+            m_usage_flags = other.m_usage_flags;
+            m_memory_property_flags = other.m_memory_property_flags;
+            dirtyRanges = std::move(other.dirtyRanges);
+
+            other.mapped = nullptr;
+            other.buffer = VK_NULL_HANDLE;
+            other.memory = VK_NULL_HANDLE;
+        }
+        return *this;
+    }
+
+    /**
+     * Destroys the owned buffer and memory, leaving this object empty
+     */
+    void DecoBuffer::release() {
         unmap();
-        vkDestroyBuffer(m_device.device(), buffer, nullptr);
-        vkFreeMemory(m_device.device(), memory, nullptr);
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(m_device->device(), buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+        }
+        if (memory != VK_NULL_HANDLE) {
+            m_device->getMemoryManager().free(memory);
+            memory = VK_NULL_HANDLE;
+        }
     }
 
     /**
@@ -63,7 +153,7 @@ namespace Deco {
      */
     VkResult DecoBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
         assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(m_device.device(), memory, offset, size, 0, &mapped);
+        return vkMapMemory(m_device->device(), memory, offset, size, 0, &mapped);
     }
 
     /**
@@ -73,7 +163,7 @@ namespace Deco {
      */
     void DecoBuffer::unmap() {
         if (mapped) {
-            vkUnmapMemory(m_device.device(), memory);
+            vkUnmapMemory(m_device->device(), memory);
             mapped = nullptr;
         }
     }
@@ -98,6 +188,92 @@ namespace Deco {
             mem_offset += offset;
             memcpy(mem_offset, data, size);
         }
+        markDirty(size, offset);
+    }
+
+    /**
+     * Records a written range for the next flushDirty / DecoUploadBatch flush
+     *
+     * @param size (Optional) Size of the written range. Pass VK_WHOLE_SIZE for the rest of the buffer.
+     * @param offset (Optional) Byte offset from beginning
+     */
+    void DecoBuffer::markDirty(VkDeviceSize size, VkDeviceSize offset) {
+        if (isCoherent()) {
+            return;
+        }
+        const VkDeviceSize end = size == VK_WHOLE_SIZE ? m_buffer_size : offset + size;
+        assert(offset < end && end <= m_buffer_size && "Dirty range outside of the buffer");
+        dirtyRanges.push_back({ offset, end });
+    }
+
+    /**
+     * Appends the dirty ranges to ranges, widened to nonCoherentAtomSize and merged where they touch
+     *
+     * @param ranges Ranges for a single vkFlushMappedMemoryRanges call, possibly of several buffers
+     */
+    void DecoBuffer::collectDirtyRanges(std::vector<VkMappedMemoryRange>& ranges) {
+        if (dirtyRanges.empty()) {
+            return;
+        }
+
+        const VkDeviceSize atomSize = m_device->properties.limits.nonCoherentAtomSize;
+        for (auto& range : dirtyRanges) {
+            range.first = range.first / atomSize * atomSize;
+            range.second = getAlignment(range.second, atomSize);
+        }
+        std::sort(dirtyRanges.begin(), dirtyRanges.end());
+
+        VkDeviceSize begin = dirtyRanges[0].first;
+        VkDeviceSize end = dirtyRanges[0].second;
+        for (size_t i = 1; i <= dirtyRanges.size(); i++) {
+            if (i < dirtyRanges.size() && dirtyRanges[i].first <= end) {
+                end = std::max(end, dirtyRanges[i].second);
+                continue;
+            }
+            ranges.push_back(alignedRange(end - begin, begin));
+            if (i < dirtyRanges.size()) {
+                begin = dirtyRanges[i].first;
+                end = dirtyRanges[i].second;
+            }
+        }
+        dirtyRanges.clear();
+    }
+
+    /**
+     * Flushes every range written since the last flush with a single call
+     *
+     * @return VkResult of the flush call
+     */
+    VkResult DecoBuffer::flushDirty() {
+        std::vector<VkMappedMemoryRange> ranges;
+        collectDirtyRanges(ranges);
+        if (ranges.empty()) {
+            return VK_SUCCESS;
+        }
+        return vkFlushMappedMemoryRanges(m_device->device(), static_cast<uint32_t>(ranges.size()), ranges.data());
+    }
+
+    /**
+     * Widens a range to nonCoherentAtomSize as flushes and invalidates require
+     *
+     * @note The allocation may be larger than the buffer, so a range that would reach past the buffer's
+     * end becomes VK_WHOLE_SIZE instead of being clamped to an unaligned size
+     */
+    VkMappedMemoryRange DecoBuffer::alignedRange(VkDeviceSize size, VkDeviceSize offset) const {
+        const VkDeviceSize atomSize = m_device->properties.limits.nonCoherentAtomSize;
+
+        VkMappedMemoryRange mapped_range = {};
+        mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mapped_range.memory = memory;
+        mapped_range.offset = offset / atomSize * atomSize;
+        mapped_range.size = VK_WHOLE_SIZE;
+        if (size != VK_WHOLE_SIZE) {
+            const VkDeviceSize end = getAlignment(offset + size, atomSize);
+            if (end < m_buffer_size) {
+                mapped_range.size = end - mapped_range.offset;
+            }
+        }
+        return mapped_range;
     }
 
     /**
@@ -112,12 +288,14 @@ namespace Deco {
      * @return VkResult of the flush call
      */
     VkResult DecoBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mapped_range = {};
-        mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory = memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
-        return vkFlushMappedMemoryRanges(m_device.device(), 1, &mapped_range);
+        if (isCoherent()) {
+            return VK_SUCCESS;
+        }
+        if (size == VK_WHOLE_SIZE && offset == 0) {
+            dirtyRanges.clear();
+        }
+        VkMappedMemoryRange mapped_range = alignedRange(size, offset);
+        return vkFlushMappedMemoryRanges(m_device->device(), 1, &mapped_range);
     }
 
     /**
@@ -132,12 +310,11 @@ namespace Deco {
      * @return VkResult of the invalidate call
      */
     VkResult DecoBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mapped_range = {};
-        mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory = memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
-        return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &mapped_range);
+        if (isCoherent()) {
+            return VK_SUCCESS;
+        }
+        VkMappedMemoryRange mapped_range = alignedRange(size, offset);
+        return vkInvalidateMappedMemoryRanges(m_device->device(), 1, &mapped_range);
     }
 
     /**
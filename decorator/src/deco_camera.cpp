@@ -20,6 +20,8 @@ namespace Deco
 		m_projection_matrix[3][0] = -(right + left) / (right - left);
 		m_projection_matrix[3][1] = -(bottom + top) / (bottom - top);
 		m_projection_matrix[3][2] = -near / (far - near);
+		m_near = near;
+		m_far = far;
 	}
 
 	void DecoCamera::setPerspectiveProjection(
@@ -36,6 +38,27 @@ namespace Deco
 		m_projection_matrix[2][2] = far / (far - near);
 		m_projection_matrix[2][3] = 1.f;
 		m_projection_matrix[3][2] = -(far * near) / (far - near);
+		m_near = near;
+		m_far = far;
+	}
+
+	std::array<glm::vec3, 8> DecoCamera::getFrustumCorners(float near, float far) const
+	{
+		// view space x and y at depth z span z / projection scale, the camera looks down +z
+		const glm::mat4 inverse_view = glm::inverse(m_view_matrix);
+		const glm::vec2 extent_per_depth{ 1.0f / m_projection_matrix[0][0], 1.0f / m_projection_matrix[1][1] };
+
+		std::array<glm::vec3, 8> corners{};
+		const float depths[2] = { near, far };
+		for (int i = 0; i < 8; i++)
+		{
+			const float depth = depths[i / 4];
+			const float x = (i & 1) ? 1.0f : -1.0f;
+			const float y = (i & 2) ? 1.0f : -1.0f;
+			const glm::vec4 corner_view{ x * extent_per_depth.x * depth, y * extent_per_depth.y * depth, depth, 1.0f };
+			corners[i] = glm::vec3(inverse_view * corner_view);
+		}
+		return corners;
 	}
 
 	void DecoCamera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up)
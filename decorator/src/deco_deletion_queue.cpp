@@ -0,0 +1,77 @@
+#include "deco_deletion_queue.h"
+
+#include <vector>
+
+namespace Deco
+{
+	DecoDeletionQueue::~DecoDeletionQueue()
+	{
+		flush();
+	}
+
+	void DecoDeletionQueue::push(std::function<void()> deleter)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.push_back({ m_current_frame, std::move(deleter) });
+	}
+
+	void DecoDeletionQueue::setCurrentFrame(uint64_t frame_number)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_current_frame = frame_number;
+	}
+
+	uint64_t DecoDeletionQueue::getCurrentFrame() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_current_frame;
+	}
+
+	void DecoDeletionQueue::collect(uint64_t completed_frame_count)
+	{
+		// frame tags only grow, so the ready entries are always at the front
+		std::vector<std::function<void()>> deleters;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			while (!m_entries.empty() && m_entries.front().m_frame < completed_frame_count)
+			{
+				deleters.push_back(std::move(m_entries.front().m_deleter));
+				m_entries.pop_front();
+			}
+		}
+
+		// run outside the lock, a deleter may release further objects
+		for (auto& deleter : deleters)
+		{
+			deleter();
+		}
+	}
+
+	void DecoDeletionQueue::flush()
+	{
+		while (true)
+		{
+			std::deque<Entry> entries;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				entries.swap(m_entries);
+			}
+
+			if (entries.empty())
+			{
+				return;
+			}
+
+			for (auto& entry : entries)
+			{
+				entry.m_deleter();
+			}
+		}
+	}
+
+	size_t DecoDeletionQueue::size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+}
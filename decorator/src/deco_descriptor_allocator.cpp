@@ -0,0 +1,156 @@
+#include "deco_descriptor_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Deco
+{
+	DecoDescriptorAllocator::DecoDescriptorAllocator(
+		DecoDevice& device,
+		uint32_t frames_in_flight,
+		uint32_t initial_sets_per_pool,
+		const std::vector<DecoDescriptorPoolRatio>& ratios) :
+		m_deco_device(device),
+		m_ratios(ratios),
+		m_transient(frames_in_flight),
+		m_sets_per_pool(std::min(initial_sets_per_pool, MAX_SETS_PER_POOL))
+	{
+		assert(!m_ratios.empty() && "Descriptor allocator needs at least one pool size ratio");
+	}
+
+	DecoDescriptorAllocator::~DecoDescriptorAllocator()
+	{
+		auto destroy = [this](std::vector<VkDescriptorPool>& pools)
+		{
+			for (auto pool : pools)
+			{
+				vkDestroyDescriptorPool(m_deco_device.device(), pool, nullptr);
+			}
+		};
+
+		destroy(m_persistent.m_pools);
+		for (auto& frame : m_transient)
+		{
+			destroy(frame.m_pools);
+		}
+		destroy(m_spare_pools);
+	}
+
+	std::vector<DecoDescriptorPoolRatio> DecoDescriptorAllocator::defaultRatios()
+	{
+		return {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+		};
+	}
+
+	VkDescriptorSet DecoDescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t variable_descriptor_count)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return allocateFrom(m_persistent, layout, variable_descriptor_count);
+	}
+
+	VkDescriptorSet DecoDescriptorAllocator::allocateTransient(uint32_t frame_index, VkDescriptorSetLayout layout, uint32_t variable_descriptor_count)
+	{
+		assert(frame_index < m_transient.size() && "Frame index out of range");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return allocateFrom(m_transient[frame_index], layout, variable_descriptor_count);
+	}
+
+	void DecoDescriptorAllocator::resetFrame(uint32_t frame_index)
+	{
+		assert(frame_index < m_transient.size() && "Frame index out of range");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto pool : m_transient[frame_index].m_pools)
+		{
+			vkResetDescriptorPool(m_deco_device.device(), pool, 0);
+			m_spare_pools.push_back(pool);
+		}
+		m_transient[frame_index].m_pools.clear();
+	}
+
+	size_t DecoDescriptorAllocator::getPoolCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pool_count;
+	}
+
+	VkDescriptorSet DecoDescriptorAllocator::allocateFrom(PoolList& pools, VkDescriptorSetLayout layout, uint32_t variable_descriptor_count)
+	{
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info{};
+		variable_count_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+		variable_count_info.descriptorSetCount = 1;
+		variable_count_info.pDescriptorCounts = &variable_descriptor_count;
+
+		VkDescriptorSetAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.pNext = variable_descriptor_count > 0 ? &variable_count_info : nullptr;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+
+		// at most one retry: a set that does not fit a fresh pool will not fit the next one either
+		for (int attempt = 0; attempt < 2; attempt++)
+		{
+			if (pools.m_pools.empty() || attempt > 0)
+			{
+				pools.m_pools.push_back(acquirePool());
+			}
+			alloc_info.descriptorPool = pools.m_pools.back();
+
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			VkResult result = vkAllocateDescriptorSets(m_deco_device.device(), &alloc_info, &set);
+			if (result == VK_SUCCESS)
+			{
+				return set;
+			}
+			if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+			{
+				break;
+			}
+		}
+		throw std::runtime_error("Failed to allocate descriptor set");
+	}
+
+	VkDescriptorPool DecoDescriptorAllocator::acquirePool()
+	{
+		if (!m_spare_pools.empty())
+		{
+			VkDescriptorPool pool = m_spare_pools.back();
+			m_spare_pools.pop_back();
+			return pool;
+		}
+
+		VkDescriptorPool pool = createPool(m_sets_per_pool);
+		m_sets_per_pool = std::min(m_sets_per_pool + m_sets_per_pool / 2, MAX_SETS_PER_POOL);
+		return pool;
+	}
+
+	VkDescriptorPool DecoDescriptorAllocator::createPool(uint32_t set_count)
+	{
+		std::vector<VkDescriptorPoolSize> pool_sizes;
+		for (const auto& ratio : m_ratios)
+		{
+			pool_sizes.push_back({ ratio.m_type, std::max(1u, static_cast<uint32_t>(ratio.m_ratio * set_count)) });
+		}
+
+		VkDescriptorPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.maxSets = set_count;
+		pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+		pool_info.pPoolSizes = pool_sizes.data();
+
+		VkDescriptorPool pool;
+		if (vkCreateDescriptorPool(m_deco_device.device(), &pool_info, nullptr, &pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create descriptor pool");
+		}
+		m_pool_count++;
+		return pool;
+	}
+}
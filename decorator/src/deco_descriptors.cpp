@@ -2,6 +2,7 @@
 
 // std
 #include <cassert>
+#include <cstdint>
 #include <stdexcept>
 
 namespace Deco {
@@ -12,7 +13,8 @@ namespace Deco {
 		uint32_t binding,
 		VkDescriptorType descriptorType,
 		VkShaderStageFlags stageFlags,
-		uint32_t count) {
+		uint32_t count,
+		VkDescriptorBindingFlags flags) {
 		assert(bindings.count(binding) == 0 && "Binding already in use");
 		VkDescriptorSetLayoutBinding layoutBinding{};
 		layoutBinding.binding = binding;
@@ -20,39 +22,51 @@ namespace Deco {
 		layoutBinding.descriptorCount = count;
 		layoutBinding.stageFlags = stageFlags;
 		bindings[binding] = layoutBinding;
+		if (flags != 0) {
+			bindingFlags[binding] = flags;
+		}
+		return *this;
+	}
+
+	DecoDescriptorSetLayout::Builder& DecoDescriptorSetLayout::Builder::setLayoutFlags(
+		VkDescriptorSetLayoutCreateFlags flags) {
+		layoutFlags = flags;
 		return *this;
 	}
 
 	std::unique_ptr<DecoDescriptorSetLayout> DecoDescriptorSetLayout::Builder::build() const {
-		return std::make_unique<DecoDescriptorSetLayout>(m_deco_device, bindings);
+		return std::make_unique<DecoDescriptorSetLayout>(m_deco_device, bindings, bindingFlags, layoutFlags);
 	}
 
 	// *************** Descriptor Set Layout *********************
 
 	DecoDescriptorSetLayout::DecoDescriptorSetLayout(
-		Deco::DecoDevice& deco_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-		: m_deco_device{ deco_device }, bindings{ bindings } {
+		Deco::DecoDevice& deco_device,
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+		const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+		VkDescriptorSetLayoutCreateFlags layoutFlags)
+		: m_deco_device{ deco_device }, bindings{ std::move(bindings) } {
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
-		for (auto kv : bindings) {
+		// parallel to setLayoutBindings, left empty without flags
+		std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+		for (const auto& kv : this->bindings) {
 			setLayoutBindings.push_back(kv.second);
+			if (!bindingFlags.empty()) {
+				auto flags = bindingFlags.find(kv.first);
+				setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+			}
 		}
 
-		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
-		descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-		descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
-
-		if (vkCreateDescriptorSetLayout(
-			m_deco_device.device(),
-			&descriptorSetLayoutInfo,
-			nullptr,
-			&descriptorSetLayout) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create descriptor set layout!");
-		}
+		descriptorSetLayout = m_deco_device.getLayoutCache().getDescriptorSetLayout(
+			setLayoutBindings, layoutFlags, setLayoutBindingFlags);
 	}
 
-	DecoDescriptorSetLayout::~DecoDescriptorSetLayout() {
-		vkDestroyDescriptorSetLayout(m_deco_device.device(), descriptorSetLayout, nullptr);
+	uint32_t DecoDescriptorSetLayout::getDescriptorCount() const {
+		uint32_t descriptorCount = 0;
+		for (const auto& kv : bindings) {
+			descriptorCount += kv.second.descriptorCount;
+		}
+		return descriptorCount;
 	}
 
 	// *************** Descriptor Pool Builder *********************
@@ -103,15 +117,24 @@ namespace Deco {
 	}
 
 	bool DecoDescriptorPool::allocateDescriptor(
-		const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const {
+		const VkDescriptorSetLayout descriptorSetLayout,
+		VkDescriptorSet& descriptor,
+		uint32_t variableDescriptorCount) const {
 		VkDescriptorSetAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		allocInfo.descriptorPool = descriptorPool;
 		allocInfo.pSetLayouts = &descriptorSetLayout;
 		allocInfo.descriptorSetCount = 1;
 
-		// Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-		// a new pool whenever an old pool fills up. But this is beyond our current scope
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+		variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+		variableCountInfo.descriptorSetCount = 1;
+		variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+		if (variableDescriptorCount > 0) {
+			allocInfo.pNext = &variableCountInfo;
+		}
+
+		// a fixed pool just reports failure, DecoDescriptorAllocator grows a new pool and retries instead
 		if (vkAllocateDescriptorSets(m_deco_device.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
 			return false;
 		}
@@ -133,7 +156,10 @@ namespace Deco {
 	// *************** Descriptor Writer *********************
 
 	DecoDescriptorWriter::DecoDescriptorWriter(DecoDescriptorSetLayout& setLayout, DecoDescriptorPool& pool)
-		: setLayout{ setLayout }, pool{ pool } {}
+		: setLayout{ setLayout }, pool{ &pool } {}
+
+	DecoDescriptorWriter::DecoDescriptorWriter(DecoDescriptorSetLayout& setLayout, DecoDescriptorAllocator& allocator)
+		: setLayout{ setLayout }, allocator{ &allocator } {}
 
 	DecoDescriptorWriter& DecoDescriptorWriter::writeBuffer(
 		uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
@@ -178,8 +204,10 @@ namespace Deco {
 	}
 
 	bool DecoDescriptorWriter::build(VkDescriptorSet& set) {
-		bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
-		if (!success) {
+		if (allocator != nullptr) {
+			set = allocator->allocate(setLayout.getDescriptorSetLayout());
+		}
+		else if (!pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)) {
 			return false;
 		}
 		overwrite(set);
@@ -190,7 +218,218 @@ namespace Deco {
 		for (auto& write : writes) {
 			write.dstSet = set;
 		}
-		vkUpdateDescriptorSets(pool.m_deco_device.device(), writes.size(), writes.data(), 0, nullptr);
+		vkUpdateDescriptorSets(setLayout.m_deco_device.device(), writes.size(), writes.data(), 0, nullptr);
+	}
+
+	bool DecoDescriptorWriter::build(VkDescriptorSet& set, DecoDescriptorBatchWriter& batch) {
+		if (allocator != nullptr) {
+			set = allocator->allocate(setLayout.getDescriptorSetLayout());
+		}
+		else if (!pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)) {
+			return false;
+		}
+		overwrite(set, batch);
+		return true;
+	}
+
+	void DecoDescriptorWriter::overwrite(VkDescriptorSet set, DecoDescriptorBatchWriter& batch) const {
+		for (const auto& write : writes) {
+			if (write.pImageInfo != nullptr) {
+				batch.writeImage(set, write.dstBinding, write.descriptorType, *write.pImageInfo);
+			}
+			else {
+				batch.writeBuffer(set, write.dstBinding, write.descriptorType, *write.pBufferInfo);
+			}
+		}
+	}
+
+	// *************** Descriptor Batch Writer *********************
+
+	DecoDescriptorBatchWriter& DecoDescriptorBatchWriter::writeBuffer(
+		VkDescriptorSet set,
+		uint32_t binding,
+		VkDescriptorType descriptorType,
+		const VkDescriptorBufferInfo& bufferInfo,
+		uint32_t arrayElement) {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = arrayElement;
+		write.descriptorType = descriptorType;
+		write.descriptorCount = 1;
+
+		writes.push_back(write);
+		infoRefs.push_back({ false, bufferInfos.size() });
+		bufferInfos.push_back(bufferInfo);
+		return *this;
+	}
+
+	DecoDescriptorBatchWriter& DecoDescriptorBatchWriter::writeImage(
+		VkDescriptorSet set,
+		uint32_t binding,
+		VkDescriptorType descriptorType,
+		const VkDescriptorImageInfo& imageInfo,
+		uint32_t arrayElement) {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = arrayElement;
+		write.descriptorType = descriptorType;
+		write.descriptorCount = 1;
+
+		writes.push_back(write);
+		infoRefs.push_back({ true, imageInfos.size() });
+		imageInfos.push_back(imageInfo);
+		return *this;
+	}
+
+	void DecoDescriptorBatchWriter::submit() {
+		if (writes.empty()) {
+			return;
+		}
+
+		for (size_t i = 0; i < writes.size(); i++) {
+			if (infoRefs[i].isImage) {
+				writes[i].pImageInfo = &imageInfos[infoRefs[i].index];
+			}
+			else {
+				writes[i].pBufferInfo = &bufferInfos[infoRefs[i].index];
+			}
+		}
+		vkUpdateDescriptorSets(
+			m_deco_device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+		writes.clear();
+		infoRefs.clear();
+		bufferInfos.clear();
+		imageInfos.clear();
+	}
+
+	// *************** Descriptor Update Template Builder *********************
+
+	// which info struct a descriptor of this type is written from
+	enum class DescriptorInfoKind { Buffer, TexelBufferView, Image };
+
+	static DescriptorInfoKind descriptorInfoKind(VkDescriptorType descriptorType) {
+		switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			return DescriptorInfoKind::Buffer;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			return DescriptorInfoKind::TexelBufferView;
+		default:
+			return DescriptorInfoKind::Image;
+		}
+	}
+
+	static size_t descriptorInfoSize(VkDescriptorType descriptorType) {
+		switch (descriptorInfoKind(descriptorType)) {
+		case DescriptorInfoKind::Buffer:
+			return sizeof(VkDescriptorBufferInfo);
+		case DescriptorInfoKind::TexelBufferView:
+			return sizeof(VkBufferView);
+		default:
+			return sizeof(VkDescriptorImageInfo);
+		}
+	}
+
+	DecoDescriptorUpdateTemplate::Builder& DecoDescriptorUpdateTemplate::Builder::addEntry(
+		uint32_t binding, size_t offset, uint32_t count, size_t stride) {
+		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+		auto& bindingDescription = setLayout.bindings[binding];
+		assert(count <= bindingDescription.descriptorCount && "More descriptors than the binding holds");
+
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding = binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = count;
+		entry.descriptorType = bindingDescription.descriptorType;
+		entry.offset = offset;
+		entry.stride = stride != 0 ? stride : descriptorInfoSize(bindingDescription.descriptorType);
+		entries.push_back(entry);
+		return *this;
+	}
+
+	std::unique_ptr<DecoDescriptorUpdateTemplate> DecoDescriptorUpdateTemplate::Builder::build() const {
+		return std::make_unique<DecoDescriptorUpdateTemplate>(m_deco_device, setLayout, entries);
+	}
+
+	// *************** Descriptor Update Template *********************
+
+	DecoDescriptorUpdateTemplate::DecoDescriptorUpdateTemplate(
+		DecoDevice& deco_device,
+		DecoDescriptorSetLayout& setLayout,
+		const std::vector<VkDescriptorUpdateTemplateEntry>& entries)
+		: m_deco_device{ deco_device }, entries{ entries } {
+		assert(!entries.empty() && "Update template without entries");
+		if (!m_deco_device.supportsDescriptorUpdateTemplates()) {
+			return;
+		}
+
+		VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+		templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(this->entries.size());
+		templateInfo.pDescriptorUpdateEntries = this->entries.data();
+		templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateInfo.descriptorSetLayout = setLayout.getDescriptorSetLayout();
+
+		if (vkCreateDescriptorUpdateTemplate(
+			m_deco_device.device(),
+			&templateInfo,
+			nullptr,
+			&updateTemplate) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor update template!");
+		}
+	}
+
+	DecoDescriptorUpdateTemplate::~DecoDescriptorUpdateTemplate() {
+		if (updateTemplate != VK_NULL_HANDLE) {
+			vkDestroyDescriptorUpdateTemplate(m_deco_device.device(), updateTemplate, nullptr);
+		}
+	}
+
+	void DecoDescriptorUpdateTemplate::update(VkDescriptorSet set, const void* data) const {
+		if (updateTemplate != VK_NULL_HANDLE) {
+			vkUpdateDescriptorSetWithTemplate(m_deco_device.device(), set, updateTemplate, data);
+			return;
+		}
+
+		// one write per descriptor, the strided infos are not contiguous arrays
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		std::vector<VkWriteDescriptorSet> writes{};
+		for (const auto& entry : entries) {
+			for (uint32_t i = 0; i < entry.descriptorCount; i++) {
+				const uint8_t* info = bytes + entry.offset + i * entry.stride;
+
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = set;
+				write.dstBinding = entry.dstBinding;
+				write.dstArrayElement = entry.dstArrayElement + i;
+				write.descriptorType = entry.descriptorType;
+				write.descriptorCount = 1;
+				switch (descriptorInfoKind(entry.descriptorType)) {
+				case DescriptorInfoKind::Buffer:
+					write.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(info);
+					break;
+				case DescriptorInfoKind::TexelBufferView:
+					write.pTexelBufferView = reinterpret_cast<const VkBufferView*>(info);
+					break;
+				default:
+					write.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(info);
+					break;
+				}
+				writes.push_back(write);
+			}
+		}
+		vkUpdateDescriptorSets(
+			m_deco_device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 	}
 
 }  // namespace lve
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "deco_device.h"
 
 // std headers
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -55,9 +57,20 @@ namespace Deco {
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+		memoryManager = std::make_unique<DecoMemoryManager>(physicalDevice, device_, memoryBudgetSupported);
+		layoutCache = std::make_unique<DecoLayoutCache>(device_);
+		samplerCache = std::make_unique<DecoSamplerCache>(device_, properties);
 	}
 
 	DecoDevice::~DecoDevice() {
+		// whatever is still queued references this device, destroy it while the device exists
+		waitIdle();
+		deletionQueue.flush();
+		samplerCache.reset();
+		layoutCache.reset();
+		memoryManager.reset();
+
+		vkDestroyCommandPool(device_, singleTimeCommandPool, nullptr);
 		vkDestroyCommandPool(device_, commandPool, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
@@ -80,7 +93,22 @@ namespace Deco {
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		// vkEnumerateInstanceVersion only exists on 1.1+ loaders; 1.3 has dynamic rendering in core,
+		// 1.2 has everything VK_KHR_dynamic_rendering depends on
+		uint32_t loaderVersion = VK_API_VERSION_1_0;
+		auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+			vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+		if (enumerateInstanceVersion != nullptr) {
+			enumerateInstanceVersion(&loaderVersion);
+		}
+
+		if (loaderVersion >= VK_API_VERSION_1_3) {
+			instanceApiVersion = VK_API_VERSION_1_3;
+		}
+		else if (loaderVersion >= VK_API_VERSION_1_2) {
+			instanceApiVersion = VK_API_VERSION_1_2;
+		}
+		appInfo.apiVersion = instanceApiVersion;
 
 		VkInstanceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -133,6 +161,111 @@ namespace Deco {
 
 		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 		std::cout << "physical device: " << properties.deviceName << std::endl;
+
+		queryDynamicRenderingSupport();
+		queryDescriptorIndexingSupport();
+		queryMemoryBudgetSupport();
+	}
+
+	void DecoDevice::queryDynamicRenderingSupport() {
+		const uint32_t apiVersion = std::min(instanceApiVersion, properties.apiVersion);
+		if (apiVersion < VK_API_VERSION_1_2) {
+			return;
+		}
+
+		if (apiVersion < VK_API_VERSION_1_3) {
+			uint32_t extensionCount;
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+			dynamicRenderingExtension = std::any_of(
+				availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+					return std::strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0;
+				});
+			if (!dynamicRenderingExtension) {
+				return;
+			}
+		}
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+		VkPhysicalDeviceFeatures2 features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &dynamicRenderingFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+		dynamicRenderingSupported = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+		dynamicRenderingExtension = dynamicRenderingSupported && dynamicRenderingExtension;
+		std::cout << "Dynamic rendering: "
+			<< (dynamicRenderingSupported ? (dynamicRenderingExtension ? "VK_KHR_dynamic_rendering" : "core") : "not supported")
+			<< std::endl;
+	}
+
+	void DecoDevice::queryDescriptorIndexingSupport() {
+		const uint32_t apiVersion = std::min(instanceApiVersion, properties.apiVersion);
+		if (apiVersion < VK_API_VERSION_1_2) {
+			return;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+		indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &indexingFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+		// everything DecoBindlessHeap relies on; texture slots come from per-object data and may differ
+		// within a draw's subgroup, so sampled images need non-uniform indexing
+		descriptorIndexingSupported = indexingFeatures.runtimeDescriptorArray &&
+			indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+			indexingFeatures.descriptorBindingPartiallyBound &&
+			indexingFeatures.descriptorBindingVariableDescriptorCount &&
+			indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+			indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+			indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+			features.features.shaderStorageBufferArrayDynamicIndexing &&
+			features.features.shaderSampledImageArrayDynamicIndexing;
+
+		descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 deviceProperties = {};
+		deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		deviceProperties.pNext = &descriptorIndexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties);
+		descriptorIndexingProperties.pNext = nullptr;
+
+		std::cout << "Descriptor indexing: " << (descriptorIndexingSupported ? "supported" : "not supported") << std::endl;
+	}
+
+	void DecoDevice::queryMemoryBudgetSupport() {
+		// the budget is read through vkGetPhysicalDeviceMemoryProperties2
+		const uint32_t apiVersion = std::min(instanceApiVersion, properties.apiVersion);
+		if (apiVersion < VK_API_VERSION_1_1) {
+			return;
+		}
+
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+		memoryBudgetSupported = std::any_of(
+			availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+				return std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+			});
+		std::cout << "Memory budget: " << (memoryBudgetSupported ? "VK_EXT_memory_budget" : "estimated") << std::endl;
+	}
+
+	void DecoDevice::cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo) {
+		assert(beginRendering != nullptr && "Dynamic rendering is not enabled on this device");
+		beginRendering(commandBuffer, &renderingInfo);
+	}
+
+	void DecoDevice::cmdEndRendering(VkCommandBuffer commandBuffer) {
+		assert(endRendering != nullptr && "Dynamic rendering is not enabled on this device");
+		endRendering(commandBuffer);
 	}
 
 	void DecoDevice::createLogicalDevice() {
@@ -151,8 +284,16 @@ namespace Deco {
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		textureCompressionBCSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		// DecoBindlessHeap's arrays are indexed with push constant values
+		deviceFeatures.shaderStorageBufferArrayDynamicIndexing = descriptorIndexingSupported ? VK_TRUE : VK_FALSE;
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = descriptorIndexingSupported ? VK_TRUE : VK_FALSE;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -160,9 +301,45 @@ namespace Deco {
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+
+		// optional features are chained in front of each other
+		void* featureChain = nullptr;
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+		if (dynamicRenderingSupported) {
+			dynamicRenderingFeatures.pNext = featureChain;
+			featureChain = &dynamicRenderingFeatures;
+			if (dynamicRenderingExtension) {
+				enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			}
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+		indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+		indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+		indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		if (descriptorIndexingSupported) {
+			indexingFeatures.pNext = featureChain;
+			featureChain = &indexingFeatures;
+		}
+
+		if (memoryBudgetSupported) {
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+
+		createInfo.pNext = featureChain;
+
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		// might not really be necessary anymore because device specific validation layers
 		// have been deprecated
@@ -180,6 +357,13 @@ namespace Deco {
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+		if (dynamicRenderingSupported) {
+			beginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(
+				device_, dynamicRenderingExtension ? "vkCmdBeginRenderingKHR" : "vkCmdBeginRendering"));
+			endRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(
+				device_, dynamicRenderingExtension ? "vkCmdEndRenderingKHR" : "vkCmdEndRendering"));
+		}
 	}
 
 	void DecoDevice::createCommandPool() {
@@ -191,11 +375,17 @@ namespace Deco {
 		poolInfo.flags =
 			VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-		if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS ||
+			vkCreateCommandPool(device_, &poolInfo, nullptr, &singleTimeCommandPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create command pool!");
 		}
 	}
 
+	void DecoDevice::waitIdle() {
+		auto queueLock = lockQueues();
+		vkDeviceWaitIdle(device_);
+	}
+
 	void DecoDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
 	bool DecoDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -393,17 +583,32 @@ namespace Deco {
 		throw std::runtime_error("failed to find supported format!");
 	}
 
+	VkFormatProperties DecoDevice::getFormatProperties(VkFormat format) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+		return props;
+	}
+
 	uint32_t DecoDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+		uint32_t memoryType = 0;
+		if (tryFindMemoryType(typeFilter, properties, memoryType)) {
+			return memoryType;
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	bool DecoDevice::tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& memoryType) {
 		VkPhysicalDeviceMemoryProperties memProperties;
 		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
 		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
 			if ((typeFilter & (1 << i)) &&
 				(memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
+				memoryType = i;
+				return true;
 			}
 		}
-
-		throw std::runtime_error("failed to find suitable memory type!");
+		return false;
 	}
 
 	void DecoDevice::createBuffer(
@@ -411,7 +616,18 @@ namespace Deco {
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& buffer_memory) {
+		VkDeviceMemory& buffer_memory,
+		DecoMemoryCategory category) {
+		createBuffer(size, usage, std::vector<VkMemoryPropertyFlags>{ properties }, buffer, buffer_memory, category);
+	}
+
+	VkMemoryPropertyFlags DecoDevice::createBuffer(
+		VkDeviceSize size,
+		VkBufferUsageFlags usage,
+		const std::vector<VkMemoryPropertyFlags>& candidates,
+		VkBuffer& buffer,
+		VkDeviceMemory& buffer_memory,
+		DecoMemoryCategory category) {
 		VkBufferCreateInfo buffer_info{};
 		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		buffer_info.size = size;
@@ -419,43 +635,59 @@ namespace Deco {
 		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 		if (vkCreateBuffer(device_, &buffer_info, nullptr, &buffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create vertex buffer!");
+			throw std::runtime_error("failed to create buffer!");
 		}
 
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &buffer_memory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
+		DecoMemoryManager::Allocation allocation{};
+		try {
+			allocation = memoryManager->allocate(memRequirements, candidates, category);
 		}
+		catch (...) {
+			vkDestroyBuffer(device_, buffer, nullptr);
+			buffer = VK_NULL_HANDLE;
+			throw;
+		}
+		buffer_memory = allocation.m_memory;
 
 		vkBindBufferMemory(device_, buffer, buffer_memory, 0);
+		return allocation.m_property_flags;
 	}
 
-	VkCommandBuffer DecoDevice::beginSingleTimeCommands() {
+	DecoSingleTimeCommands DecoDevice::beginSingleTimeCommands() {
+		return DecoSingleTimeCommands(*this);
+	}
+
+	DecoSingleTimeCommands::DecoSingleTimeCommands(DecoDevice& device)
+		: device{ device }, poolLock{ device.singleTimeMutex } {
+		// the pool must not be used by two threads at once, poolLock is held until destruction
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = commandPool;
+		allocInfo.commandPool = device.singleTimeCommandPool;
 		allocInfo.commandBufferCount = 1;
 
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+		if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate single time command buffer!");
+		}
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		vkBeginCommandBuffer(commandBuffer, &beginInfo);
-		return commandBuffer;
 	}
 
-	void DecoDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+	DecoSingleTimeCommands::~DecoSingleTimeCommands() {
+		// freeing a buffer that is still recording is fine, a submitted one has already completed
+		vkFreeCommandBuffers(device.device(), device.singleTimeCommandPool, 1, &commandBuffer);
+	}
+
+	void DecoSingleTimeCommands::submit() {
+		assert(!submitted && "Single time commands submitted twice");
+		submitted = true;
 		vkEndCommandBuffer(commandBuffer);
 
 		VkSubmitInfo submitInfo{};
@@ -463,28 +695,29 @@ namespace Deco {
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+		auto queueLock = device.lockQueues();
+		if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit single time command buffer!");
+		}
 		//to_do: use memory barrier to avoid idle
-		vkQueueWaitIdle(graphicsQueue_);
-
-		vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+		vkQueueWaitIdle(device.graphicsQueue());
 	}
 
 	void DecoDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		DecoSingleTimeCommands commands = beginSingleTimeCommands();
 
 		VkBufferCopy copyRegion{};
 		copyRegion.srcOffset = 0;  // Optional
 		copyRegion.dstOffset = 0;  // Optional
 		copyRegion.size = size;
-		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+		vkCmdCopyBuffer(commands.getCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
 
-		endSingleTimeCommands(commandBuffer);
+		commands.submit();
 	}
 
 	void DecoDevice::copyBufferToImage(
 		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		DecoSingleTimeCommands commands = beginSingleTimeCommands();
 
 		VkBufferImageCopy region{};
 		region.bufferOffset = 0;
@@ -500,20 +733,21 @@ namespace Deco {
 		region.imageExtent = { width, height, 1 };
 
 		vkCmdCopyBufferToImage(
-			commandBuffer,
+			commands.getCommandBuffer(),
 			buffer,
 			image,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1,
 			&region);
-		endSingleTimeCommands(commandBuffer);
+		commands.submit();
 	}
 
 	void DecoDevice::createImageWithInfo(
 		const VkImageCreateInfo& imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& imageMemory) {
+		VkDeviceMemory& imageMemory,
+		DecoMemoryCategory category) {
 		if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create image!");
 		}
@@ -521,16 +755,20 @@ namespace Deco {
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
+		try {
+			imageMemory = memoryManager->allocate(memRequirements, { properties }, category).m_memory;
+		}
+		catch (...) {
+			vkDestroyImage(device_, image, nullptr);
+			image = VK_NULL_HANDLE;
+			throw;
 		}
 
 		if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+			vkDestroyImage(device_, image, nullptr);
+			image = VK_NULL_HANDLE;
+			memoryManager->free(imageMemory);
+			imageMemory = VK_NULL_HANDLE;
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
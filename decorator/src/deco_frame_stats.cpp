@@ -0,0 +1,206 @@
+#include "deco_frame_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+namespace Deco
+{
+	// *************** Rolling Histogram *********************
+
+	void DecoRollingHistogram::add(double value_ms)
+	{
+		if (m_count == WINDOW)
+		{
+			double evicted = m_samples[m_next];
+			m_sum -= evicted;
+			m_buckets[bucketOf(evicted)]--;
+		}
+		else
+		{
+			m_count++;
+		}
+
+		m_samples[m_next] = value_ms;
+		m_sum += value_ms;
+		m_buckets[bucketOf(value_ms)]++;
+		m_next = (m_next + 1) % WINDOW;
+	}
+
+	double DecoRollingHistogram::average() const
+	{
+		return m_count > 0 ? m_sum / static_cast<double>(m_count) : 0.0;
+	}
+
+	double DecoRollingHistogram::max() const
+	{
+		if (m_count == 0)
+		{
+			return 0.0;
+		}
+		return *std::max_element(m_samples.begin(), m_samples.begin() + m_count);
+	}
+
+	double DecoRollingHistogram::percentile(double p) const
+	{
+		if (m_count == 0)
+		{
+			return 0.0;
+		}
+
+		std::vector<double> sorted(m_samples.begin(), m_samples.begin() + m_count);
+		size_t index = static_cast<size_t>(std::clamp(p, 0.0, 1.0) * static_cast<double>(m_count - 1));
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	}
+
+	size_t DecoRollingHistogram::bucketOf(double value_ms)
+	{
+		for (size_t i = 0; i < BUCKET_EDGES.size(); i++)
+		{
+			if (value_ms <= BUCKET_EDGES[i])
+			{
+				return i;
+			}
+		}
+		return BUCKET_EDGES.size() - 1;
+	}
+
+	// *************** Frame Stats *********************
+
+	const char* getFrameBoundName(DecoFrameBound bound)
+	{
+		switch (bound)
+		{
+		case DecoFrameBound::Cpu:
+			return "CPU-bound";
+		case DecoFrameBound::Gpu:
+			return "GPU-bound";
+		case DecoFrameBound::VSync:
+			return "vsync-bound";
+		case DecoFrameBound::Paced:
+			return "frame-limited";
+		default:
+			return "unknown";
+		}
+	}
+
+	void DecoFrameStats::addFrame(const DecoFrameTimings& timings)
+	{
+		m_pace.add(timings.m_pace_ms);
+		m_fence_wait.add(timings.m_fence_wait_ms);
+		m_acquire.add(timings.m_acquire_ms);
+		m_record.add(timings.m_record_ms);
+		m_submit.add(timings.m_submit_ms);
+		m_present.add(timings.m_present_ms);
+		m_frame.add(timings.m_frame_ms);
+	}
+
+	DecoFrameBound DecoFrameStats::classify() const
+	{
+		if (m_frame.count() == 0)
+		{
+			return DecoFrameBound::Unknown;
+		}
+
+		// a wait counts once it is a noticeable part of the frame, otherwise the CPU work is the limit
+		const double frame_ms = m_frame.average();
+		const double threshold_ms = frame_ms * 0.1;
+
+		const double fence_ms = m_fence_wait.average();
+		const double display_ms = m_acquire.average() + m_present.average();
+		const double pace_ms = m_pace.average();
+
+		const double largest_wait = std::max({ fence_ms, display_ms, pace_ms });
+		if (largest_wait < threshold_ms)
+		{
+			return DecoFrameBound::Cpu;
+		}
+		if (largest_wait == pace_ms)
+		{
+			return DecoFrameBound::Paced;
+		}
+		if (largest_wait == fence_ms)
+		{
+			return DecoFrameBound::Gpu;
+		}
+		return DecoFrameBound::VSync;
+	}
+
+	void DecoFrameStats::print(std::ostream& out) const
+	{
+		auto printRow = [&out](const char* name, const DecoRollingHistogram& histogram)
+		{
+			out << "  " << std::left << std::setw(11) << name << std::right << std::fixed << std::setprecision(2)
+				<< " avg " << std::setw(7) << histogram.average()
+				<< " p95 " << std::setw(7) << histogram.percentile(0.95)
+				<< " max " << std::setw(7) << histogram.max() << " |";
+			for (auto bucket : histogram.buckets())
+			{
+				out << " " << std::setw(3) << bucket;
+			}
+			out << "\n";
+		};
+
+		out << "Frame stats (ms, last " << m_frame.count() << " frames, buckets <=";
+		for (auto edge : DecoRollingHistogram::BUCKET_EDGES)
+		{
+			if (edge < 1.0e9)
+			{
+				out << " " << edge;
+			}
+		}
+		out << " inf): " << getFrameBoundName(classify()) << "\n";
+
+		printRow("frame", m_frame);
+		printRow("pace", m_pace);
+		printRow("fence wait", m_fence_wait);
+		printRow("acquire", m_acquire);
+		printRow("record", m_record);
+		printRow("submit", m_submit);
+		printRow("present", m_present);
+		out.flush();
+	}
+
+	// *************** Frame Pacer *********************
+
+	void DecoFramePacer::setTargetFrameRate(double frames_per_second)
+	{
+		if (frames_per_second <= 0.0)
+		{
+			m_interval = Clock::duration{ 0 };
+			return;
+		}
+
+		m_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frames_per_second));
+		m_next_deadline = Clock::now() + m_interval;
+	}
+
+	double DecoFramePacer::wait()
+	{
+		if (!isEnabled())
+		{
+			return 0.0;
+		}
+
+		const auto start = Clock::now();
+
+		// fell more than a whole interval behind: start over instead of rushing to catch up
+		if (start > m_next_deadline + m_interval)
+		{
+			m_next_deadline = start;
+		}
+
+		if (m_next_deadline - start > SPIN_THRESHOLD)
+		{
+			std::this_thread::sleep_until(m_next_deadline - SPIN_THRESHOLD);
+		}
+		while (Clock::now() < m_next_deadline)
+		{
+			std::this_thread::yield();
+		}
+
+		m_next_deadline += m_interval;
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
@@ -0,0 +1,48 @@
+#include "deco_frustum.h"
+
+namespace Deco
+{
+	DecoFrustum::DecoFrustum(const glm::mat4& view_projection)
+	{
+		// Gribb/Hartmann: the clip space inequalities written as rows of the matrix
+		const glm::vec4 row_x{ view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0] };
+		const glm::vec4 row_y{ view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1] };
+		const glm::vec4 row_z{ view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2] };
+		const glm::vec4 row_w{ view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3] };
+
+		m_planes[PLANE_LEFT] = row_w + row_x;
+		m_planes[PLANE_RIGHT] = row_w - row_x;
+		m_planes[PLANE_TOP] = row_w + row_y;
+		m_planes[PLANE_BOTTOM] = row_w - row_y;
+		// 0 <= z, not -w <= z
+		m_planes[PLANE_NEAR] = row_z;
+		m_planes[PLANE_FAR] = row_w - row_z;
+
+		for (auto& plane : m_planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+	bool DecoFrustum::intersectsSphere(const glm::vec4& sphere, uint32_t test_planes) const
+	{
+		const glm::vec3 center{ sphere };
+		for (uint32_t i = 0; i < PLANE_COUNT; i++)
+		{
+			if ((test_planes & (1u << i)) != 0 && glm::dot(glm::vec3(m_planes[i]), center) + m_planes[i].w < -sphere.w)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	glm::vec4 DecoFrustum::transformSphere(const glm::mat4& model_matrix, const glm::vec4& sphere)
+	{
+		const glm::vec3 center{ model_matrix * glm::vec4(glm::vec3(sphere), 1.0f) };
+		const float scale_squared = glm::max(
+			glm::max(glm::dot(glm::vec3(model_matrix[0]), glm::vec3(model_matrix[0])), glm::dot(glm::vec3(model_matrix[1]), glm::vec3(model_matrix[1]))),
+			glm::dot(glm::vec3(model_matrix[2]), glm::vec3(model_matrix[2])));
+		return glm::vec4(center, sphere.w * glm::sqrt(scale_squared));
+	}
+}
@@ -63,4 +63,13 @@ namespace Deco
 		};
 	}
 
+	DecoGameObject DecoGameObject::makePointLight(float intensity, float range, glm::vec3 color)
+	{
+		DecoGameObject object = DecoGameObject::createGameObject();
+		object.m_color = color;
+		object.m_point_light = std::make_unique<PointLightComponent>();
+		object.m_point_light->m_light_intensity = intensity;
+		object.m_point_light->m_range = range;
+		return object;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "deco_gpu_profiler.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+namespace Deco
+{
+	DecoGpuProfiler::DecoGpuProfiler(DecoDevice& device, uint32_t frames_in_flight) : m_deco_device(device)
+	{
+		m_slot_scopes.resize(frames_in_flight);
+
+		uint32_t family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_deco_device.getPhysicalDevice(), &family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_deco_device.getPhysicalDevice(), &family_count, families.data());
+
+		const uint32_t valid_bits = families[m_deco_device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+		if (valid_bits == 0)
+		{
+			return;
+		}
+		m_timestamp_mask = valid_bits >= 64 ? ~0ull : ((1ull << valid_bits) - 1);
+		m_timestamp_period_ns = static_cast<double>(m_deco_device.properties.limits.timestampPeriod);
+
+		VkQueryPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		pool_info.queryCount = frames_in_flight * MAX_SCOPES * 2;
+
+		if (vkCreateQueryPool(m_deco_device.device(), &pool_info, nullptr, &m_query_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+	}
+
+	DecoGpuProfiler::~DecoGpuProfiler()
+	{
+		vkDestroyQueryPool(m_deco_device.device(), m_query_pool, nullptr);
+	}
+
+	void DecoGpuProfiler::beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+	{
+		if (!isSupported())
+		{
+			return;
+		}
+
+		m_frame_index = frame_index;
+		collectResults(frame_index);
+		vkCmdResetQueryPool(command_buffer, m_query_pool, firstQuery(frame_index), MAX_SCOPES * 2);
+	}
+
+	uint32_t DecoGpuProfiler::beginScope(VkCommandBuffer command_buffer, const char* name)
+	{
+		auto& scopes = m_slot_scopes[m_frame_index];
+		if (!isSupported() || scopes.size() >= MAX_SCOPES)
+		{
+			return INVALID_SCOPE;
+		}
+
+		const uint32_t scope = static_cast<uint32_t>(scopes.size());
+		scopes.emplace_back(name);
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, firstQuery(m_frame_index) + scope * 2);
+		return scope;
+	}
+
+	void DecoGpuProfiler::endScope(VkCommandBuffer command_buffer, uint32_t scope)
+	{
+		if (scope == INVALID_SCOPE)
+		{
+			return;
+		}
+
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, firstQuery(m_frame_index) + scope * 2 + 1);
+	}
+
+	void DecoGpuProfiler::collectResults(uint32_t frame_index)
+	{
+		auto& scopes = m_slot_scopes[frame_index];
+		if (scopes.empty())
+		{
+			return;
+		}
+
+		// (value, availability) pairs; a scope that was begun but never ended stays unavailable
+		std::vector<uint64_t> results(scopes.size() * 2 * 2);
+		vkGetQueryPoolResults(
+			m_deco_device.device(),
+			m_query_pool,
+			firstQuery(frame_index),
+			static_cast<uint32_t>(scopes.size() * 2),
+			results.size() * sizeof(uint64_t),
+			results.data(),
+			sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		for (size_t i = 0; i < scopes.size(); i++)
+		{
+			const uint64_t* begin = &results[i * 4];
+			const uint64_t* end = &results[i * 4 + 2];
+			if (begin[1] == 0 || end[1] == 0)
+			{
+				continue;
+			}
+
+			const uint64_t ticks = ((end[0] & m_timestamp_mask) - (begin[0] & m_timestamp_mask)) & m_timestamp_mask;
+			const double elapsed_ms = static_cast<double>(ticks) * m_timestamp_period_ns * 1.0e-6;
+
+			auto it = m_scope_times.begin();
+			while (it != m_scope_times.end() && it->first != scopes[i])
+			{
+				++it;
+			}
+			if (it == m_scope_times.end())
+			{
+				m_scope_times.emplace_back(scopes[i], elapsed_ms);
+			}
+			else
+			{
+				it->second += (elapsed_ms - it->second) / 64.0;
+			}
+		}
+		scopes.clear();
+	}
+
+	void DecoGpuProfiler::print(std::ostream& out) const
+	{
+		if (!isSupported())
+		{
+			return;
+		}
+
+		out << "GPU time (ms):";
+		for (const auto& scope : m_scope_times)
+		{
+			out << " " << scope.first << " " << std::fixed << std::setprecision(3) << scope.second;
+		}
+		out << std::endl;
+	}
+}
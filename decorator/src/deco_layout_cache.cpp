@@ -0,0 +1,198 @@
+#include "deco_layout_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+
+namespace Deco
+{
+	static void hashCombine(size_t& hash, uint64_t value)
+	{
+		hash ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+
+	DecoLayoutCache::~DecoLayoutCache()
+	{
+		// pipeline layouts reference the set layouts
+		for (auto& kv : m_pipeline_layouts)
+		{
+			vkDestroyPipelineLayout(m_device, kv.second, nullptr);
+		}
+		for (auto& kv : m_set_layouts)
+		{
+			vkDestroyDescriptorSetLayout(m_device, kv.second, nullptr);
+		}
+	}
+
+	VkDescriptorSetLayout DecoLayoutCache::getDescriptorSetLayout(
+		const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+		VkDescriptorSetLayoutCreateFlags flags,
+		const std::vector<VkDescriptorBindingFlags>& binding_flags)
+	{
+		assert((binding_flags.empty() || binding_flags.size() == bindings.size()) && "One binding flag per binding");
+
+		std::vector<size_t> order(bindings.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+		SetLayoutKey key{};
+		key.m_flags = flags;
+		const bool has_binding_flags = std::any_of(binding_flags.begin(), binding_flags.end(), [](VkDescriptorBindingFlags f) { return f != 0; });
+		for (size_t index : order)
+		{
+			assert(bindings[index].pImmutableSamplers == nullptr && "Immutable samplers are not part of the layout key");
+			key.m_bindings.push_back(bindings[index]);
+			if (has_binding_flags)
+			{
+				key.m_binding_flags.push_back(binding_flags[index]);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_set_layouts.find(key);
+		if (it != m_set_layouts.end())
+		{
+			return it->second;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layout_info{};
+		layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_info.flags = key.m_flags;
+		layout_info.bindingCount = static_cast<uint32_t>(key.m_bindings.size());
+		layout_info.pBindings = key.m_bindings.data();
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+		binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		binding_flags_info.bindingCount = static_cast<uint32_t>(key.m_binding_flags.size());
+		binding_flags_info.pBindingFlags = key.m_binding_flags.data();
+		if (!key.m_binding_flags.empty())
+		{
+			layout_info.pNext = &binding_flags_info;
+		}
+
+		VkDescriptorSetLayout layout;
+		if (vkCreateDescriptorSetLayout(m_device, &layout_info, nullptr, &layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+		m_set_layouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+	VkPipelineLayout DecoLayoutCache::getPipelineLayout(
+		const std::vector<VkDescriptorSetLayout>& set_layouts,
+		const std::vector<VkPushConstantRange>& push_constant_ranges)
+	{
+		PipelineLayoutKey key{ set_layouts, push_constant_ranges };
+		std::sort(key.m_push_constant_ranges.begin(), key.m_push_constant_ranges.end(),
+			[](const VkPushConstantRange& a, const VkPushConstantRange& b)
+			{
+				return a.offset != b.offset ? a.offset < b.offset : a.stageFlags < b.stageFlags;
+			});
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_pipeline_layouts.find(key);
+		if (it != m_pipeline_layouts.end())
+		{
+			return it->second;
+		}
+
+		VkPipelineLayoutCreateInfo pipeline_layout_info{};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(key.m_set_layouts.size());
+		pipeline_layout_info.pSetLayouts = key.m_set_layouts.data();
+		pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(key.m_push_constant_ranges.size());
+		pipeline_layout_info.pPushConstantRanges = key.m_push_constant_ranges.data();
+
+		VkPipelineLayout layout;
+		if (vkCreatePipelineLayout(m_device, &pipeline_layout_info, nullptr, &layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create pipeline layout!");
+		}
+		m_pipeline_layouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+	size_t DecoLayoutCache::getDescriptorSetLayoutCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_set_layouts.size();
+	}
+
+	size_t DecoLayoutCache::getPipelineLayoutCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pipeline_layouts.size();
+	}
+
+	bool DecoLayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const
+	{
+		if (m_flags != other.m_flags || m_bindings.size() != other.m_bindings.size() || m_binding_flags != other.m_binding_flags)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < m_bindings.size(); i++)
+		{
+			const auto& a = m_bindings[i];
+			const auto& b = other.m_bindings[i];
+			if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+				a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool DecoLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+	{
+		if (m_set_layouts != other.m_set_layouts || m_push_constant_ranges.size() != other.m_push_constant_ranges.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < m_push_constant_ranges.size(); i++)
+		{
+			const auto& a = m_push_constant_ranges[i];
+			const auto& b = other.m_push_constant_ranges[i];
+			if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t DecoLayoutCache::KeyHash::operator()(const SetLayoutKey& key) const
+	{
+		size_t hash = std::hash<uint32_t>()(key.m_flags);
+		for (const auto& binding : key.m_bindings)
+		{
+			hashCombine(hash, (static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint64_t>(binding.descriptorType));
+			hashCombine(hash, (static_cast<uint64_t>(binding.descriptorCount) << 32) | static_cast<uint64_t>(binding.stageFlags));
+		}
+		for (auto flags : key.m_binding_flags)
+		{
+			hashCombine(hash, flags);
+		}
+		return hash;
+	}
+
+	size_t DecoLayoutCache::KeyHash::operator()(const PipelineLayoutKey& key) const
+	{
+		size_t hash = 0;
+		for (auto set_layout : key.m_set_layouts)
+		{
+			hashCombine(hash, reinterpret_cast<uint64_t>(set_layout));
+		}
+		for (const auto& range : key.m_push_constant_ranges)
+		{
+			hashCombine(hash, (static_cast<uint64_t>(range.offset) << 32) | static_cast<uint64_t>(range.size));
+			hashCombine(hash, range.stageFlags);
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,246 @@
+#include "deco_memory_manager.h"
+
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace Deco
+{
+	static double toMiB(VkDeviceSize bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+
+	const char* getMemoryCategoryName(DecoMemoryCategory category)
+	{
+		switch (category)
+		{
+		case DecoMemoryCategory::Mesh: return "mesh";
+		case DecoMemoryCategory::Uniform: return "uniform";
+		case DecoMemoryCategory::Storage: return "storage";
+		case DecoMemoryCategory::Depth: return "depth";
+		case DecoMemoryCategory::Image: return "image";
+		case DecoMemoryCategory::Staging: return "staging";
+		default: return "other";
+		}
+	}
+
+	DecoMemoryManager::DecoMemoryManager(VkPhysicalDevice physical_device, VkDevice device, bool memory_budget)
+		: m_physical_device(physical_device), m_device(device), m_memory_budget(memory_budget)
+	{
+		vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
+	}
+
+	DecoMemoryManager::~DecoMemoryManager()
+	{
+		assert(m_allocations.empty() && "Device memory still allocated when the device goes away");
+	}
+
+	DecoMemoryCategory DecoMemoryManager::categoryForBufferUsage(VkBufferUsageFlags usage)
+	{
+		if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+		{
+			return DecoMemoryCategory::Mesh;
+		}
+		if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		{
+			return DecoMemoryCategory::Uniform;
+		}
+		if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+		{
+			return DecoMemoryCategory::Storage;
+		}
+		if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+		{
+			return DecoMemoryCategory::Staging;
+		}
+		return DecoMemoryCategory::Other;
+	}
+
+	DecoMemoryManager::Allocation DecoMemoryManager::allocate(
+		const VkMemoryRequirements& requirements,
+		const std::vector<VkMemoryPropertyFlags>& candidates,
+		DecoMemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto budgets = queryBudgetsLocked();
+
+		// first pass keeps every heap below its budget, the second takes whatever the driver still grants
+		for (int pass = 0; pass < 2; pass++)
+		{
+			const bool respect_budget = pass == 0;
+			for (VkMemoryPropertyFlags properties : candidates)
+			{
+				for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+				{
+					const VkMemoryPropertyFlags type_flags = m_memory_properties.memoryTypes[i].propertyFlags;
+					if (!(requirements.memoryTypeBits & (1u << i)) || (type_flags & properties) != properties)
+					{
+						continue;
+					}
+					if (respect_budget && !fitsBudget(i, properties, requirements.size, budgets))
+					{
+						continue;
+					}
+
+					Allocation allocation{};
+					VkResult result = tryAllocate(requirements.size, i, category, allocation.m_memory);
+					if (result == VK_SUCCESS)
+					{
+						allocation.m_memory_type = i;
+						allocation.m_property_flags = type_flags;
+						return allocation;
+					}
+					if (result != VK_ERROR_OUT_OF_DEVICE_MEMORY && result != VK_ERROR_OUT_OF_HOST_MEMORY)
+					{
+						throw std::runtime_error("failed to allocate device memory!");
+					}
+				}
+			}
+		}
+		throw std::runtime_error("out of device memory, no candidate memory type could be allocated!");
+	}
+
+	VkDeviceMemory DecoMemoryManager::allocateType(VkDeviceSize size, uint32_t memory_type, DecoMemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		if (tryAllocate(size, memory_type, category, memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate device memory!");
+		}
+		return memory;
+	}
+
+	void DecoMemoryManager::free(VkDeviceMemory memory)
+	{
+		if (memory == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_allocations.find(memory);
+		assert(it != m_allocations.end() && "Freeing memory the manager did not allocate");
+		m_heap_usage[it->second.m_heap] -= it->second.m_size;
+		m_category_usage[static_cast<size_t>(it->second.m_category)] -= it->second.m_size;
+		m_allocations.erase(it);
+
+		vkFreeMemory(m_device, memory, nullptr);
+	}
+
+	VkResult DecoMemoryManager::tryAllocate(VkDeviceSize size, uint32_t memory_type, DecoMemoryCategory category, VkDeviceMemory& memory)
+	{
+		VkMemoryAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = size;
+		alloc_info.memoryTypeIndex = memory_type;
+
+		VkResult result = vkAllocateMemory(m_device, &alloc_info, nullptr, &memory);
+		if (result != VK_SUCCESS)
+		{
+			return result;
+		}
+
+		const uint32_t heap = m_memory_properties.memoryTypes[memory_type].heapIndex;
+		m_allocations.emplace(memory, Record{ heap, category, size });
+		m_heap_usage[heap] += size;
+		m_category_usage[static_cast<size_t>(category)] += size;
+		return VK_SUCCESS;
+	}
+
+	bool DecoMemoryManager::fitsBudget(
+		uint32_t memory_type,
+		VkMemoryPropertyFlags properties,
+		VkDeviceSize size,
+		const std::vector<DecoMemoryHeapBudget>& budgets) const
+	{
+		const VkMemoryType& type = m_memory_properties.memoryTypes[memory_type];
+		const DecoMemoryHeapBudget& heap = budgets[type.heapIndex];
+
+		// only when asked for, on unified memory every type is device local and host visible
+		const VkMemoryPropertyFlags bar = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		if ((properties & bar) == bar && size > heap.m_size / BAR_ALLOCATION_DIVISOR)
+		{
+			return false;
+		}
+		return heap.m_usage + size <= static_cast<VkDeviceSize>(heap.m_budget * PRESSURE_THRESHOLD);
+	}
+
+	std::vector<DecoMemoryHeapBudget> DecoMemoryManager::queryBudgets() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return queryBudgetsLocked();
+	}
+
+	std::vector<DecoMemoryHeapBudget> DecoMemoryManager::queryBudgetsLocked() const
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+		budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		if (m_memory_budget)
+		{
+			VkPhysicalDeviceMemoryProperties2 memory_properties{};
+			memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			memory_properties.pNext = &budget_properties;
+			vkGetPhysicalDeviceMemoryProperties2(m_physical_device, &memory_properties);
+		}
+
+		std::vector<DecoMemoryHeapBudget> budgets(m_memory_properties.memoryHeapCount);
+		for (uint32_t i = 0; i < m_memory_properties.memoryHeapCount; i++)
+		{
+			auto& budget = budgets[i];
+			budget.m_size = m_memory_properties.memoryHeaps[i].size;
+			budget.m_flags = m_memory_properties.memoryHeaps[i].flags;
+			budget.m_allocated = m_heap_usage[i];
+			if (m_memory_budget)
+			{
+				budget.m_budget = budget_properties.heapBudget[i];
+				budget.m_usage = budget_properties.heapUsage[i];
+			}
+			else
+			{
+				budget.m_budget = budget.m_size / 5 * 4;
+				budget.m_usage = m_heap_usage[i];
+			}
+		}
+		return budgets;
+	}
+
+	VkDeviceSize DecoMemoryManager::getCategoryUsage(DecoMemoryCategory category) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_category_usage[static_cast<size_t>(category)];
+	}
+
+	void DecoMemoryManager::printReport(std::ostream& out) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto budgets = queryBudgetsLocked();
+
+		// formatted apart so the fixed precision does not stick to the caller's stream
+		std::ostringstream report;
+		report << std::fixed << std::setprecision(1) << "Memory (" << (m_memory_budget ? "VK_EXT_memory_budget" : "estimated budget") << ", "
+			<< m_allocations.size() << " allocations):" << std::endl;
+		for (size_t i = 0; i < budgets.size(); i++)
+		{
+			const auto& heap = budgets[i];
+			const double used_share = heap.m_budget > 0 ? 100.0 * heap.m_usage / heap.m_budget : 0.0;
+			report << "  heap " << i << ((heap.m_flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : " (host)")
+				<< ": " << toMiB(heap.m_usage) << " of " << toMiB(heap.m_budget)
+				<< " MiB budget (" << used_share << "%, heap " << toMiB(heap.m_size) << " MiB), this device "
+				<< toMiB(heap.m_allocated) << " MiB" << (heap.m_usage > heap.m_budget * PRESSURE_THRESHOLD ? ", UNDER PRESSURE" : "")
+				<< std::endl;
+		}
+
+		report << "  by category:";
+		for (size_t i = 0; i < m_category_usage.size(); i++)
+		{
+			report << " " << getMemoryCategoryName(static_cast<DecoMemoryCategory>(i)) << " " << toMiB(m_category_usage[i])
+				<< " MiB" << (i + 1 < m_category_usage.size() ? "," : "");
+		}
+		report << std::endl;
+
+		out << report.str() << std::flush;
+	}
+}
@@ -8,8 +8,14 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
 #include <unordered_map>
 
 namespace std
@@ -32,6 +38,12 @@ namespace Deco
 	{
 		createVertexBuffers(builder.m_vertices);
 		createIndexBuffers(builder.m_indices);
+		computeBounds(builder.m_vertices);
+		markReady();
+	}
+
+	DecoModel::DecoModel(DecoDevice& device) : m_deco_device(device), m_vertex_count(0), m_index_count(0)
+	{
 	}
 
 	DecoModel::~DecoModel()
@@ -104,6 +116,86 @@ namespace Deco
 		m_deco_device.copyBuffer(staging_buffer.getBuffer(), m_index_buffer->getBuffer(), buffer_size);
 	}
 
+	void DecoModel::computeBounds(const std::vector<Vertex>& vertices)
+	{
+		glm::vec3 min_corner{ std::numeric_limits<float>::max() };
+		glm::vec3 max_corner{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : vertices)
+		{
+			min_corner = glm::min(min_corner, vertex.position);
+			max_corner = glm::max(max_corner, vertex.position);
+		}
+
+		const glm::vec3 center = (min_corner + max_corner) * 0.5f;
+		float radius_squared = 0.0f;
+		for (const auto& vertex : vertices)
+		{
+			const glm::vec3 offset = vertex.position - center;
+			radius_squared = glm::max(radius_squared, glm::dot(offset, offset));
+		}
+		m_bounding_sphere = glm::vec4(center, glm::sqrt(radius_squared));
+	}
+
+	void DecoModel::recordUpload(VkCommandBuffer command_buffer, const Builder& builder, std::vector<std::unique_ptr<DecoBuffer>>& staging_buffers)
+	{
+		m_vertex_count = static_cast<uint32_t>(builder.m_vertices.size());
+		assert(m_vertex_count >= 3 && "Vertex count must be at least 3");
+		computeBounds(builder.m_vertices);
+		m_vertex_buffer = recordBufferUpload(
+			command_buffer,
+			builder.m_vertices.data(),
+			sizeof(Vertex),
+			m_vertex_count,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			staging_buffers);
+
+		m_index_count = static_cast<uint32_t>(builder.m_indices.size());
+		m_has_index_buffer = m_index_count > 0;
+		if (m_has_index_buffer)
+		{
+			m_index_buffer = recordBufferUpload(
+				command_buffer,
+				builder.m_indices.data(),
+				sizeof(uint32_t),
+				m_index_count,
+				VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+				staging_buffers);
+		}
+	}
+
+	std::unique_ptr<DecoBuffer> DecoModel::recordBufferUpload(
+		VkCommandBuffer command_buffer,
+		const void* data,
+		uint32_t element_size,
+		uint32_t element_count,
+		VkBufferUsageFlags usage,
+		std::vector<std::unique_ptr<DecoBuffer>>& staging_buffers)
+	{
+		auto staging_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			element_size,
+			element_count,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		staging_buffer->map();
+		staging_buffer->writeToBuffer(const_cast<void*>(data));
+
+		auto device_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			element_size,
+			element_count,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkBufferCopy copy_region{};
+		copy_region.size = static_cast<VkDeviceSize>(element_size) * element_count;
+		vkCmdCopyBuffer(command_buffer, staging_buffer->getBuffer(), device_buffer->getBuffer(), 1, &copy_region);
+
+		staging_buffers.push_back(std::move(staging_buffer));
+		return device_buffer;
+	}
+
 	std::unique_ptr<DecoModel> DecoModel::createModelFromFile(DecoDevice& device, const std::string& file_path)
 	{
 		Builder builder{};
@@ -112,27 +204,67 @@ namespace Deco
 		return std::make_unique<DecoModel>(device, builder);
 	}
 
+	uint32_t DecoModel::nextId()
+	{
+		static std::atomic<uint32_t> next_id{ 0 };
+		return next_id.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	void DecoModel::bind(VkCommandBuffer command_buffer)
 	{
-		VkBuffer buffers[] = { m_vertex_buffer->getBuffer() };
+		const DecoModel& buffers_model = m_buffer_owner ? *m_buffer_owner : *this;
+		VkBuffer buffers[] = { buffers_model.m_vertex_buffer->getBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
 
 		if (m_has_index_buffer)
 		{
-			vkCmdBindIndexBuffer(command_buffer, m_index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(command_buffer, buffers_model.m_index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
 		}
 	}
 
-	void DecoModel::draw(VkCommandBuffer command_buffer)
+	void DecoModel::shareBuffers(std::shared_ptr<DecoModel> owner)
+	{
+		assert(owner->isReady() && owner->m_buffer_owner == nullptr && "Can only share the buffers of a ready model that owns them");
+		// same id, so instances of either model are drawn together
+		m_id = owner->m_id;
+		m_vertex_count = owner->m_vertex_count;
+		m_has_index_buffer = owner->m_has_index_buffer;
+		m_index_count = owner->m_index_count;
+		m_bounding_sphere = owner->m_bounding_sphere;
+		m_content_hash = owner->m_content_hash;
+		m_buffer_owner = std::move(owner);
+	}
+
+	VkDeviceSize DecoModel::getMemorySize() const
+	{
+		// counted once, by the model that uploaded them
+		if (m_buffer_owner)
+		{
+			return 0;
+		}
+
+		VkDeviceSize memory_size = 0;
+		if (m_vertex_buffer)
+		{
+			memory_size += m_vertex_buffer->getBufferSize();
+		}
+		if (m_index_buffer)
+		{
+			memory_size += m_index_buffer->getBufferSize();
+		}
+		return memory_size;
+	}
+
+	void DecoModel::draw(VkCommandBuffer command_buffer, uint32_t instance_count, uint32_t first_instance)
 	{
 		if (m_has_index_buffer)
 		{
-			vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0);
+			vkCmdDrawIndexed(command_buffer, m_index_count, instance_count, 0, 0, first_instance);
 		}
 		else
 		{
-			vkCmdDraw(command_buffer, m_vertex_count, 1, 0, 0);
+			vkCmdDraw(command_buffer, m_vertex_count, instance_count, 0, first_instance);
 		}
 	}
 
@@ -227,4 +359,131 @@ namespace Deco
 		}
 	}
 
+	void DecoModel::Builder::loadModelCached(const std::string& file_path)
+	{
+		std::error_code error;
+		uint64_t source_size = static_cast<uint64_t>(std::filesystem::file_size(file_path, error));
+		if (error)
+		{
+			// let tinyobj report the missing file
+			loadModel(file_path);
+			return;
+		}
+		int64_t source_time = static_cast<int64_t>(
+			std::filesystem::last_write_time(file_path, error).time_since_epoch().count());
+
+		const std::string cache_path = file_path + ".meshcache";
+		if (readCache(cache_path, source_size, source_time))
+		{
+			return;
+		}
+
+		loadModel(file_path);
+		writeCache(cache_path, source_size, source_time);
+	}
+
+	namespace
+	{
+		constexpr uint32_t MESH_CACHE_MAGIC = 0x48534d44; // "DMSH"
+		constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+		struct MeshCacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t source_size;
+			int64_t source_time;
+			uint32_t vertex_size;
+			uint32_t vertex_count;
+			uint32_t index_count;
+		};
+	}
+
+	bool DecoModel::Builder::readCache(const std::string& cache_path, uint64_t source_size, int64_t source_time)
+	{
+		std::ifstream file(cache_path, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		MeshCacheHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file ||
+			header.magic != MESH_CACHE_MAGIC ||
+			header.version != MESH_CACHE_VERSION ||
+			header.source_size != source_size ||
+			header.source_time != source_time ||
+			header.vertex_size != sizeof(Vertex))
+		{
+			return false;
+		}
+
+		// the counts come from the file, a corrupt cache must not size the vectors beyond what it holds
+		std::error_code error;
+		const uint64_t file_size = static_cast<uint64_t>(std::filesystem::file_size(cache_path, error));
+		const uint64_t expected_size = sizeof(MeshCacheHeader) +
+			static_cast<uint64_t>(header.vertex_count) * header.vertex_size +
+			static_cast<uint64_t>(header.index_count) * sizeof(uint32_t);
+		if (error || file_size != expected_size)
+		{
+			return false;
+		}
+
+		m_vertices.resize(header.vertex_count);
+		m_indices.resize(header.index_count);
+		file.read(reinterpret_cast<char*>(m_vertices.data()), sizeof(Vertex) * m_vertices.size());
+		file.read(reinterpret_cast<char*>(m_indices.data()), sizeof(uint32_t) * m_indices.size());
+
+		if (!file)
+		{
+			m_vertices.clear();
+			m_indices.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void DecoModel::Builder::writeCache(const std::string& cache_path, uint64_t source_size, int64_t source_time) const
+	{
+		// write to a temporary first so a concurrent reader never sees a half written cache, named per
+		// writer so two threads caching the same mesh never write into the same file
+		static std::atomic<uint64_t> temp_counter{ 0 };
+		const std::string temp_path = cache_path + "." +
+			std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "." +
+			std::to_string(temp_counter++) + ".tmp";
+		{
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return;
+			}
+
+			MeshCacheHeader header{};
+			header.magic = MESH_CACHE_MAGIC;
+			header.version = MESH_CACHE_VERSION;
+			header.source_size = source_size;
+			header.source_time = source_time;
+			header.vertex_size = sizeof(Vertex);
+			header.vertex_count = static_cast<uint32_t>(m_vertices.size());
+			header.index_count = static_cast<uint32_t>(m_indices.size());
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(m_vertices.data()), sizeof(Vertex) * m_vertices.size());
+			file.write(reinterpret_cast<const char*>(m_indices.data()), sizeof(uint32_t) * m_indices.size());
+			if (!file)
+			{
+				return;
+			}
+		}
+
+		// a failed rename only costs a re-parse next time
+		std::error_code error;
+		std::filesystem::rename(temp_path, cache_path, error);
+		if (error)
+		{
+			std::filesystem::remove(temp_path, error);
+		}
+	}
+
 }
\ No newline at end of file
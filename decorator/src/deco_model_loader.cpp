@@ -0,0 +1,219 @@
+#include "deco_model_loader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace Deco
+{
+	namespace
+	{
+		// 64 bit FNV-1a over the parsed vertices and indices, byte identical files hash alike whether
+		// they came from the OBJ or the mesh cache
+		uint64_t hashMesh(const DecoModel::Builder& builder)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			auto hashBytes = [&hash](const void* data, size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; i++)
+				{
+					hash ^= bytes[i];
+					hash *= 0x100000001b3ull;
+				}
+			};
+			hashBytes(builder.m_vertices.data(), builder.m_vertices.size() * sizeof(DecoModel::Vertex));
+			hashBytes(builder.m_indices.data(), builder.m_indices.size() * sizeof(uint32_t));
+			return hash;
+		}
+	}
+
+	DecoModelLoader::DecoModelLoader(DecoDevice& device, uint32_t worker_count) : m_deco_device(device), m_thread_pool(worker_count)
+	{
+	}
+
+	DecoModelLoader::~DecoModelLoader()
+	{
+		m_thread_pool.waitIdle();
+		retireUploads(true);
+	}
+
+	std::shared_ptr<DecoModel> DecoModelLoader::createModelFromFile(const std::string& file_path)
+	{
+		auto model = std::make_shared<DecoModel>(m_deco_device);
+
+		m_unsubmitted_count++;
+		m_thread_pool.enqueue([this, model, file_path]()
+			{
+				ParsedModel parsed{};
+				parsed.m_model = model;
+				parsed.m_file_path = file_path;
+
+				try
+				{
+					parsed.m_builder = std::make_unique<DecoModel::Builder>();
+					parsed.m_builder->loadModelCached(file_path);
+					parsed.m_content_hash = hashMesh(*parsed.m_builder);
+				}
+				catch (const std::exception& e)
+				{
+					parsed.m_error = e.what();
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_parsed_mutex);
+					m_parsed_models.push_back(std::move(parsed));
+				}
+			});
+
+		return model;
+	}
+
+	void DecoModelLoader::update()
+	{
+		retireUploads(false);
+		submitParsedModels();
+	}
+
+	void DecoModelLoader::waitIdle()
+	{
+		m_thread_pool.waitIdle();
+		submitParsedModels();
+		retireUploads(true);
+	}
+
+	bool DecoModelLoader::isIdle() const
+	{
+		return m_unsubmitted_count.load() == 0 && m_pending_uploads.empty();
+	}
+
+	void DecoModelLoader::submitParsedModels()
+	{
+		std::vector<ParsedModel> parsed_models;
+		{
+			std::lock_guard<std::mutex> lock(m_parsed_mutex);
+			parsed_models.swap(m_parsed_models);
+		}
+		m_unsubmitted_count -= static_cast<uint32_t>(parsed_models.size());
+
+		// a file that failed to parse is reported and its model marked failed instead of ever becoming
+		// ready, the rest of the batch is still uploaded
+		auto failed_begin = std::remove_if(parsed_models.begin(), parsed_models.end(), [](const ParsedModel& parsed)
+			{
+				if (parsed.m_error.empty()) return false;
+				std::cerr << "Failed to load model " << parsed.m_file_path << ": " << parsed.m_error << std::endl;
+				parsed.m_model->markFailed();
+				return true;
+			});
+		parsed_models.erase(failed_begin, parsed_models.end());
+
+		// content that is already on the GPU is shared, only new content is uploaded
+		auto shared_begin = std::remove_if(parsed_models.begin(), parsed_models.end(), [this](const ParsedModel& parsed)
+			{
+				parsed.m_model->m_content_hash = parsed.m_content_hash;
+				std::shared_ptr<DecoModel> source = m_duplicate_resolver ? m_duplicate_resolver(parsed.m_content_hash) : nullptr;
+				if (source == nullptr || !source->isReady()) return false;
+				parsed.m_model->shareBuffers(std::move(source));
+				parsed.m_model->markReady();
+				return true;
+			});
+		parsed_models.erase(shared_begin, parsed_models.end());
+
+		if (parsed_models.empty())
+		{
+			return;
+		}
+
+		PendingUpload upload{};
+
+		VkCommandBufferAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandPool = m_deco_device.getCommandPool();
+		alloc_info.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_deco_device.device(), &alloc_info, &upload.m_command_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer");
+		}
+
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(upload.m_command_buffer, &begin_info);
+
+		for (auto& parsed : parsed_models)
+		{
+			parsed.m_model->recordUpload(upload.m_command_buffer, *parsed.m_builder, upload.m_staging_buffers);
+			upload.m_models.push_back(parsed.m_model);
+		}
+
+		// make the copies visible to vertex input of every later submission on this queue
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(
+			upload.m_command_buffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0,
+			1,
+			&barrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
+
+		vkEndCommandBuffer(upload.m_command_buffer);
+
+		VkFenceCreateInfo fence_info{};
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(m_deco_device.device(), &fence_info, nullptr, &upload.m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload fence");
+		}
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &upload.m_command_buffer;
+
+		{
+			auto queue_lock = m_deco_device.lockQueues();
+			if (vkQueueSubmit(m_deco_device.graphicsQueue(), 1, &submit_info, upload.m_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit upload command buffer");
+			}
+		}
+
+		m_pending_uploads.push_back(std::move(upload));
+	}
+
+	void DecoModelLoader::retireUploads(bool wait)
+	{
+		auto it = m_pending_uploads.begin();
+		while (it != m_pending_uploads.end())
+		{
+			if (wait)
+			{
+				vkWaitForFences(m_deco_device.device(), 1, &it->m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			}
+			else if (vkGetFenceStatus(m_deco_device.device(), it->m_fence) != VK_SUCCESS)
+			{
+				++it;
+				continue;
+			}
+
+			for (auto& model : it->m_models)
+			{
+				model->markReady();
+			}
+
+			vkDestroyFence(m_deco_device.device(), it->m_fence, nullptr);
+			vkFreeCommandBuffers(m_deco_device.device(), m_deco_device.getCommandPool(), 1, &it->m_command_buffer);
+			it = m_pending_uploads.erase(it);
+		}
+	}
+}
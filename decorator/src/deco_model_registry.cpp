@@ -0,0 +1,173 @@
+#include "deco_model_registry.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Deco
+{
+	DecoModelRegistry::DecoModelRegistry(DecoDevice& device, DecoModelLoader& loader, VkDeviceSize memory_budget)
+		: m_deco_device(device), m_model_loader(loader), m_memory_budget(memory_budget)
+	{
+		m_model_loader.setDuplicateResolver([this](uint64_t content_hash) { return findLoadedModel(content_hash); });
+	}
+
+	DecoModelRegistry::~DecoModelRegistry()
+	{
+		m_model_loader.setDuplicateResolver(nullptr);
+	}
+
+	std::shared_ptr<DecoModel> DecoModelRegistry::acquire(const std::string& file_path)
+	{
+		const std::string canonical_path = canonicalPath(file_path);
+
+		std::error_code error;
+		uint64_t source_size = static_cast<uint64_t>(std::filesystem::file_size(canonical_path, error));
+		if (error)
+		{
+			throw std::runtime_error("Failed to open model: " + file_path);
+		}
+		int64_t source_time = static_cast<int64_t>(
+			std::filesystem::last_write_time(canonical_path, error).time_since_epoch().count());
+
+		// a file changed on disk gets an entry of its own, the old one ages out like any unused model
+		const std::string key = canonical_path + "|" + std::to_string(source_size) + "|" + std::to_string(source_time);
+		auto& entry = m_entries[key];
+		if (entry.m_model == nullptr)
+		{
+			entry.m_model = m_model_loader.createModelFromFile(canonical_path);
+		}
+		entry.m_last_used = ++m_use_clock;
+
+		return entry.m_model;
+	}
+
+	void DecoModelRegistry::collectGarbage()
+	{
+		m_use_clock++;
+
+		// one record per distinct model, several keys point at the same model once duplicates resolve
+		struct ModelUse
+		{
+			long m_entry_count{ 0 };
+			uint64_t m_last_used{ 0 };
+			bool m_unused{ false };
+		};
+		std::unordered_map<std::shared_ptr<DecoModel>, ModelUse> model_uses;
+
+		for (auto it = m_entries.begin(); it != m_entries.end();)
+		{
+			// a failed load holds no GPU memory, dropping it lets the next acquire retry the file
+			if (it->second.m_model->hasFailed())
+			{
+				it = m_entries.erase(it);
+				continue;
+			}
+
+			auto& entry = (it++)->second;
+
+			// a file whose content was already loaded points at the model that owns the buffers, the
+			// duplicate itself holds nothing and lives on only as long as its callers keep it
+			if (auto owner = entry.m_model->getBufferOwner())
+			{
+				entry.m_model = std::move(owner);
+			}
+
+			auto& use = model_uses[entry.m_model];
+			use.m_entry_count++;
+			use.m_last_used = std::max(use.m_last_used, entry.m_last_used);
+		}
+
+		VkDeviceSize resident_memory = 0;
+		std::vector<std::pair<uint64_t, DecoModel*>> unused_models; // (last used, model)
+		for (auto& kv : model_uses)
+		{
+			resident_memory += kv.first->getMemorySize();
+
+			// the registry's keys and this map are the only owners left, duplicates hold one to their owner
+			kv.second.m_unused = kv.first.use_count() == kv.second.m_entry_count + 1 && kv.first->isReady();
+			if (kv.second.m_unused)
+			{
+				unused_models.emplace_back(kv.second.m_last_used, kv.first.get());
+			}
+		}
+		for (auto& kv : m_entries)
+		{
+			if (!model_uses[kv.second.m_model].m_unused)
+			{
+				kv.second.m_last_used = m_use_clock;
+			}
+		}
+		model_uses.clear();
+
+		if (resident_memory <= m_memory_budget)
+		{
+			return;
+		}
+
+		std::sort(unused_models.begin(), unused_models.end());
+		for (auto& unused : unused_models)
+		{
+			if (resident_memory <= m_memory_budget)
+			{
+				break;
+			}
+
+			// every key of the model goes at once
+			resident_memory -= unused.second->getMemorySize();
+			for (auto it = m_entries.begin(); it != m_entries.end();)
+			{
+				if (it->second.m_model.get() != unused.second)
+				{
+					++it;
+					continue;
+				}
+				m_deco_device.getDeletionQueue().release(std::move(it->second.m_model));
+				it = m_entries.erase(it);
+			}
+		}
+	}
+
+	VkDeviceSize DecoModelRegistry::getResidentMemory() const
+	{
+		// duplicates report no memory of their own, a model behind several keys is counted once
+		std::unordered_set<const DecoModel*> counted;
+		VkDeviceSize resident_memory = 0;
+		for (auto& kv : m_entries)
+		{
+			if (counted.insert(kv.second.m_model.get()).second)
+			{
+				resident_memory += kv.second.m_model->getMemorySize();
+			}
+		}
+		return resident_memory;
+	}
+
+	std::shared_ptr<DecoModel> DecoModelRegistry::findLoadedModel(uint64_t content_hash) const
+	{
+		for (auto& kv : m_entries)
+		{
+			const auto& model = kv.second.m_model;
+			if (model->isReady() && model->getBufferOwner() == nullptr && model->getContentHash() == content_hash)
+			{
+				return model;
+			}
+		}
+		return nullptr;
+	}
+
+	std::string DecoModelRegistry::canonicalPath(const std::string& file_path)
+	{
+		std::error_code error;
+		auto canonical_path = std::filesystem::weakly_canonical(file_path, error);
+		if (error)
+		{
+			return file_path;
+		}
+		return canonical_path.generic_string();
+	}
+}
@@ -11,21 +11,96 @@
 namespace Deco
 {
 
-	DecoPipeline::DecoPipeline(DecoDevice& device, const std::string& vert_file_path, const std::string& frag_file_path, const PipelineConfigInfo& config_info) : m_device(device)
+	DecoPipeline::DecoPipeline(DecoDevice& device, const std::string& vert_file_path, const std::string& frag_file_path, const PipelineConfigInfo& config_info) : m_device(&device)
 	{
 		createGraphicsPipeline(vert_file_path, frag_file_path, config_info);
 	}
 
+	DecoPipeline::DecoPipeline(DecoDevice& device, const std::string& comp_file_path, const ComputePipelineConfigInfo& config_info) : m_device(&device)
+	{
+		createComputePipeline(comp_file_path, config_info);
+	}
+
 	DecoPipeline::~DecoPipeline()
 	{
-		vkDestroyShaderModule(m_device.device(), m_vert_shader_module, nullptr);
-		vkDestroyShaderModule(m_device.device(), m_frag_shader_module, nullptr);
-		vkDestroyPipeline(m_device.device(), m_graphics_pipeline, nullptr);
+		release();
+	}
+
+	DecoPipeline::DecoPipeline(DecoPipeline&& other) noexcept
+		: m_device(other.m_device),
+		m_pipeline(other.m_pipeline),
+		m_bind_point(other.m_bind_point),
+		m_vert_shader_module(other.m_vert_shader_module),
+		m_frag_shader_module(other.m_frag_shader_module),
+		m_comp_shader_module(other.m_comp_shader_module),
+		m_workgroup_size(other.m_workgroup_size)
+	{
+		other.m_pipeline = VK_NULL_HANDLE;
+		other.m_vert_shader_module = VK_NULL_HANDLE;
+		other.m_frag_shader_module = VK_NULL_HANDLE;
+		other.m_comp_shader_module = VK_NULL_HANDLE;
+	}
+
+	DecoPipeline& DecoPipeline::operator=(DecoPipeline&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+
+			m_device = other.m_device;
+			m_pipeline = other.m_pipeline;
+			m_bind_point = other.m_bind_point;
+			m_vert_shader_module = other.m_vert_shader_module;
+			m_frag_shader_module = other.m_frag_shader_module;
+			m_comp_shader_module = other.m_comp_shader_module;
+			m_workgroup_size = other.m_workgroup_size;
+
+			other.m_pipeline = VK_NULL_HANDLE;
+			other.m_vert_shader_module = VK_NULL_HANDLE;
+			other.m_frag_shader_module = VK_NULL_HANDLE;
+			other.m_comp_shader_module = VK_NULL_HANDLE;
+		}
+		return *this;
+	}
+
+	void DecoPipeline::release()
+	{
+		// vkDestroy* ignore VK_NULL_HANDLE, so a moved-from pipeline releases nothing
+		vkDestroyShaderModule(m_device->device(), m_vert_shader_module, nullptr);
+		vkDestroyShaderModule(m_device->device(), m_frag_shader_module, nullptr);
+		vkDestroyShaderModule(m_device->device(), m_comp_shader_module, nullptr);
+		vkDestroyPipeline(m_device->device(), m_pipeline, nullptr);
+
+		m_pipeline = VK_NULL_HANDLE;
+		m_vert_shader_module = VK_NULL_HANDLE;
+		m_frag_shader_module = VK_NULL_HANDLE;
+		m_comp_shader_module = VK_NULL_HANDLE;
 	}
 
 	void DecoPipeline::bind(VkCommandBuffer command_buffer)
 	{
-		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+		vkCmdBindPipeline(command_buffer, m_bind_point, m_pipeline);
+	}
+
+	void DecoPipeline::dispatch(VkCommandBuffer command_buffer, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+	{
+		assert(isCompute() && "Cannot dispatch a graphics pipeline");
+		vkCmdDispatch(command_buffer, group_count_x, group_count_y, group_count_z);
+	}
+
+	void DecoPipeline::dispatchThreads(VkCommandBuffer command_buffer, uint32_t thread_count_x, uint32_t thread_count_y, uint32_t thread_count_z)
+	{
+		dispatch(
+			command_buffer,
+			(thread_count_x + m_workgroup_size.width - 1) / m_workgroup_size.width,
+			(thread_count_y + m_workgroup_size.height - 1) / m_workgroup_size.height,
+			(thread_count_z + m_workgroup_size.depth - 1) / m_workgroup_size.depth);
+	}
+
+	void DecoPipeline::dispatchIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset)
+	{
+		assert(isCompute() && "Cannot dispatch a graphics pipeline");
+		vkCmdDispatchIndirect(command_buffer, buffer, offset);
 	}
 
 	void DecoPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& config_info)
@@ -131,17 +206,21 @@ namespace Deco
 			"Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
 
 		assert(
-			config_info.m_render_pass != VK_NULL_HANDLE &&
-			"Cannot create graphics pipeline:: no renderPass provided in configInfo");
+			(config_info.m_render_pass != VK_NULL_HANDLE || config_info.m_color_attachment_format != VK_FORMAT_UNDEFINED) &&
+			"Cannot create graphics pipeline:: no renderPass or attachment formats provided in configInfo");
 
 		auto vert_code = readFile(vert_file_path);
-		auto frag_code = readFile(frag_file_path);
 
 		//std::cout << "Vertex shader code size: " << vert_code.size() << std::endl;
-		//std::cout << "Fragment shader code size: " << frag_code.size() << std::endl;
 
 		createShaderModule(vert_code, &m_vert_shader_module);
-		createShaderModule(frag_code, &m_frag_shader_module);
+
+		const bool has_fragment_stage = !frag_file_path.empty();
+		if (has_fragment_stage)
+		{
+			auto frag_code = readFile(frag_file_path);
+			createShaderModule(frag_code, &m_frag_shader_module);
+		}
 
 		VkPipelineShaderStageCreateInfo shader_stages[2];
 		shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -170,7 +249,7 @@ namespace Deco
 
 		VkGraphicsPipelineCreateInfo pipeline_info{};
 		pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipeline_info.stageCount = 2;
+		pipeline_info.stageCount = has_fragment_stage ? 2 : 1;
 		pipeline_info.pStages = shader_stages;
 		pipeline_info.pVertexInputState = &vertex_input_info;
 		pipeline_info.pInputAssemblyState = &config_info.m_input_assembly_info;
@@ -185,21 +264,80 @@ namespace Deco
 		pipeline_info.renderPass = config_info.m_render_pass;
 		pipeline_info.subpass = config_info.m_subpass;
 
+		// without a render pass the attachment formats are all the pipeline has to be compatible with
+		VkPipelineRenderingCreateInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachmentFormats = &config_info.m_color_attachment_format;
+		rendering_info.depthAttachmentFormat = config_info.m_depth_attachment_format;
+		rendering_info.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+		if (config_info.m_render_pass == VK_NULL_HANDLE)
+		{
+			pipeline_info.pNext = &rendering_info;
+		}
+
 		pipeline_info.basePipelineIndex = -1;
 		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
 		if (vkCreateGraphicsPipelines(
-			m_device.device(),
+			m_device->device(),
 			VK_NULL_HANDLE,
 			1,
 			&pipeline_info,
 			nullptr,
-			&m_graphics_pipeline) != VK_SUCCESS)
+			&m_pipeline) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create graphics pipeline");
 		}
 	}
 
+	void DecoPipeline::createComputePipeline(const std::string& comp_file_path, const ComputePipelineConfigInfo& config_info)
+	{
+		assert(
+			config_info.m_pipeline_layout != VK_NULL_HANDLE &&
+			"Cannot create compute pipeline:: no pipelineLayout provided in configInfo");
+		assert(
+			config_info.m_workgroup_size.width > 0 && config_info.m_workgroup_size.height > 0 && config_info.m_workgroup_size.depth > 0 &&
+			"Cannot create compute pipeline:: empty workgroup size in configInfo");
+
+		m_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+		m_workgroup_size = config_info.m_workgroup_size;
+
+		auto comp_code = readFile(comp_file_path);
+		createShaderModule(comp_code, &m_comp_shader_module);
+
+		VkSpecializationInfo specialization_info{};
+		specialization_info.mapEntryCount = static_cast<uint32_t>(config_info.m_specialization_entries.size());
+		specialization_info.pMapEntries = config_info.m_specialization_entries.data();
+		specialization_info.dataSize = config_info.m_specialization_data.size();
+		specialization_info.pData = config_info.m_specialization_data.data();
+
+		VkPipelineShaderStageCreateInfo shader_stage{};
+		shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shader_stage.module = m_comp_shader_module;
+		shader_stage.pName = "main";
+		shader_stage.pSpecializationInfo = config_info.m_specialization_entries.empty() ? nullptr : &specialization_info;
+
+		VkComputePipelineCreateInfo pipeline_info{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage = shader_stage;
+		pipeline_info.layout = config_info.m_pipeline_layout;
+		pipeline_info.basePipelineIndex = -1;
+		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(
+			m_device->device(),
+			VK_NULL_HANDLE,
+			1,
+			&pipeline_info,
+			nullptr,
+			&m_pipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create compute pipeline");
+		}
+	}
+
 	void DecoPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module)
 	{
 		VkShaderModuleCreateInfo create_info{};
@@ -207,7 +345,7 @@ namespace Deco
 		create_info.codeSize = code.size();
 		create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-		if (vkCreateShaderModule(m_device.device(), &create_info, nullptr, shader_module) != VK_SUCCESS)
+		if (vkCreateShaderModule(m_device->device(), &create_info, nullptr, shader_module) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create shader module");
 		}
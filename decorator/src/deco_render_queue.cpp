@@ -0,0 +1,221 @@
+#include "deco_render_queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace Deco
+{
+	// key layout, most significant first: layer 4 | pipeline 8 | descriptor set 8 | model 12 | depth 32.
+	// Ids that overflow their field only weaken the grouping, the submit loop compares the real handles.
+	static constexpr uint32_t PIPELINE_BITS = 8;
+	static constexpr uint32_t DESCRIPTOR_SET_BITS = 8;
+	static constexpr uint32_t MODEL_BITS = 12;
+
+	DecoRenderQueue::DecoRenderQueue(DecoThreadPool* thread_pool) : m_thread_pool(thread_pool)
+	{
+	}
+
+	void DecoRenderQueue::clear()
+	{
+		m_commands.clear();
+		m_push_constant_data.clear();
+		m_sorted.clear();
+		m_pipeline_ids.clear();
+		m_descriptor_set_ids.clear();
+		m_is_sorted = true;
+	}
+
+	void DecoRenderQueue::push(const DecoDrawCommand& command, const void* push_constants, uint32_t push_constant_size)
+	{
+		assert(command.m_pipeline != nullptr && "Draw command without a pipeline");
+		assert(command.m_layer <= MAX_LAYER && "Draw command layer out of range");
+		assert(push_constant_size <= MAX_PUSH_CONSTANT_SIZE && "Push constants too large for the render queue");
+		assert(command.m_dynamic_offset_count <= DecoDrawCommand::MAX_DYNAMIC_OFFSETS && "Too many dynamic offsets");
+
+		QueuedCommand queued{};
+		queued.m_command = command;
+		queued.m_push_constant_offset = static_cast<uint32_t>(m_push_constant_data.size());
+		queued.m_push_constant_size = push_constant_size;
+		if (push_constant_size > 0)
+		{
+			m_push_constant_data.resize(m_push_constant_data.size() + push_constant_size);
+			std::memcpy(m_push_constant_data.data() + queued.m_push_constant_offset, push_constants, push_constant_size);
+		}
+
+		m_sorted.push_back({ makeKey(command), static_cast<uint32_t>(m_commands.size()) });
+		m_commands.push_back(queued);
+		m_is_sorted = false;
+	}
+
+	template <typename Handle>
+	uint32_t DecoRenderQueue::idOf(std::unordered_map<Handle, uint32_t>& ids, Handle handle)
+	{
+		return ids.emplace(handle, static_cast<uint32_t>(ids.size())).first->second;
+	}
+
+	uint64_t DecoRenderQueue::makeKey(const DecoDrawCommand& command)
+	{
+		const uint64_t pipeline_id = std::min<uint32_t>(idOf(m_pipeline_ids, command.m_pipeline), (1u << PIPELINE_BITS) - 1);
+		const uint64_t set_id = std::min<uint32_t>(idOf(m_descriptor_set_ids, command.m_descriptor_set), (1u << DESCRIPTOR_SET_BITS) - 1);
+		const uint64_t model_id = command.m_model != nullptr ? (command.m_model->getId() & ((1u << MODEL_BITS) - 1)) : 0;
+
+		uint64_t key = command.m_layer;
+		key = (key << PIPELINE_BITS) | pipeline_id;
+		key = (key << DESCRIPTOR_SET_BITS) | set_id;
+		key = (key << MODEL_BITS) | model_id;
+		key = (key << 32) | floatToSortKey(command.m_depth);
+		return key;
+	}
+
+	void DecoRenderQueue::sort()
+	{
+		if (m_is_sorted)
+		{
+			return;
+		}
+
+		if (m_thread_pool != nullptr)
+		{
+			parallelRadixSort(m_sorted, m_sort_scratch, *m_thread_pool);
+		}
+		else
+		{
+			radixSort(m_sorted, m_sort_scratch);
+		}
+		m_is_sorted = true;
+	}
+
+	void DecoRenderQueue::submit(VkCommandBuffer command_buffer, DecoGpuProfiler* gpu_profiler)
+	{
+		sort();
+
+		m_stats = DecoRenderQueueStats{};
+		m_stats.m_draws = static_cast<uint32_t>(m_commands.size());
+		m_stats.m_naive_binds = m_stats.m_draws * 3;
+
+		DecoPipeline* bound_pipeline = nullptr;
+		VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+		VkDescriptorSet bound_set = VK_NULL_HANDLE;
+		std::array<uint32_t, DecoDrawCommand::MAX_DYNAMIC_OFFSETS> bound_offsets{};
+		uint32_t bound_offset_count = 0;
+		VkDescriptorSet bound_bindless_set = VK_NULL_HANDLE;
+		DecoModel* bound_model = nullptr;
+
+		int current_layer = -1;
+		uint32_t layer_scope = DecoGpuProfiler::INVALID_SCOPE;
+
+		for (const auto& entry : m_sorted)
+		{
+			const auto& queued = m_commands[entry.m_value];
+			const auto& command = queued.m_command;
+
+			if (gpu_profiler != nullptr && command.m_layer != current_layer)
+			{
+				gpu_profiler->endScope(command_buffer, layer_scope);
+				const auto& name = m_layer_names[command.m_layer];
+				layer_scope = gpu_profiler->beginScope(command_buffer, name.empty() ? "render queue" : name.c_str());
+			}
+			current_layer = command.m_layer;
+
+			if (command.m_pipeline != bound_pipeline)
+			{
+				command.m_pipeline->bind(command_buffer);
+				bound_pipeline = command.m_pipeline;
+				m_stats.m_pipeline_binds++;
+			}
+
+			// a different layout may disturb the bound sets, so rebind then as well
+			const bool layout_changed = command.m_pipeline_layout != bound_layout;
+			bound_layout = command.m_pipeline_layout;
+			if (layout_changed)
+			{
+				bound_set = VK_NULL_HANDLE;
+				bound_bindless_set = VK_NULL_HANDLE;
+			}
+
+			// the same set with other dynamic offsets is a rebind as well, but still cheaper than another set
+			const bool offsets_changed = command.m_dynamic_offset_count != bound_offset_count ||
+				!std::equal(
+					command.m_dynamic_offsets.begin(),
+					command.m_dynamic_offsets.begin() + command.m_dynamic_offset_count,
+					bound_offsets.begin());
+			if (command.m_descriptor_set != VK_NULL_HANDLE && (command.m_descriptor_set != bound_set || offsets_changed))
+			{
+				vkCmdBindDescriptorSets(
+					command_buffer,
+					VK_PIPELINE_BIND_POINT_GRAPHICS,
+					command.m_pipeline_layout,
+					0,
+					1,
+					&command.m_descriptor_set,
+					command.m_dynamic_offset_count,
+					command.m_dynamic_offsets.data());
+				bound_set = command.m_descriptor_set;
+				bound_offsets = command.m_dynamic_offsets;
+				bound_offset_count = command.m_dynamic_offset_count;
+				m_stats.m_descriptor_set_binds++;
+			}
+
+			if (command.m_bindless_set != VK_NULL_HANDLE && command.m_bindless_set != bound_bindless_set)
+			{
+				vkCmdBindDescriptorSets(
+					command_buffer,
+					VK_PIPELINE_BIND_POINT_GRAPHICS,
+					command.m_pipeline_layout,
+					1,
+					1,
+					&command.m_bindless_set,
+					0,
+					nullptr);
+				bound_bindless_set = command.m_bindless_set;
+				m_stats.m_descriptor_set_binds++;
+			}
+
+			if (queued.m_push_constant_size > 0)
+			{
+				vkCmdPushConstants(
+					command_buffer,
+					command.m_pipeline_layout,
+					command.m_push_constant_stages,
+					0,
+					queued.m_push_constant_size,
+					m_push_constant_data.data() + queued.m_push_constant_offset);
+			}
+
+			if (command.m_model == nullptr)
+			{
+				if (command.m_indirect_buffer != VK_NULL_HANDLE)
+				{
+					vkCmdDrawIndirect(command_buffer, command.m_indirect_buffer, command.m_indirect_offset, 1, 0);
+				}
+				else
+				{
+					vkCmdDraw(command_buffer, command.m_vertex_count, command.m_instance_count, 0, 0);
+				}
+				continue;
+			}
+
+			if (command.m_model != bound_model)
+			{
+				command.m_model->bind(command_buffer);
+				bound_model = command.m_model;
+				m_stats.m_vertex_buffer_binds++;
+			}
+			command.m_model->draw(command_buffer);
+		}
+
+		if (gpu_profiler != nullptr)
+		{
+			gpu_profiler->endScope(command_buffer, layer_scope);
+		}
+	}
+
+	void DecoRenderQueue::printStats(std::ostream& out) const
+	{
+		const uint32_t state_changes = m_stats.m_pipeline_binds + m_stats.m_descriptor_set_binds + m_stats.m_vertex_buffer_binds;
+		out << "Render queue: " << m_stats.m_draws << " draws, " << state_changes << " state changes ("
+			<< m_stats.m_pipeline_binds << " pipeline, " << m_stats.m_descriptor_set_binds << " descriptor set, "
+			<< m_stats.m_vertex_buffer_binds << " vertex buffer), " << m_stats.m_naive_binds << " without sorting" << std::endl;
+	}
+}
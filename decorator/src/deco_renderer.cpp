@@ -1,4 +1,5 @@
 #include "deco_renderer.h"
+#include "deco_barrier.h"
 
 #include <array>
 #include <cassert>
@@ -6,9 +7,26 @@
 
 namespace Deco
 {
-	DecoRenderer::DecoRenderer(DecoWindow& window, DecoDevice& device) : m_deco_window(window), m_deco_device(device)
+	DecoRenderer::DecoRenderer(DecoWindow& window, DecoDevice& device, const DecoRendererSettings& settings)
+		: m_deco_window(window),
+		m_deco_device(device),
+		m_latency_mode(settings.m_latency_mode),
+		m_swap_chain_config(DecoSwapChainConfig::fromLatencyMode(settings.m_latency_mode)),
+		m_gpu_profiler(device, m_swap_chain_config.m_frames_in_flight)
 	{
-		recreateSwapChain();
+		m_swap_chain_config.m_msaa_samples = settings.m_msaa_samples;
+		m_swap_chain_config.m_dynamic_rendering = settings.m_dynamic_rendering;
+		m_frame_pacer.setTargetFrameRate(settings.m_target_frame_rate);
+		assert(m_swap_chain_config.m_frames_in_flight >= 1 &&
+			m_swap_chain_config.m_frames_in_flight <= DecoSwapChain::MAX_FRAMES_IN_FLIGHT &&
+			"Unsupported frames in flight count");
+		m_slot_input_times.resize(m_swap_chain_config.m_frames_in_flight);
+
+		// the first swap chain is needed right away (render pass for the pipelines)
+		while (!recreateSwapChain())
+		{
+			glfwWaitEvents();
+		}
 		createCommandBuffers();
 	}
 
@@ -22,11 +40,30 @@ namespace Deco
 		return m_deco_swap_chain->getRenderPass();
 	}
 
+	VkSampleCountFlagBits DecoRenderer::getSampleCount() const
+	{
+		return m_deco_swap_chain->getSampleCount();
+	}
+
+	void DecoRenderer::configurePipeline(PipelineConfigInfo& config_info) const
+	{
+		config_info.m_render_pass = m_deco_swap_chain->getRenderPass();
+		config_info.m_subpass = 0;
+		config_info.m_color_attachment_format = m_deco_swap_chain->getSwapChainImageFormat();
+		config_info.m_depth_attachment_format = m_deco_swap_chain->getSwapChainDepthFormat();
+		config_info.m_multi_sample_info.rasterizationSamples = m_deco_swap_chain->getSampleCount();
+	}
+
 	float DecoRenderer::getAspectRatio() const
 	{
 		return m_deco_swap_chain->extentAspectRatio();
 	}
 
+	VkExtent2D DecoRenderer::getSwapChainExtent() const
+	{
+		return m_deco_swap_chain->getSwapChainExtent();
+	}
+
 	bool DecoRenderer::isFrameInProgress() const
 	{
 		return m_is_frame_started;
@@ -44,12 +81,59 @@ namespace Deco
 		return m_current_frame_index;
 	}
 
+	void DecoRenderer::waitForNextFrame()
+	{
+		assert(!m_is_frame_started && "Can't wait for the next frame while a frame is in progress");
+
+		m_pace_ms += m_frame_pacer.wait();
+
+		if (m_swap_chain_config.m_wait_before_input && m_deco_swap_chain != nullptr)
+		{
+			m_deco_swap_chain->waitForCurrentFrame();
+		}
+	}
+
+	void DecoRenderer::markInputSampled()
+	{
+		m_input_time = Clock::now();
+	}
+
+	void DecoRenderer::recordLatency(double& average_ms, Clock::time_point input_time)
+	{
+		if (input_time == Clock::time_point{})
+		{
+			return;
+		}
+
+		// exponential moving average over roughly the last 64 frames
+		const double latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - input_time).count();
+		average_ms = average_ms == 0.0 ? latency_ms : average_ms + (latency_ms - average_ms) / 64.0;
+	}
+
 	VkCommandBuffer DecoRenderer::beginFrame()
 	{
 		assert(!m_is_frame_started && "Can't call beginFrame while already in progress");
 
+		if (m_swap_chain_outdated && !recreateSwapChain())
+		{
+			// block on window events instead of spinning while minimized
+			glfwWaitEvents();
+			return nullptr;
+		}
+
 		auto result = m_deco_swap_chain->acquireNextImage(&m_current_image_index);
 
+		// acquireNextImage waited on the in-flight fence of this slot, which was last signaled by
+		// frame (m_frame_number - frames in flight); everything released up to it is unused now
+		const uint64_t frames_in_flight = getFramesInFlight();
+		auto& deletion_queue = m_deco_device.getDeletionQueue();
+		if (m_frame_number >= frames_in_flight)
+		{
+			deletion_queue.collect(m_frame_number - frames_in_flight + 1);
+			recordLatency(m_latency_stats.m_input_to_complete_ms, m_slot_input_times[m_current_frame_index]);
+		}
+		deletion_queue.setCurrentFrame(m_frame_number);
+
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			recreateSwapChain();
@@ -72,6 +156,9 @@ namespace Deco
 			throw std::runtime_error("Failed to begin recording command buffer!");
 		}
 
+		m_gpu_profiler.beginFrame(command_buffer, static_cast<uint32_t>(m_current_frame_index));
+
+		m_record_start = Clock::now();
 		return command_buffer;
 	}
 
@@ -84,9 +171,27 @@ namespace Deco
 		{
 			throw std::runtime_error("Failed to record command buffers");
 		}
+		const auto record_end = Clock::now();
 
 		auto result = m_deco_swap_chain->submitCommandBuffers(&command_buffer, &m_current_image_index);
 
+		DecoFrameTimings timings = m_deco_swap_chain->takeFrameTimings();
+		timings.m_pace_ms = m_pace_ms;
+		timings.m_record_ms = std::chrono::duration<double, std::milli>(record_end - m_record_start).count();
+		m_pace_ms = 0.0;
+
+		const auto frame_end = Clock::now();
+		if (m_last_frame_end != Clock::time_point{})
+		{
+			timings.m_frame_ms = std::chrono::duration<double, std::milli>(frame_end - m_last_frame_end).count();
+			m_frame_stats.addFrame(timings);
+		}
+		m_last_frame_end = frame_end;
+
+		recordLatency(m_latency_stats.m_input_to_present_ms, m_input_time);
+		m_slot_input_times[m_current_frame_index] = m_input_time;
+		m_latency_stats.m_sample_count++;
+
 		if (result == VK_ERROR_OUT_OF_DATE_KHR ||
 			result == VK_SUBOPTIMAL_KHR ||
 			m_deco_window.wasWindowResized())
@@ -94,36 +199,73 @@ namespace Deco
 			m_deco_window.resetWindowResizedFlag();
 			recreateSwapChain();
 		}
-
-		if (result != VK_SUCCESS)
+		else if (result != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to present swap chain image");
 		}
 
 		m_is_frame_started = false;
-		m_current_frame_index = (m_current_frame_index + 1) % DecoSwapChain::MAX_FRAMES_IN_FLIGHT;
+		m_current_frame_index = (m_current_frame_index + 1) % getFramesInFlight();
+
+		// objects released between frames may still be used by the frame just submitted
+		m_frame_number++;
+		m_deco_device.getDeletionQueue().setCurrentFrame(m_frame_number);
+	}
+
+	void DecoRenderer::beginComputePass(VkCommandBuffer command_buffer)
+	{
+		assert(m_is_frame_started && "Can't call beginComputePass while frame is not in progress");
+		assert(command_buffer == getCurrentCommandBuffer() && "Can't begin compute on command buffer from a different frame");
+		assert(!m_is_compute_pass_started && "Can't call beginComputePass while a compute pass is in progress");
+		assert(!m_is_render_pass_started && "Can't dispatch inside the swap chain render pass");
+
+		m_is_compute_pass_started = true;
+		m_compute_scope = m_gpu_profiler.beginScope(command_buffer, "compute");
+	}
+
+	void DecoRenderer::endComputePass(VkCommandBuffer command_buffer)
+	{
+		assert(m_is_compute_pass_started && "Can't call endComputePass without beginComputePass");
+		assert(command_buffer == getCurrentCommandBuffer() && "Can't end compute on command buffer from a different frame");
+
+		// one barrier for all of the pass's dispatches instead of one per system
+		DecoBarrier::computeToGraphics(command_buffer);
+
+		m_gpu_profiler.endScope(command_buffer, m_compute_scope);
+		m_is_compute_pass_started = false;
 	}
 
 	void DecoRenderer::beginSwapChainRenderPass(VkCommandBuffer command_buffer)
 	{
 		assert(m_is_frame_started && "Can't call beginSwapChainRenderPass while frame is not in progress");
 		assert(command_buffer == getCurrentCommandBuffer() && "Can't begin render on command buffer from a different frame");
+		assert(!m_is_compute_pass_started && "Can't begin the render pass before endComputePass");
 
-		VkRenderPassBeginInfo render_pass_info{};
-		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_info.renderPass = m_deco_swap_chain->getRenderPass();
-		render_pass_info.framebuffer = m_deco_swap_chain->getFrameBuffer(m_current_image_index);
-
-		render_pass_info.renderArea.offset = { 0,0 };
-		render_pass_info.renderArea.extent = m_deco_swap_chain->getSwapChainExtent();
+		m_is_render_pass_started = true;
 
 		std::array<VkClearValue, 2> clear_values{};
 		clear_values[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
 		clear_values[1].depthStencil = { 1.0f, 0 };
-		render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-		render_pass_info.pClearValues = clear_values.data();
 
-		vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+		if (m_deco_swap_chain->usesDynamicRendering())
+		{
+			beginDynamicRendering(command_buffer, clear_values[0], clear_values[1]);
+		}
+		else
+		{
+			VkRenderPassBeginInfo render_pass_info{};
+			render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			render_pass_info.renderPass = m_deco_swap_chain->getRenderPass();
+			render_pass_info.framebuffer = m_deco_swap_chain->getFrameBuffer(m_current_image_index);
+
+			render_pass_info.renderArea.offset = { 0,0 };
+			render_pass_info.renderArea.extent = m_deco_swap_chain->getSwapChainExtent();
+
+			render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+			render_pass_info.pClearValues = clear_values.data();
+
+			vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+		}
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -142,43 +284,178 @@ namespace Deco
 		assert(m_is_frame_started && "Can't call endSwapChainRenderPass while frame is not in progress");
 		assert(command_buffer == getCurrentCommandBuffer() && "Can't end render on command buffer from a different frame");
 
-		vkCmdEndRenderPass(command_buffer);
+		m_is_render_pass_started = false;
+
+		if (m_deco_swap_chain->usesDynamicRendering())
+		{
+			endDynamicRendering(command_buffer);
+		}
+		else
+		{
+			vkCmdEndRenderPass(command_buffer);
+		}
+	}
+
+	void DecoRenderer::beginDynamicRendering(VkCommandBuffer command_buffer, const VkClearValue& color_clear, const VkClearValue& depth_clear)
+	{
+		const bool multisampled = m_deco_swap_chain->getSampleCount() != VK_SAMPLE_COUNT_1_BIT;
+		const VkImageView swap_chain_view = m_deco_swap_chain->getImageView(m_current_image_index);
+
+		// what the render pass did implicitly: all attachments start with discarded contents, and the
+		// shared depth / MSAA color images wait for the previous frame's writes before being cleared
+		auto attachmentBarrier = [](VkImage image, VkImageLayout layout, VkImageAspectFlags aspect, VkAccessFlags src_access, VkAccessFlags dst_access)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange = { aspect, 0, 1, 0, 1 };
+			return barrier;
+		};
+
+		VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		const VkFormat depth_format = m_deco_swap_chain->getSwapChainDepthFormat();
+		if (depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT)
+		{
+			depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		std::vector<VkImageMemoryBarrier> barriers;
+		barriers.push_back(attachmentBarrier(
+			m_deco_swap_chain->getImage(m_current_image_index),
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+		barriers.push_back(attachmentBarrier(
+			m_deco_swap_chain->getDepthImage(),
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			depth_aspect,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT));
+		if (multisampled)
+		{
+			barriers.push_back(attachmentBarrier(
+				m_deco_swap_chain->getColorImage(),
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+		}
+
+		const VkPipelineStageFlags attachment_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		vkCmdPipelineBarrier(
+			command_buffer,
+			attachment_stages,
+			attachment_stages,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		// with MSAA the swap chain image is only the resolve target
+		VkRenderingAttachmentInfoKHR color_attachment{};
+		color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		color_attachment.imageView = multisampled ? m_deco_swap_chain->getColorImageView() : swap_chain_view;
+		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.clearValue = color_clear;
+		if (multisampled)
+		{
+			color_attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+			color_attachment.resolveImageView = swap_chain_view;
+			color_attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+
+		VkRenderingAttachmentInfoKHR depth_attachment{};
+		depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		depth_attachment.imageView = m_deco_swap_chain->getDepthImageView();
+		depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.clearValue = depth_clear;
+
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		rendering_info.renderArea.offset = { 0, 0 };
+		rendering_info.renderArea.extent = m_deco_swap_chain->getSwapChainExtent();
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &color_attachment;
+		rendering_info.pDepthAttachment = &depth_attachment;
+
+		m_deco_device.cmdBeginRendering(command_buffer, rendering_info);
 	}
 
-	void DecoRenderer::recreateSwapChain()
+	void DecoRenderer::endDynamicRendering(VkCommandBuffer command_buffer)
+	{
+		m_deco_device.cmdEndRendering(command_buffer);
+
+		VkImageMemoryBarrier present_barrier{};
+		present_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		present_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		present_barrier.dstAccessMask = 0;
+		present_barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		present_barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		present_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		present_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		present_barrier.image = m_deco_swap_chain->getImage(m_current_image_index);
+		present_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &present_barrier);
+	}
+
+	bool DecoRenderer::recreateSwapChain()
 	{
 		auto extent = m_deco_window.getExtent();
-		while (extent.width == 0 || extent.height == 0)
+		if (extent.width == 0 || extent.height == 0)
 		{
-			extent = m_deco_window.getExtent();
-			glfwWaitEvents();
+			// minimized, nothing can be presented; try again on a later beginFrame
+			m_swap_chain_outdated = true;
+			return false;
 		}
 
-		vkDeviceWaitIdle(m_deco_device.device());
-
+		// no device wait: the retired swap chain hands its render pass, sync objects and (if the new
+		// extent fits) depth memory to the new one, and the rest goes through the deletion queue so
+		// it is only destroyed after the frames still using it have signaled their fences
 		if (m_deco_swap_chain == nullptr)
 		{
-			m_deco_swap_chain = std::make_unique<DecoSwapChain>(m_deco_device, extent);
+			m_deco_swap_chain = std::make_unique<DecoSwapChain>(m_deco_device, extent, m_swap_chain_config);
 		}
 		else
 		{
 			std::shared_ptr<DecoSwapChain> old_swap_chain = std::move(m_deco_swap_chain);
-			m_deco_swap_chain = std::make_unique<DecoSwapChain>(m_deco_device, extent, old_swap_chain);
+			m_deco_swap_chain = std::make_unique<DecoSwapChain>(m_deco_device, extent, m_swap_chain_config, old_swap_chain);
 
 			if (!old_swap_chain->compareSwapFormats(*m_deco_swap_chain.get()))
 			{
 				throw std::runtime_error("Swap chain image(or depth) format has changed");
 			}
-		}
 
-		// if render pass compatible do nothing else
-		//createPipeline();
+			m_deco_device.getDeletionQueue().release(std::move(old_swap_chain));
+		}
 
+		m_swap_chain_outdated = false;
+		return true;
 	}
 
 	void DecoRenderer::createCommandBuffers()
 	{
-		m_command_buffers.resize(DecoSwapChain::MAX_FRAMES_IN_FLIGHT);
+		m_command_buffers.resize(getFramesInFlight());
 
 		VkCommandBufferAllocateInfo alloc_info{};
 		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
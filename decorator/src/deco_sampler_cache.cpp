@@ -0,0 +1,95 @@
+#include "deco_sampler_cache.h"
+
+#include "deco_utils.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Deco
+{
+	DecoSamplerCache::~DecoSamplerCache()
+	{
+		for (auto& kv : m_samplers)
+		{
+			vkDestroySampler(m_device, kv.second, nullptr);
+		}
+	}
+
+	VkSampler DecoSamplerCache::getSampler(const VkSamplerCreateInfo& sampler_info)
+	{
+		assert(sampler_info.pNext == nullptr && "Sampler pNext chains are not part of the cache key");
+
+		SamplerKey key{ sampler_info };
+		key.m_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		if (key.m_info.anisotropyEnable == VK_FALSE)
+		{
+			key.m_info.maxAnisotropy = 1.0f;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_samplers.find(key);
+		if (it != m_samplers.end())
+		{
+			return it->second;
+		}
+
+		VkSampler sampler;
+		if (vkCreateSampler(m_device, &key.m_info, nullptr, &sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create sampler!");
+		}
+		m_samplers.emplace(key, sampler);
+		return sampler;
+	}
+
+	VkSampler DecoSamplerCache::getLinearSampler(VkSamplerAddressMode address_mode)
+	{
+		VkSamplerCreateInfo sampler_info{};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = VK_FILTER_LINEAR;
+		sampler_info.minFilter = VK_FILTER_LINEAR;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		sampler_info.addressModeU = address_mode;
+		sampler_info.addressModeV = address_mode;
+		sampler_info.addressModeW = address_mode;
+		// samplerAnisotropy is a required device feature
+		sampler_info.anisotropyEnable = VK_TRUE;
+		sampler_info.maxAnisotropy = m_max_anisotropy;
+		sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+		sampler_info.minLod = 0.0f;
+		sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+		sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+		return getSampler(sampler_info);
+	}
+
+	size_t DecoSamplerCache::getSamplerCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_samplers.size();
+	}
+
+	bool DecoSamplerCache::SamplerKey::operator==(const SamplerKey& other) const
+	{
+		const auto& a = m_info;
+		const auto& b = other.m_info;
+		return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter &&
+			a.mipmapMode == b.mipmapMode && a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV &&
+			a.addressModeW == b.addressModeW && a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable &&
+			a.maxAnisotropy == b.maxAnisotropy && a.compareEnable == b.compareEnable && a.compareOp == b.compareOp &&
+			a.minLod == b.minLod && a.maxLod == b.maxLod && a.borderColor == b.borderColor &&
+			a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+	}
+
+	size_t DecoSamplerCache::KeyHash::operator()(const SamplerKey& key) const
+	{
+		const auto& info = key.m_info;
+		size_t hash = 0;
+		hashCombine(hash, info.flags, static_cast<uint32_t>(info.magFilter), static_cast<uint32_t>(info.minFilter),
+			static_cast<uint32_t>(info.mipmapMode), static_cast<uint32_t>(info.addressModeU),
+			static_cast<uint32_t>(info.addressModeV), static_cast<uint32_t>(info.addressModeW));
+		hashCombine(hash, info.mipLodBias, info.anisotropyEnable, info.maxAnisotropy, info.compareEnable,
+			static_cast<uint32_t>(info.compareOp), info.minLod, info.maxLod, static_cast<uint32_t>(info.borderColor),
+			info.unnormalizedCoordinates);
+		return hash;
+	}
+}
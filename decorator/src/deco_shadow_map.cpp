@@ -0,0 +1,226 @@
+#include "deco_shadow_map.h"
+
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace Deco
+{
+	DecoShadowMap::DecoShadowMap(DecoDevice& device, uint32_t resolution, uint32_t cascade_count)
+		: m_deco_device(device), m_resolution(resolution), m_cascade_count(cascade_count)
+	{
+		assert(cascade_count > 0 && "Shadow map without cascades");
+
+		m_format = m_deco_device.findSupportedFormat(
+			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+		createImage();
+		createRenderPass();
+		createFramebuffers();
+		createSampler();
+	}
+
+	DecoShadowMap::~DecoShadowMap()
+	{
+		VkDevice device = m_deco_device.device();
+		for (auto framebuffer : m_framebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		for (auto layer_view : m_layer_views)
+		{
+			vkDestroyImageView(device, layer_view, nullptr);
+		}
+		vkDestroyImageView(device, m_array_view, nullptr);
+		vkDestroyRenderPass(device, m_render_pass, nullptr);
+		vkDestroyImage(device, m_image, nullptr);
+		m_deco_device.getMemoryManager().free(m_image_memory);
+	}
+
+	void DecoShadowMap::createImage()
+	{
+		VkImageCreateInfo image_info{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.extent.width = m_resolution;
+		image_info.extent.height = m_resolution;
+		image_info.extent.depth = 1;
+		image_info.mipLevels = 1;
+		image_info.arrayLayers = m_cascade_count;
+		image_info.format = m_format;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		m_deco_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_image_memory, DecoMemoryCategory::Depth);
+
+		VkImageViewCreateInfo view_info{};
+		view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_info.image = m_image;
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		view_info.format = m_format;
+		view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		view_info.subresourceRange.baseMipLevel = 0;
+		view_info.subresourceRange.levelCount = 1;
+		view_info.subresourceRange.baseArrayLayer = 0;
+		view_info.subresourceRange.layerCount = m_cascade_count;
+		if (vkCreateImageView(m_deco_device.device(), &view_info, nullptr, &m_array_view) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shadow map view");
+		}
+
+		m_layer_views.resize(m_cascade_count);
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_info.subresourceRange.layerCount = 1;
+		for (uint32_t i = 0; i < m_cascade_count; i++)
+		{
+			view_info.subresourceRange.baseArrayLayer = i;
+			if (vkCreateImageView(m_deco_device.device(), &view_info, nullptr, &m_layer_views[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create shadow map layer view");
+			}
+		}
+	}
+
+	void DecoShadowMap::createRenderPass()
+	{
+		VkAttachmentDescription depth_attachment{};
+		depth_attachment.format = m_format;
+		depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference depth_attachment_ref{};
+		depth_attachment_ref.attachment = 0;
+		depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 0;
+		subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+		std::array<VkSubpassDependency, 2> dependencies{};
+		// the previous frame's shading may still sample the layer that is cleared here
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		// and this frame's shading samples what was drawn
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &depth_attachment;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		render_pass_info.pDependencies = dependencies.data();
+
+		if (vkCreateRenderPass(m_deco_device.device(), &render_pass_info, nullptr, &m_render_pass) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shadow render pass");
+		}
+	}
+
+	void DecoShadowMap::createFramebuffers()
+	{
+		m_framebuffers.resize(m_cascade_count);
+		for (uint32_t i = 0; i < m_cascade_count; i++)
+		{
+			VkFramebufferCreateInfo framebuffer_info{};
+			framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebuffer_info.renderPass = m_render_pass;
+			framebuffer_info.attachmentCount = 1;
+			framebuffer_info.pAttachments = &m_layer_views[i];
+			framebuffer_info.width = m_resolution;
+			framebuffer_info.height = m_resolution;
+			framebuffer_info.layers = 1;
+
+			if (vkCreateFramebuffer(m_deco_device.device(), &framebuffer_info, nullptr, &m_framebuffers[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create shadow framebuffer");
+			}
+		}
+	}
+
+	void DecoShadowMap::createSampler()
+	{
+		// linear filtering of a comparison sampler gives a 2x2 PCF tap for free where the format allows it
+		const bool linear = (m_deco_device.getFormatProperties(m_format).optimalTilingFeatures &
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+
+		VkSamplerCreateInfo sampler_info{};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		sampler_info.minFilter = sampler_info.magFilter;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		// outside the cascade counts as lit
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		sampler_info.compareEnable = VK_TRUE;
+		sampler_info.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		sampler_info.minLod = 0.0f;
+		sampler_info.maxLod = 0.0f;
+		m_sampler = m_deco_device.getSamplerCache().getSampler(sampler_info);
+	}
+
+	VkDescriptorImageInfo DecoShadowMap::getDescriptorInfo() const
+	{
+		VkDescriptorImageInfo image_info{};
+		image_info.sampler = m_sampler;
+		image_info.imageView = m_array_view;
+		image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		return image_info;
+	}
+
+	void DecoShadowMap::beginCascade(VkCommandBuffer command_buffer, uint32_t cascade)
+	{
+		assert(cascade < m_cascade_count && "Shadow cascade out of range");
+
+		VkClearValue clear_value{};
+		clear_value.depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_info.renderPass = m_render_pass;
+		render_pass_info.framebuffer = m_framebuffers[cascade];
+		render_pass_info.renderArea.offset = { 0, 0 };
+		render_pass_info.renderArea.extent = { m_resolution, m_resolution };
+		render_pass_info.clearValueCount = 1;
+		render_pass_info.pClearValues = &clear_value;
+		vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(m_resolution);
+		viewport.height = static_cast<float>(m_resolution);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ { 0, 0 }, { m_resolution, m_resolution } };
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+	}
+
+	void DecoShadowMap::endCascade(VkCommandBuffer command_buffer)
+	{
+		vkCmdEndRenderPass(command_buffer);
+	}
+}
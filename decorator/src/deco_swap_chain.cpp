@@ -2,6 +2,7 @@
 
 // std
 #include <array>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -11,13 +12,49 @@
 
 namespace Deco {
 
-	DecoSwapChain::DecoSwapChain(DecoDevice& device_ref, VkExtent2D extent)
-		: device{ device_ref }, m_window_extent{ extent } {
+	using Clock = std::chrono::steady_clock;
+
+	static double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const char* getLatencyModeName(DecoLatencyMode mode) {
+		switch (mode) {
+		case DecoLatencyMode::LowLatency:
+			return "low-latency";
+		case DecoLatencyMode::Throughput:
+			return "throughput";
+		default:
+			return "balanced";
+		}
+	}
+
+	DecoSwapChainConfig DecoSwapChainConfig::fromLatencyMode(DecoLatencyMode mode) {
+		DecoSwapChainConfig config{};
+		switch (mode) {
+		case DecoLatencyMode::LowLatency:
+			config.m_frames_in_flight = 1;
+			config.m_present_modes = { VK_PRESENT_MODE_MAILBOX_KHR };
+			config.m_wait_before_input = true;
+			break;
+		case DecoLatencyMode::Throughput:
+			config.m_frames_in_flight = 3;
+			config.m_present_modes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+			break;
+		default:
+			break;
+		}
+		return config;
+	}
+
+	DecoSwapChain::DecoSwapChain(DecoDevice& device_ref, VkExtent2D extent, const DecoSwapChainConfig& config)
+		: device{ device_ref }, m_window_extent{ extent }, m_config{ config } {
 		init();
 	}
 
-	DecoSwapChain::DecoSwapChain(DecoDevice& device_ref, VkExtent2D extent, std::shared_ptr<DecoSwapChain> previous)
-		: device{ device_ref }, m_window_extent{ extent }, m_old_swap_chain{ previous } {
+	DecoSwapChain::DecoSwapChain(
+		DecoDevice& device_ref, VkExtent2D extent, const DecoSwapChainConfig& config, std::shared_ptr<DecoSwapChain> previous)
+		: device{ device_ref }, m_window_extent{ extent }, m_config{ config }, m_old_swap_chain{ previous } {
 		init();
 		m_old_swap_chain = nullptr;
 	}
@@ -25,10 +62,57 @@ namespace Deco {
 	void DecoSwapChain::init() {
 		createSwapChain();
 		createImageViews();
-		createRenderPass();
+
+		m_swap_chain_depth_format = findDepthFormat();
+		m_msaa_samples = chooseSampleCount(m_config.m_msaa_samples);
+		m_dynamic_rendering = m_config.m_dynamic_rendering && device.supportsDynamicRendering();
+
+		// pipelines only depend on the attachment formats with dynamic rendering, and there is no
+		// render pass or framebuffer to rebuild on recreation
+		if (!m_dynamic_rendering &&
+			(m_old_swap_chain == nullptr || !adoptRenderPass(*m_old_swap_chain))) {
+			createRenderPass();
+		}
+
+		createColorResources();
 		createDepthResources();
-		createFramebuffers();
-		createSyncObjects();
+		if (!m_dynamic_rendering) {
+			createFramebuffers();
+		}
+
+		// a different frame count needs its own set of frame slots
+		if (m_old_swap_chain == nullptr ||
+			m_old_swap_chain->m_in_flight_fences.size() != m_config.m_frames_in_flight) {
+			createSyncObjects();
+		}
+		else {
+			adoptSyncObjects(*m_old_swap_chain);
+		}
+	}
+
+	bool DecoSwapChain::adoptRenderPass(DecoSwapChain& previous) {
+		// same attachment formats and samples: the old render pass is compatible, and so is every pipeline built against it
+		if (!previous.compareSwapFormats(*this) || previous.m_render_pass == VK_NULL_HANDLE) {
+			return false;
+		}
+
+		m_render_pass = previous.m_render_pass;
+		previous.m_render_pass = VK_NULL_HANDLE;
+		return true;
+	}
+
+	void DecoSwapChain::adoptSyncObjects(DecoSwapChain& previous) {
+		// keep the frame slots (and their fences) running, the renderer's frame numbering depends on it
+		m_image_available_semaphores = std::move(previous.m_image_available_semaphores);
+		m_render_finished_semaphores = std::move(previous.m_render_finished_semaphores);
+		m_in_flight_fences = std::move(previous.m_in_flight_fences);
+		m_current_frame = previous.m_current_frame;
+
+		previous.m_image_available_semaphores.clear();
+		previous.m_render_finished_semaphores.clear();
+		previous.m_in_flight_fences.clear();
+
+		m_images_in_flight.assign(imageCount(), VK_NULL_HANDLE);
 	}
 
 	DecoSwapChain::~DecoSwapChain() {
@@ -42,11 +126,8 @@ namespace Deco {
 			m_swap_chain = nullptr;
 		}
 
-		for (int i = 0; i < m_depth_images.size(); i++) {
-			vkDestroyImageView(device.device(), m_depth_image_views[i], nullptr);
-			vkDestroyImage(device.device(), m_depth_images[i], nullptr);
-			vkFreeMemory(device.device(), m_depth_image_memorys[i], nullptr);
-		}
+		destroyAttachment(m_depth_attachment);
+		destroyAttachment(m_color_attachment);
 
 		for (auto framebuffer : m_swap_chain_frame_buffers) {
 			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
@@ -54,22 +135,29 @@ namespace Deco {
 
 		vkDestroyRenderPass(device.device(), m_render_pass, nullptr);
 
-		// cleanup synchronization objects
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		// cleanup synchronization objects, empty if a newer swap chain adopted them
+		for (size_t i = 0; i < m_in_flight_fences.size(); i++) {
 			vkDestroySemaphore(device.device(), m_render_finished_semaphores[i], nullptr);
 			vkDestroySemaphore(device.device(), m_image_available_semaphores[i], nullptr);
 			vkDestroyFence(device.device(), m_in_flight_fences[i], nullptr);
 		}
 	}
 
-	VkResult DecoSwapChain::acquireNextImage(uint32_t* imageIndex) {
+	void DecoSwapChain::waitForCurrentFrame() {
+		auto waitStart = Clock::now();
 		vkWaitForFences(
 			device.device(),
 			1,
 			&m_in_flight_fences[m_current_frame],
 			VK_TRUE,
 			std::numeric_limits<uint64_t>::max());
+		m_frame_timings.m_fence_wait_ms += elapsedMs(waitStart);
+	}
 
+	VkResult DecoSwapChain::acquireNextImage(uint32_t* imageIndex) {
+		waitForCurrentFrame();
+
+		auto acquireStart = Clock::now();
 		VkResult result = vkAcquireNextImageKHR(
 			device.device(),
 			m_swap_chain,
@@ -77,13 +165,22 @@ namespace Deco {
 			m_image_available_semaphores[m_current_frame],  // must be a not signaled semaphore
 			VK_NULL_HANDLE,
 			imageIndex);
+		m_frame_timings.m_acquire_ms += elapsedMs(acquireStart);
 
 		return result;
 	}
 
+	DecoFrameTimings DecoSwapChain::takeFrameTimings() {
+		DecoFrameTimings timings = m_frame_timings;
+		m_frame_timings = DecoFrameTimings{};
+		return timings;
+	}
+
 	VkResult DecoSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
 		if (m_images_in_flight[*imageIndex] != VK_NULL_HANDLE) {
+			auto waitStart = Clock::now();
 			vkWaitForFences(device.device(), 1, &m_images_in_flight[*imageIndex], VK_TRUE, UINT64_MAX);
+			m_frame_timings.m_fence_wait_ms += elapsedMs(waitStart);
 		}
 		m_images_in_flight[*imageIndex] = m_in_flight_fences[m_current_frame];
 
@@ -103,11 +200,15 @@ namespace Deco {
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
+		auto submitStart = Clock::now();
+		auto queue_lock = device.lockQueues();
+
 		vkResetFences(device.device(), 1, &m_in_flight_fences[m_current_frame]);
 		if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, m_in_flight_fences[m_current_frame]) !=
 			VK_SUCCESS) {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
+		m_frame_timings.m_submit_ms += elapsedMs(submitStart);
 
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -121,9 +222,11 @@ namespace Deco {
 
 		presentInfo.pImageIndices = imageIndex;
 
+		auto presentStart = Clock::now();
 		auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+		m_frame_timings.m_present_ms += elapsedMs(presentStart);
 
-		m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+		m_current_frame = (m_current_frame + 1) % m_config.m_frames_in_flight;
 
 		return result;
 	}
@@ -133,6 +236,7 @@ namespace Deco {
 
 		VkSurfaceFormatKHR surface_format = chooseSwapSurfaceFormat(swap_chain_support.formats);
 		VkPresentModeKHR present_mode = chooseSwapPresentMode(swap_chain_support.presentModes);
+		m_present_mode = present_mode;
 		VkExtent2D extent = chooseSwapExtent(swap_chain_support.capabilities);
 
 		uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
@@ -213,8 +317,8 @@ namespace Deco {
 
 	void DecoSwapChain::createRenderPass() {
 		VkAttachmentDescription depthAttachment{};
-		depthAttachment.format = findDepthFormat();
-		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depthAttachment.format = m_swap_chain_depth_format;
+		depthAttachment.samples = m_msaa_samples;
 		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -226,24 +330,44 @@ namespace Deco {
 		depthAttachmentRef.attachment = 1;
 		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+		const bool multisampled = m_msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+
+		// attachment 0 is what gets drawn into: the swap chain image, or with MSAA a transient
+		// multisampled image that is resolved into the swap chain image (attachment 2) and discarded
 		VkAttachmentDescription colorAttachment = {};
 		colorAttachment.format = getSwapChainImageFormat();
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.samples = m_msaa_samples;
 		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout =
+			multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
 		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+		VkAttachmentDescription resolveAttachment = {};
+		resolveAttachment.format = getSwapChainImageFormat();
+		resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		VkAttachmentReference resolveAttachmentRef = {};
+		resolveAttachmentRef.attachment = 2;
+		resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
 		VkSubpassDescription subpass = {};
 		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 		subpass.colorAttachmentCount = 1;
 		subpass.pColorAttachments = &colorAttachmentRef;
+		subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
 		subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
 		VkSubpassDependency dependency = {};
@@ -251,13 +375,20 @@ namespace Deco {
 		dependency.dstAccessMask =
 			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		dependency.dstStageMask =
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.srcAccessMask = 0;
+		// wait for the attachment writes of earlier frames, all frames share one depth (and MSAA color) image
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		dependency.srcStageMask =
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		std::vector<VkAttachmentDescription> attachments = { colorAttachment, depthAttachment };
+		if (multisampled) {
+			attachments.push_back(resolveAttachment);
+		}
 
-		std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
@@ -275,7 +406,14 @@ namespace Deco {
 	void DecoSwapChain::createFramebuffers() {
 		m_swap_chain_frame_buffers.resize(imageCount());
 		for (size_t i = 0; i < imageCount(); i++) {
-			std::array<VkImageView, 2> attachments = { m_swap_chain_image_views[i], m_depth_image_views[i] };
+			// with MSAA the swap chain image is only the resolve target
+			std::vector<VkImageView> attachments;
+			if (m_msaa_samples == VK_SAMPLE_COUNT_1_BIT) {
+				attachments = { m_swap_chain_image_views[i], m_depth_attachment.m_view };
+			}
+			else {
+				attachments = { m_color_attachment.m_view, m_depth_attachment.m_view, m_swap_chain_image_views[i] };
+			}
 
 			VkExtent2D swapChainExtent = getSwapChainExtent();
 			VkFramebufferCreateInfo framebufferInfo = {};
@@ -298,58 +436,126 @@ namespace Deco {
 	}
 
 	void DecoSwapChain::createDepthResources() {
-		VkFormat depthFormat = findDepthFormat();
-		m_swap_chain_depth_format = depthFormat;
-		VkExtent2D swapChainExtent = getSwapChainExtent();
-
-		m_depth_images.resize(imageCount());
-		m_depth_image_memorys.resize(imageCount());
-		m_depth_image_views.resize(imageCount());
-
-		for (int i = 0; i < m_depth_images.size(); i++) {
-			VkImageCreateInfo imageInfo{};
-			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-			imageInfo.imageType = VK_IMAGE_TYPE_2D;
-			imageInfo.extent.width = swapChainExtent.width;
-			imageInfo.extent.height = swapChainExtent.height;
-			imageInfo.extent.depth = 1;
-			imageInfo.mipLevels = 1;
-			imageInfo.arrayLayers = 1;
-			imageInfo.format = depthFormat;
-			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			imageInfo.flags = 0;
-
-			device.createImageWithInfo(
-				imageInfo,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				m_depth_images[i],
-				m_depth_image_memorys[i]);
+		createAttachment(
+			m_depth_attachment,
+			m_swap_chain_depth_format,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_DEPTH_BIT,
+			m_msaa_samples,
+			m_old_swap_chain != nullptr ? &m_old_swap_chain->m_depth_attachment : nullptr);
+
+		// the old layout kept one depth image per swap chain image
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device.device(), m_depth_attachment.m_image, &memRequirements);
+		VkDeviceSize perImageSize = memRequirements.size * imageCount();
+		VkDeviceSize savedSize = perImageSize - (m_depth_attachment.m_lazily_allocated ? 0 : memRequirements.size);
+		std::cout << "Depth buffer: " << m_swap_chain_extent.width << "x" << m_swap_chain_extent.height << ", "
+			<< memRequirements.size / (1024 * 1024) << " MiB"
+			<< (m_depth_attachment.m_lazily_allocated ? " lazily allocated" : "")
+			<< ", saves up to " << savedSize / (1024 * 1024) << " MiB over one per swap chain image" << std::endl;
+	}
 
-			VkImageViewCreateInfo viewInfo{};
-			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			viewInfo.image = m_depth_images[i];
-			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			viewInfo.format = depthFormat;
-			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			viewInfo.subresourceRange.baseMipLevel = 0;
-			viewInfo.subresourceRange.levelCount = 1;
-			viewInfo.subresourceRange.baseArrayLayer = 0;
-			viewInfo.subresourceRange.layerCount = 1;
+	void DecoSwapChain::createColorResources() {
+		if (m_msaa_samples == VK_SAMPLE_COUNT_1_BIT) {
+			return;
+		}
 
-			if (vkCreateImageView(device.device(), &viewInfo, nullptr, &m_depth_image_views[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create texture image view!");
-			}
+		createAttachment(
+			m_color_attachment,
+			m_swap_chain_image_format,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			m_msaa_samples,
+			m_old_swap_chain != nullptr ? &m_old_swap_chain->m_color_attachment : nullptr);
+	}
+
+	void DecoSwapChain::createAttachment(
+		Attachment& attachment,
+		VkFormat format,
+		VkImageUsageFlags usage,
+		VkImageAspectFlags aspect,
+		VkSampleCountFlagBits samples,
+		Attachment* previous) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = m_swap_chain_extent.width;
+		imageInfo.extent.height = m_swap_chain_extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// contents never leave the render pass, tilers can keep them in on-chip memory
+		imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		imageInfo.samples = samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.flags = 0;
+
+		if (vkCreateImage(device.device(), &imageInfo, nullptr, &attachment.m_image) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create image!");
 		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device.device(), attachment.m_image, &memRequirements);
+		attachment.m_lazily_allocated = device.tryFindMemoryType(
+			memRequirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+			attachment.m_memory_type);
+		if (!attachment.m_lazily_allocated) {
+			attachment.m_memory_type = device.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+
+		// reuse the retired swap chain's allocation when the new extent fits into it; the render pass
+		// orders attachment writes across frames, so aliasing memory of frames still in flight is safe
+		if (previous != nullptr &&
+			previous->m_memory != VK_NULL_HANDLE &&
+			previous->m_memory_type == attachment.m_memory_type &&
+			previous->m_memory_size >= memRequirements.size) {
+			attachment.m_memory = previous->m_memory;
+			attachment.m_memory_size = previous->m_memory_size;
+			previous->m_memory = VK_NULL_HANDLE;
+		}
+		else {
+			attachment.m_memory = device.getMemoryManager().allocateType(
+				memRequirements.size,
+				attachment.m_memory_type,
+				(aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? DecoMemoryCategory::Depth : DecoMemoryCategory::Image);
+			attachment.m_memory_size = memRequirements.size;
+		}
+
+		if (vkBindImageMemory(device.device(), attachment.m_image, attachment.m_memory, 0) != VK_SUCCESS) {
+			throw std::runtime_error("failed to bind image memory!");
+		}
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = attachment.m_image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device.device(), &viewInfo, nullptr, &attachment.m_view) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture image view!");
+		}
+	}
+
+	void DecoSwapChain::destroyAttachment(Attachment& attachment) {
+		vkDestroyImageView(device.device(), attachment.m_view, nullptr);
+		vkDestroyImage(device.device(), attachment.m_image, nullptr);
+		device.getMemoryManager().free(attachment.m_memory);
+		attachment = Attachment{};
 	}
 
 	void DecoSwapChain::createSyncObjects() {
-		m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+		m_image_available_semaphores.resize(m_config.m_frames_in_flight);
+		m_render_finished_semaphores.resize(m_config.m_frames_in_flight);
+		m_in_flight_fences.resize(m_config.m_frames_in_flight);
 		m_images_in_flight.resize(imageCount(), VK_NULL_HANDLE);
 
 		VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -359,7 +565,7 @@ namespace Deco {
 		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		for (size_t i = 0; i < m_config.m_frames_in_flight; i++) {
 			if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &m_image_available_semaphores[i]) !=
 				VK_SUCCESS ||
 				vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &m_render_finished_semaphores[i]) !=
@@ -382,22 +588,40 @@ namespace Deco {
 		return availableFormats[0];
 	}
 
+	VkSampleCountFlagBits DecoSwapChain::chooseSampleCount(VkSampleCountFlagBits requestedSamples) {
+		const VkSampleCountFlags supportedSamples =
+			device.properties.limits.framebufferColorSampleCounts & device.properties.limits.framebufferDepthSampleCounts;
+
+		// highest supported count that does not exceed the request, 1 is always supported
+		for (VkSampleCountFlags samples = requestedSamples; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1) {
+			if (supportedSamples & samples) {
+				if (samples != requestedSamples) {
+					std::cout << "MSAA: " << requestedSamples << "x not supported, using " << samples << "x" << std::endl;
+				}
+				return static_cast<VkSampleCountFlagBits>(samples);
+			}
+		}
+		return VK_SAMPLE_COUNT_1_BIT;
+	}
+
 	VkPresentModeKHR DecoSwapChain::chooseSwapPresentMode(
 		const std::vector<VkPresentModeKHR>& availablePresentModes) {
-		for (const auto& availablePresentMode : availablePresentModes) {
-			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-				std::cout << "Present mode: Mailbox" << std::endl;
+		for (const auto& preferredPresentMode : m_config.m_present_modes) {
+			for (const auto& availablePresentMode : availablePresentModes) {
+				if (availablePresentMode != preferredPresentMode) {
+					continue;
+				}
+
+				if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+					std::cout << "Present mode: Mailbox" << std::endl;
+				}
+				else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+					std::cout << "Present mode: Immediate" << std::endl;
+				}
 				return availablePresentMode;
 			}
 		}
 
-		// for (const auto &availablePresentMode : availablePresentModes) {
-		//   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-		//     std::cout << "Present mode: Immediate" << std::endl;
-		//     return availablePresentMode;
-		//   }
-		// }
-
 		std::cout << "Present mode: V-Sync" << std::endl;
 		return VK_PRESENT_MODE_FIFO_KHR;
 	}
@@ -0,0 +1,439 @@
+#include "deco_texture.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Deco
+{
+	namespace
+	{
+		uint32_t readU32(const std::vector<uint8_t>& file, size_t offset)
+		{
+			if (offset + sizeof(uint32_t) > file.size())
+			{
+				throw std::runtime_error("unexpected end of file");
+			}
+			uint32_t value;
+			std::memcpy(&value, file.data() + offset, sizeof(value));
+			return value;
+		}
+
+		uint64_t readU64(const std::vector<uint8_t>& file, size_t offset)
+		{
+			if (offset + sizeof(uint64_t) > file.size())
+			{
+				throw std::runtime_error("unexpected end of file");
+			}
+			uint64_t value;
+			std::memcpy(&value, file.data() + offset, sizeof(value));
+			return value;
+		}
+
+		std::vector<uint8_t> readFile(const std::string& file_path)
+		{
+			std::ifstream file{ file_path, std::ios::ate | std::ios::binary };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("failed to open file: " + file_path);
+			}
+
+			const size_t file_size = static_cast<size_t>(file.tellg());
+			std::vector<uint8_t> buffer(file_size);
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(buffer.data()), file_size);
+			return buffer;
+		}
+
+		bool endsWith(const std::string& value, const std::string& suffix)
+		{
+			return value.size() >= suffix.size() &&
+				std::equal(suffix.rbegin(), suffix.rend(), value.rbegin(), [](char a, char b) { return std::tolower(a) == b; });
+		}
+
+		constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+		{
+			return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+		}
+
+		// DDS_HEADER field offsets from the start of the file, the 4 byte magic included
+		constexpr size_t DDS_HEIGHT = 12;
+		constexpr size_t DDS_WIDTH = 16;
+		constexpr size_t DDS_MIP_COUNT = 28;
+		constexpr size_t DDS_PF_FLAGS = 80;
+		constexpr size_t DDS_PF_FOURCC = 84;
+		constexpr size_t DDS_PF_RGB_BIT_COUNT = 88;
+		constexpr size_t DDS_PF_R_MASK = 92;
+		constexpr size_t DDS_PF_B_MASK = 100;
+		constexpr size_t DDS_HEADER_END = 128;
+		constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+		constexpr uint32_t DDPF_FOURCC = 0x4;
+		constexpr uint32_t DDPF_RGB = 0x40;
+	}
+
+	DecoImageData DecoImageData::loadFile(const std::string& file_path)
+	{
+		const std::vector<uint8_t> file = readFile(file_path);
+		if (endsWith(file_path, ".ktx2"))
+		{
+			return loadKtx2(file, file_path);
+		}
+		if (endsWith(file_path, ".dds"))
+		{
+			return loadDds(file, file_path);
+		}
+		throw std::runtime_error("unsupported image file: " + file_path);
+	}
+
+	DecoImageData DecoImageData::loadKtx2(const std::vector<uint8_t>& file, const std::string& file_path)
+	{
+		static const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		if (file.size() < sizeof(identifier) || std::memcmp(file.data(), identifier, sizeof(identifier)) != 0)
+		{
+			throw std::runtime_error("not a KTX2 file: " + file_path);
+		}
+
+		DecoImageData image{};
+		image.m_format = static_cast<VkFormat>(readU32(file, 12));
+		image.m_width = readU32(file, 20);
+		image.m_height = std::max(readU32(file, 24), 1u);
+		const uint32_t depth = readU32(file, 28);
+		const uint32_t layer_count = readU32(file, 32);
+		const uint32_t face_count = readU32(file, 36);
+		// 0 asks the loader to generate the chain, the file then holds the base level only
+		const uint32_t level_count = std::max(readU32(file, 40), 1u);
+		const uint32_t supercompression = readU32(file, 44);
+
+		if (depth > 1 || layer_count > 1 || face_count != 1 || supercompression != 0)
+		{
+			throw std::runtime_error("only plain 2D KTX2 textures are supported: " + file_path);
+		}
+		if (levelSize(image.m_format, 1, 1) == 0)
+		{
+			throw std::runtime_error("unsupported KTX2 format in " + file_path);
+		}
+
+		// the level index follows the 80 byte header, level 0 first
+		constexpr size_t level_index = 80;
+		for (uint32_t level = 0; level < level_count; level++)
+		{
+			const uint64_t offset = readU64(file, level_index + level * 24);
+			const uint64_t length = readU64(file, level_index + level * 24 + 8);
+
+			DecoImageLevel image_level{};
+			image_level.m_width = std::max(image.m_width >> level, 1u);
+			image_level.m_height = std::max(image.m_height >> level, 1u);
+			image_level.m_size = levelSize(image.m_format, image_level.m_width, image_level.m_height);
+			if (length < image_level.m_size || offset + length > file.size())
+			{
+				throw std::runtime_error("truncated KTX2 level in " + file_path);
+			}
+			image_level.m_offset = image.m_data.size();
+			image.m_data.insert(image.m_data.end(), file.begin() + offset, file.begin() + offset + image_level.m_size);
+			image.m_levels.push_back(image_level);
+		}
+		return image;
+	}
+
+	DecoImageData DecoImageData::loadDds(const std::vector<uint8_t>& file, const std::string& file_path)
+	{
+		if (file.size() < DDS_HEADER_END || readU32(file, 0) != makeFourCC('D', 'D', 'S', ' '))
+		{
+			throw std::runtime_error("not a DDS file: " + file_path);
+		}
+
+		DecoImageData image{};
+		image.m_height = readU32(file, DDS_HEIGHT);
+		image.m_width = readU32(file, DDS_WIDTH);
+		const uint32_t level_count = std::max(readU32(file, DDS_MIP_COUNT), 1u);
+		const uint32_t pixel_flags = readU32(file, DDS_PF_FLAGS);
+
+		size_t data_offset = DDS_HEADER_END;
+		const uint32_t four_cc = (pixel_flags & DDPF_FOURCC) != 0 ? readU32(file, DDS_PF_FOURCC) : 0;
+		if (four_cc == makeFourCC('D', 'X', '1', '0'))
+		{
+			image.m_format = dxgiToVkFormat(readU32(file, DDS_HEADER_END));
+			const uint32_t array_size = readU32(file, DDS_HEADER_END + 12);
+			if (array_size > 1)
+			{
+				throw std::runtime_error("DDS texture arrays are not supported: " + file_path);
+			}
+			data_offset += DDS_DX10_HEADER_SIZE;
+		}
+		else if (four_cc == makeFourCC('D', 'X', 'T', '1'))
+		{
+			image.m_format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		}
+		else if (four_cc == makeFourCC('D', 'X', 'T', '5'))
+		{
+			image.m_format = VK_FORMAT_BC3_UNORM_BLOCK;
+		}
+		else if (four_cc == makeFourCC('A', 'T', 'I', '2') || four_cc == makeFourCC('B', 'C', '5', 'U'))
+		{
+			image.m_format = VK_FORMAT_BC5_UNORM_BLOCK;
+		}
+		else if ((pixel_flags & DDPF_RGB) != 0 && readU32(file, DDS_PF_RGB_BIT_COUNT) == 32)
+		{
+			const uint32_t r_mask = readU32(file, DDS_PF_R_MASK);
+			const uint32_t b_mask = readU32(file, DDS_PF_B_MASK);
+			if (r_mask == 0x000000ff && b_mask == 0x00ff0000)
+			{
+				image.m_format = VK_FORMAT_R8G8B8A8_UNORM;
+			}
+			else if (r_mask == 0x00ff0000 && b_mask == 0x000000ff)
+			{
+				image.m_format = VK_FORMAT_B8G8R8A8_UNORM;
+			}
+		}
+
+		if (image.m_format == VK_FORMAT_UNDEFINED)
+		{
+			throw std::runtime_error("unsupported DDS format in " + file_path);
+		}
+
+		// levels are stored largest first, tightly packed
+		for (uint32_t level = 0; level < level_count; level++)
+		{
+			DecoImageLevel image_level{};
+			image_level.m_width = std::max(image.m_width >> level, 1u);
+			image_level.m_height = std::max(image.m_height >> level, 1u);
+			image_level.m_size = levelSize(image.m_format, image_level.m_width, image_level.m_height);
+			if (data_offset + image_level.m_size > file.size())
+			{
+				throw std::runtime_error("truncated DDS level in " + file_path);
+			}
+			image_level.m_offset = image.m_data.size();
+			image.m_data.insert(image.m_data.end(), file.begin() + data_offset, file.begin() + data_offset + image_level.m_size);
+			image.m_levels.push_back(image_level);
+			data_offset += image_level.m_size;
+		}
+		return image;
+	}
+
+	DecoImageData DecoImageData::solidColor(uint32_t rgba)
+	{
+		DecoImageData image{};
+		image.m_format = VK_FORMAT_R8G8B8A8_UNORM;
+		image.m_width = 1;
+		image.m_height = 1;
+		image.m_data.resize(sizeof(rgba));
+		std::memcpy(image.m_data.data(), &rgba, sizeof(rgba));
+		image.m_levels.push_back({ 0, sizeof(rgba), 1, 1 });
+		return image;
+	}
+
+	uint32_t DecoImageData::fullMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		{
+			levels++;
+		}
+		return levels;
+	}
+
+	size_t DecoImageData::levelSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return static_cast<size_t>(width) * height * 4;
+		default:
+			break;
+		}
+
+		// 4x4 blocks, partial blocks at the edges of small levels are stored whole
+		const size_t block_count = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+			return block_count * 8;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return block_count * 16;
+		default:
+			return 0;
+		}
+	}
+
+	bool DecoImageData::isBlockCompressed(VkFormat format)
+	{
+		return levelSize(format, 1, 1) != 0 && levelSize(format, 1, 1) == levelSize(format, 4, 4);
+	}
+
+	bool DecoImageData::isSrgb(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkFormat DecoImageData::dxgiToVkFormat(uint32_t dxgi_format)
+	{
+		switch (dxgi_format)
+		{
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;  // DXGI_FORMAT_R8G8B8A8_UNORM
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;   // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;  // DXGI_FORMAT_B8G8R8A8_UNORM
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;   // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK; // DXGI_FORMAT_BC1_UNORM
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;  // DXGI_FORMAT_BC1_UNORM_SRGB
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK; // DXGI_FORMAT_BC3_UNORM
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;  // DXGI_FORMAT_BC3_UNORM_SRGB
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK; // DXGI_FORMAT_BC4_UNORM
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK; // DXGI_FORMAT_BC4_SNORM
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK; // DXGI_FORMAT_BC5_UNORM
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK; // DXGI_FORMAT_BC5_SNORM
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK; // DXGI_FORMAT_BC7_UNORM
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;  // DXGI_FORMAT_BC7_UNORM_SRGB
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	DecoTexture::DecoTexture(DecoDevice& device, DecoBindlessHeap* bindless_heap) : m_deco_device(device), m_bindless_heap(bindless_heap)
+	{
+	}
+
+	DecoTexture::~DecoTexture()
+	{
+		releaseView();
+
+		// frames in flight may still sample the image
+		VkDevice device = m_deco_device.device();
+		DecoMemoryManager* memory_manager = &m_deco_device.getMemoryManager();
+		VkImage image = m_image;
+		VkDeviceMemory image_memory = m_image_memory;
+		if (image != VK_NULL_HANDLE)
+		{
+			m_deco_device.getDeletionQueue().push([device, memory_manager, image, image_memory]()
+				{
+					vkDestroyImage(device, image, nullptr);
+					memory_manager->free(image_memory);
+				});
+		}
+	}
+
+	VkDescriptorImageInfo DecoTexture::getDescriptorInfo() const
+	{
+		assert(isReady() && "Texture has no resident mip level yet");
+
+		VkDescriptorImageInfo image_info{};
+		image_info.sampler = m_sampler;
+		image_info.imageView = m_image_view;
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		return image_info;
+	}
+
+	void DecoTexture::createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels, VkImageUsageFlags usage)
+	{
+		assert(m_image == VK_NULL_HANDLE && "Texture image created twice");
+		assert(mip_levels <= 32 && "Completed levels are tracked in a 32 bit mask");
+
+		m_format = format;
+		m_width = width;
+		m_height = height;
+		m_mip_levels = mip_levels;
+		m_resident_mip = mip_levels;
+
+		VkImageCreateInfo image_info{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.format = format;
+		image_info.extent = { width, height, 1 };
+		image_info.mipLevels = mip_levels;
+		image_info.arrayLayers = 1;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.usage = usage;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		m_deco_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_image_memory, DecoMemoryCategory::Image);
+	}
+
+	void DecoTexture::completeLevels(uint32_t first_level, uint32_t level_count)
+	{
+		for (uint32_t level = first_level; level < first_level + level_count; level++)
+		{
+			m_completed_levels |= 1u << level;
+		}
+
+		// only a gap free chain down from the coarsest level can be sampled
+		uint32_t resident_mip = m_resident_mip;
+		while (resident_mip > 0 && (m_completed_levels & (1u << (resident_mip - 1))) != 0)
+		{
+			resident_mip--;
+		}
+		if (resident_mip == m_resident_mip)
+		{
+			return;
+		}
+		m_resident_mip = resident_mip;
+
+		// draws recorded earlier still use the old view and slot, they go through the deletion queue
+		releaseView();
+
+		VkImageViewCreateInfo view_info{};
+		view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_info.image = m_image;
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_info.format = m_format;
+		view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		view_info.subresourceRange.baseMipLevel = m_resident_mip;
+		view_info.subresourceRange.levelCount = m_mip_levels - m_resident_mip;
+		view_info.subresourceRange.baseArrayLayer = 0;
+		view_info.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(m_deco_device.device(), &view_info, nullptr, &m_image_view) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create texture image view!");
+		}
+
+		m_ready.store(true, std::memory_order_release);
+		if (m_bindless_heap != nullptr)
+		{
+			m_bindless_slot = m_bindless_heap->addSampledImage(getDescriptorInfo());
+		}
+	}
+
+	void DecoTexture::releaseView()
+	{
+		if (m_bindless_slot != DecoBindlessHeap::INVALID_SLOT)
+		{
+			m_bindless_heap->releaseSampledImage(m_bindless_slot);
+			m_bindless_slot = DecoBindlessHeap::INVALID_SLOT;
+		}
+
+		if (m_image_view != VK_NULL_HANDLE)
+		{
+			VkDevice device = m_deco_device.device();
+			VkImageView image_view = m_image_view;
+			m_deco_device.getDeletionQueue().push([device, image_view]() { vkDestroyImageView(device, image_view, nullptr); });
+			m_image_view = VK_NULL_HANDLE;
+		}
+	}
+}
@@ -0,0 +1,755 @@
+#include "deco_texture_compressor.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Deco
+{
+	namespace
+	{
+		using Texel = std::array<uint8_t, 4>;
+		using Block = std::array<Texel, 16>;
+
+		// blocks are encoded a row of blocks per task
+		struct EncodeTask
+		{
+			uint32_t m_level;
+			uint32_t m_block_row;
+		};
+
+		float srgbToLinear(float value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linearToSrgb(float value)
+		{
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		uint8_t toByte(float value)
+		{
+			return static_cast<uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
+
+		// RGBA8 levels down to 1x1, each a 2x2 box filter of the previous one (in linear space for sRGB)
+		std::vector<std::vector<uint8_t>> buildMipChain(const DecoImageData& source, bool srgb)
+		{
+			const bool bgra = source.m_format == VK_FORMAT_B8G8R8A8_UNORM || source.m_format == VK_FORMAT_B8G8R8A8_SRGB;
+
+			std::vector<std::vector<uint8_t>> levels;
+			levels.emplace_back(source.levelData(0), source.levelData(0) + source.m_levels[0].m_size);
+			if (bgra)
+			{
+				for (size_t i = 0; i < levels[0].size(); i += 4)
+				{
+					std::swap(levels[0][i], levels[0][i + 2]);
+				}
+			}
+
+			std::array<float, 256> to_linear{};
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				to_linear[i] = srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+			}
+
+			uint32_t width = source.m_width;
+			uint32_t height = source.m_height;
+			const uint32_t level_count = DecoImageData::fullMipCount(width, height);
+			for (uint32_t level = 1; level < level_count; level++)
+			{
+				const std::vector<uint8_t>& src = levels.back();
+				const uint32_t next_width = std::max(width / 2, 1u);
+				const uint32_t next_height = std::max(height / 2, 1u);
+
+				std::vector<uint8_t> dst(static_cast<size_t>(next_width) * next_height * 4);
+				for (uint32_t y = 0; y < next_height; y++)
+				{
+					for (uint32_t x = 0; x < next_width; x++)
+					{
+						// odd sizes drop the last row/column, like a linear blit
+						const uint32_t x0 = std::min(x * 2, width - 1);
+						const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+						const uint32_t y0 = std::min(y * 2, height - 1);
+						const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+						const size_t texels[4] = {
+							(static_cast<size_t>(y0) * width + x0) * 4,
+							(static_cast<size_t>(y0) * width + x1) * 4,
+							(static_cast<size_t>(y1) * width + x0) * 4,
+							(static_cast<size_t>(y1) * width + x1) * 4 };
+
+						uint8_t* out = &dst[(static_cast<size_t>(y) * next_width + x) * 4];
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							float sum = 0.0f;
+							for (size_t texel : texels)
+							{
+								sum += to_linear[src[texel + c]];
+							}
+							out[c] = toByte(srgb ? linearToSrgb(sum * 0.25f) : sum * 0.25f);
+						}
+						// alpha is always linear
+						out[3] = static_cast<uint8_t>((src[texels[0] + 3] + src[texels[1] + 3] + src[texels[2] + 3] + src[texels[3] + 3] + 2) / 4);
+					}
+				}
+
+				levels.push_back(std::move(dst));
+				width = next_width;
+				height = next_height;
+			}
+			return levels;
+		}
+
+		// the 4x4 block at (block_x, block_y), edge texels repeated for partial blocks
+		Block fetchBlock(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y)
+		{
+			Block block{};
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					const uint32_t sx = std::min(block_x * 4 + x, width - 1);
+					const uint32_t sy = std::min(block_y * 4 + y, height - 1);
+					std::memcpy(block[y * 4 + x].data(), &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+				}
+			}
+			return block;
+		}
+
+		// endpoints at the extremes of the block's principal axis over the first channel_count channels
+		void principalEndpoints(const Block& block, uint32_t channel_count, float end0[4], float end1[4])
+		{
+			float mean[4]{};
+			for (const Texel& texel : block)
+			{
+				for (uint32_t c = 0; c < channel_count; c++)
+				{
+					mean[c] += texel[c] / 16.0f;
+				}
+			}
+
+			float covariance[4][4]{};
+			for (const Texel& texel : block)
+			{
+				for (uint32_t i = 0; i < channel_count; i++)
+				{
+					for (uint32_t j = 0; j < channel_count; j++)
+					{
+						covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+					}
+				}
+			}
+
+			// seeded with the covariance row of the widest channel: a fixed seed such as (1, 1, 1, 1) can be
+			// orthogonal to the principal axis (half red, half green texels) and collapse both endpoints
+			// onto the mean
+			uint32_t widest = 0;
+			for (uint32_t c = 1; c < channel_count; c++)
+			{
+				if (covariance[c][c] > covariance[widest][widest])
+				{
+					widest = c;
+				}
+			}
+			float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			if (covariance[widest][widest] > 0.0f)
+			{
+				for (uint32_t c = 0; c < channel_count; c++)
+				{
+					axis[c] = covariance[widest][c] / covariance[widest][widest];
+				}
+			}
+
+			// a few rounds of power iteration are plenty for a 4x4 block
+			for (uint32_t iteration = 0; iteration < 8; iteration++)
+			{
+				float next[4]{};
+				float length = 0.0f;
+				for (uint32_t i = 0; i < channel_count; i++)
+				{
+					for (uint32_t j = 0; j < channel_count; j++)
+					{
+						next[i] += covariance[i][j] * axis[j];
+					}
+					length = std::max(length, std::abs(next[i]));
+				}
+				if (length < 1e-6f)
+				{
+					break;
+				}
+				for (uint32_t i = 0; i < channel_count; i++)
+				{
+					axis[i] = next[i] / length;
+				}
+			}
+
+			float min_t = 0.0f;
+			float max_t = 0.0f;
+			for (const Texel& texel : block)
+			{
+				float t = 0.0f;
+				for (uint32_t c = 0; c < channel_count; c++)
+				{
+					t += (texel[c] - mean[c]) * axis[c];
+				}
+				min_t = std::min(min_t, t);
+				max_t = std::max(max_t, t);
+			}
+
+			float axis_length_squared = 0.0f;
+			for (uint32_t c = 0; c < channel_count; c++)
+			{
+				axis_length_squared += axis[c] * axis[c];
+			}
+			const float scale = axis_length_squared > 0.0f ? 1.0f / axis_length_squared : 0.0f;
+			for (uint32_t c = 0; c < channel_count; c++)
+			{
+				end0[c] = std::clamp(mean[c] + axis[c] * max_t * scale, 0.0f, 255.0f);
+				end1[c] = std::clamp(mean[c] + axis[c] * min_t * scale, 0.0f, 255.0f);
+			}
+		}
+
+		uint16_t packRgb565(const float color[3])
+		{
+			const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+			const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+			const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		void unpackRgb565(uint16_t packed, int32_t color[3])
+		{
+			const int32_t r = (packed >> 11) & 31;
+			const int32_t g = (packed >> 5) & 63;
+			const int32_t b = packed & 31;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+		}
+
+		// BC1 color block in four color mode (also the color half of BC3)
+		void encodeBc1(const Block& block, uint8_t* out)
+		{
+			float end0[4];
+			float end1[4];
+			principalEndpoints(block, 3, end0, end1);
+
+			uint16_t color0 = packRgb565(end0);
+			uint16_t color1 = packRgb565(end1);
+			// color0 > color1 selects four color mode, equal endpoints only ever use index 0
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+
+			int32_t palette[4][3];
+			unpackRgb565(color0, palette[0]);
+			unpackRgb565(color1, palette[1]);
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			uint32_t indices = 0;
+			if (color0 != color1)
+			{
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					uint32_t best_index = 0;
+					int32_t best_error = INT32_MAX;
+					for (uint32_t p = 0; p < 4; p++)
+					{
+						int32_t error = 0;
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							const int32_t d = block[i][c] - palette[p][c];
+							error += d * d;
+						}
+						if (error < best_error)
+						{
+							best_error = error;
+							best_index = p;
+						}
+					}
+					indices |= best_index << (i * 2);
+				}
+			}
+
+			std::memcpy(out, &color0, 2);
+			std::memcpy(out + 2, &color1, 2);
+			std::memcpy(out + 4, &indices, 4);
+		}
+
+		// BC4 single channel block in eight value mode (the alpha half of BC3, each half of BC5)
+		void encodeBc4(const Block& block, uint32_t channel, uint8_t* out)
+		{
+			uint8_t max_value = 0;
+			uint8_t min_value = 255;
+			for (const Texel& texel : block)
+			{
+				max_value = std::max(max_value, texel[channel]);
+				min_value = std::min(min_value, texel[channel]);
+			}
+
+			int32_t palette[8];
+			palette[0] = max_value;
+			palette[1] = min_value;
+			for (int32_t p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * max_value + p * min_value) / 7;
+			}
+
+			uint64_t indices = 0;
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint64_t best_index = 0;
+				int32_t best_error = INT32_MAX;
+				for (uint32_t p = 0; p < 8; p++)
+				{
+					const int32_t error = std::abs(block[i][channel] - palette[p]);
+					if (error < best_error)
+					{
+						best_error = error;
+						best_index = p;
+					}
+				}
+				indices |= best_index << (i * 3);
+			}
+
+			out[0] = max_value;
+			out[1] = min_value;
+			std::memcpy(out + 2, &indices, 6);
+		}
+
+		class BitWriter
+		{
+		public:
+			explicit BitWriter(uint8_t* out) : m_out(out) { std::memset(m_out, 0, 16); }
+
+			void write(uint32_t value, uint32_t bit_count)
+			{
+				for (uint32_t i = 0; i < bit_count; i++, m_position++)
+				{
+					m_out[m_position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (m_position % 8));
+				}
+			}
+
+		private:
+			uint8_t* m_out;
+			uint32_t m_position{ 0 };
+		};
+
+		// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a shared p-bit each, 4 bit indices
+		void encodeBc7(const Block& block, uint8_t* out)
+		{
+			static const int32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+			float ends[2][4];
+			principalEndpoints(block, 4, ends[0], ends[1]);
+
+			uint32_t quantized[2][4];
+			uint32_t p_bits[2];
+			int32_t endpoints[2][4];
+			for (uint32_t e = 0; e < 2; e++)
+			{
+				float best_error = 0.0f;
+				for (uint32_t p = 0; p < 2; p++)
+				{
+					uint32_t q[4];
+					float error = 0.0f;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						q[c] = static_cast<uint32_t>(std::clamp((ends[e][c] - p) / 2.0f + 0.5f, 0.0f, 127.0f));
+						const float d = static_cast<float>(q[c] * 2 + p) - ends[e][c];
+						error += d * d;
+					}
+					if (p == 0 || error < best_error)
+					{
+						best_error = error;
+						p_bits[e] = p;
+						std::memcpy(quantized[e], q, sizeof(q));
+					}
+				}
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					endpoints[e][c] = static_cast<int32_t>(quantized[e][c] * 2 + p_bits[e]);
+				}
+			}
+
+			int32_t palette[16][4];
+			for (uint32_t p = 0; p < 16; p++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					palette[p][c] = ((64 - weights[p]) * endpoints[0][c] + weights[p] * endpoints[1][c] + 32) >> 6;
+				}
+			}
+
+			uint32_t indices[16];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				int32_t best_error = INT32_MAX;
+				for (uint32_t p = 0; p < 16; p++)
+				{
+					int32_t error = 0;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						const int32_t d = block[i][c] - palette[p][c];
+						error += d * d;
+					}
+					if (error < best_error)
+					{
+						best_error = error;
+						indices[i] = p;
+					}
+				}
+			}
+
+			// the anchor index is stored without its top bit, swap the endpoints so it is clear
+			if (indices[0] >= 8)
+			{
+				std::swap(quantized[0], quantized[1]);
+				std::swap(p_bits[0], p_bits[1]);
+				for (uint32_t& index : indices)
+				{
+					index = 15 - index;
+				}
+			}
+
+			BitWriter writer{ out };
+			writer.write(1u << 6, 7);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				writer.write(quantized[0][c], 7);
+				writer.write(quantized[1][c], 7);
+			}
+			writer.write(p_bits[0], 1);
+			writer.write(p_bits[1], 1);
+			writer.write(indices[0], 3);
+			for (uint32_t i = 1; i < 16; i++)
+			{
+				writer.write(indices[i], 4);
+			}
+		}
+
+		void encodeBlock(VkFormat format, const Block& block, uint8_t* out)
+		{
+			switch (format)
+			{
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+				encodeBc1(block, out);
+				break;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				encodeBc4(block, 3, out);
+				encodeBc1(block, out + 8);
+				break;
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				encodeBc4(block, 0, out);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				encodeBc4(block, 0, out);
+				encodeBc4(block, 1, out + 8);
+				break;
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				encodeBc7(block, out);
+				break;
+			default:
+				// compress() rejects the format before any block is encoded
+				assert(false && "no CPU encoder for this texture format");
+				break;
+			}
+		}
+
+		constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x58455444; // "DTEX"
+		constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+		struct TextureCacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t source_size;
+			int64_t source_time;
+			uint32_t format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t level_count;
+		};
+	}
+
+	DecoCompressedFormats DecoTextureCompressor::chooseFormats(DecoDevice& device, DecoTextureCompression compression)
+	{
+		std::vector<VkFormat> linear_candidates;
+		std::vector<VkFormat> srgb_candidates;
+		if (device.supportsTextureCompressionBC())
+		{
+			switch (compression)
+			{
+			case DecoTextureCompression::Color:
+				linear_candidates = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK };
+				srgb_candidates = { VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK };
+				break;
+			case DecoTextureCompression::ColorAlpha:
+				linear_candidates = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK };
+				srgb_candidates = { VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK };
+				break;
+			case DecoTextureCompression::Normal:
+				// normals are never sRGB encoded
+				linear_candidates = { VK_FORMAT_BC5_UNORM_BLOCK };
+				srgb_candidates = { VK_FORMAT_BC5_UNORM_BLOCK };
+				break;
+			case DecoTextureCompression::None:
+				break;
+			}
+		}
+		// always sampleable, so findSupportedFormat never runs out of candidates
+		linear_candidates.push_back(VK_FORMAT_R8G8B8A8_UNORM);
+		srgb_candidates.push_back(VK_FORMAT_R8G8B8A8_SRGB);
+
+		const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		DecoCompressedFormats formats{};
+		formats.m_linear = device.findSupportedFormat(linear_candidates, VK_IMAGE_TILING_OPTIMAL, features);
+		formats.m_srgb = device.findSupportedFormat(srgb_candidates, VK_IMAGE_TILING_OPTIMAL, features);
+		return formats;
+	}
+
+	bool DecoTextureCompressor::canEncode(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	DecoImageData DecoTextureCompressor::compress(const DecoImageData& source, VkFormat format, DecoThreadPool* thread_pool)
+	{
+		if (DecoImageData::isBlockCompressed(source.m_format) || DecoImageData::levelSize(source.m_format, 1, 1) != 4)
+		{
+			throw std::runtime_error("only RGBA8 and BGRA8 images can be compressed");
+		}
+		// checked here, a throw from encodeBlock inside a pool task would terminate the process
+		if (!canEncode(format))
+		{
+			throw std::runtime_error("no CPU encoder for this texture format");
+		}
+
+		const std::vector<std::vector<uint8_t>> levels = buildMipChain(source, DecoImageData::isSrgb(source.m_format));
+
+		DecoImageData image{};
+		image.m_format = format;
+		image.m_width = source.m_width;
+		image.m_height = source.m_height;
+
+		std::vector<EncodeTask> tasks;
+		for (uint32_t level = 0; level < levels.size(); level++)
+		{
+			DecoImageLevel image_level{};
+			image_level.m_width = std::max(source.m_width >> level, 1u);
+			image_level.m_height = std::max(source.m_height >> level, 1u);
+			image_level.m_size = DecoImageData::levelSize(format, image_level.m_width, image_level.m_height);
+			image_level.m_offset = image.m_data.size();
+			image.m_data.resize(image.m_data.size() + image_level.m_size);
+			image.m_levels.push_back(image_level);
+
+			for (uint32_t block_row = 0; block_row < (image_level.m_height + 3) / 4; block_row++)
+			{
+				tasks.push_back({ level, block_row });
+			}
+		}
+
+		const size_t block_size = DecoImageData::levelSize(format, 4, 4);
+		auto encodeRow = [&](uint32_t task_index)
+		{
+			const EncodeTask& task = tasks[task_index];
+			const DecoImageLevel& image_level = image.m_levels[task.m_level];
+			const uint32_t blocks_per_row = (image_level.m_width + 3) / 4;
+
+			uint8_t* out = image.m_data.data() + image_level.m_offset + static_cast<size_t>(task.m_block_row) * blocks_per_row * block_size;
+			for (uint32_t block_x = 0; block_x < blocks_per_row; block_x++, out += block_size)
+			{
+				const Block block = fetchBlock(levels[task.m_level], image_level.m_width, image_level.m_height, block_x, task.m_block_row);
+				encodeBlock(format, block, out);
+			}
+		};
+
+		if (thread_pool != nullptr)
+		{
+			thread_pool->parallelFor(static_cast<uint32_t>(tasks.size()), encodeRow);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < tasks.size(); i++)
+			{
+				encodeRow(i);
+			}
+		}
+		return image;
+	}
+
+	DecoImageData DecoTextureCompressor::loadCompressed(
+		const std::string& file_path,
+		const DecoCompressedFormats& formats,
+		DecoThreadPool* thread_pool)
+	{
+		std::error_code error;
+		const uint64_t source_size = static_cast<uint64_t>(std::filesystem::file_size(file_path, error));
+		if (error)
+		{
+			// let the image loader report the missing file
+			return DecoImageData::loadFile(file_path);
+		}
+		const int64_t source_time = static_cast<int64_t>(
+			std::filesystem::last_write_time(file_path, error).time_since_epoch().count());
+
+		const std::string cache_path = file_path + ".texcache";
+		DecoImageData image{};
+		if (readCache(cache_path, source_size, source_time, formats, image))
+		{
+			return image;
+		}
+
+		image = DecoImageData::loadFile(file_path);
+		const VkFormat format = DecoImageData::isSrgb(image.m_format) ? formats.m_srgb : formats.m_linear;
+		if (DecoImageData::isBlockCompressed(image.m_format) || !DecoImageData::isBlockCompressed(format))
+		{
+			return image;
+		}
+
+		image = compress(image, format, thread_pool);
+		writeCache(cache_path, source_size, source_time, image);
+		return image;
+	}
+
+	bool DecoTextureCompressor::readCache(
+		const std::string& cache_path,
+		uint64_t source_size,
+		int64_t source_time,
+		const DecoCompressedFormats& formats,
+		DecoImageData& image)
+	{
+		std::ifstream file(cache_path, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		TextureCacheHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		const VkFormat format = static_cast<VkFormat>(header.format);
+		if (!file ||
+			header.magic != TEXTURE_CACHE_MAGIC ||
+			header.version != TEXTURE_CACHE_VERSION ||
+			header.source_size != source_size ||
+			header.source_time != source_time ||
+			(format != formats.m_linear && format != formats.m_srgb) ||
+			header.width == 0 ||
+			header.height == 0 ||
+			header.level_count != DecoImageData::fullMipCount(header.width, header.height))
+		{
+			return false;
+		}
+
+		image.m_format = format;
+		image.m_width = header.width;
+		image.m_height = header.height;
+		for (uint32_t level = 0; level < header.level_count; level++)
+		{
+			DecoImageLevel image_level{};
+			image_level.m_width = std::max(header.width >> level, 1u);
+			image_level.m_height = std::max(header.height >> level, 1u);
+			image_level.m_size = DecoImageData::levelSize(format, image_level.m_width, image_level.m_height);
+			image_level.m_offset = image.m_levels.empty() ? 0 : image.m_levels.back().m_offset + image.m_levels.back().m_size;
+			image.m_levels.push_back(image_level);
+		}
+
+		// the header is not trusted to size the allocation, the levels it describes must fill the file exactly
+		std::error_code error;
+		const uint64_t file_size = static_cast<uint64_t>(std::filesystem::file_size(cache_path, error));
+		if (error || file_size != sizeof(header) + image.m_levels.back().m_offset + image.m_levels.back().m_size)
+		{
+			image = DecoImageData{};
+			return false;
+		}
+
+		image.m_data.resize(image.m_levels.back().m_offset + image.m_levels.back().m_size);
+		file.read(reinterpret_cast<char*>(image.m_data.data()), image.m_data.size());
+
+		if (!file)
+		{
+			image = DecoImageData{};
+			return false;
+		}
+		return true;
+	}
+
+	void DecoTextureCompressor::writeCache(const std::string& cache_path, uint64_t source_size, int64_t source_time, const DecoImageData& image)
+	{
+		// write to a temporary first so a concurrent reader never sees a half written cache, named per
+		// writer so two threads caching the same texture never write into the same file
+		static std::atomic<uint64_t> temp_counter{ 0 };
+		const std::string temp_path = cache_path + "." +
+			std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "." +
+			std::to_string(temp_counter++) + ".tmp";
+		bool written = false;
+		{
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return;
+			}
+
+			TextureCacheHeader header{};
+			header.magic = TEXTURE_CACHE_MAGIC;
+			header.version = TEXTURE_CACHE_VERSION;
+			header.source_size = source_size;
+			header.source_time = source_time;
+			header.format = static_cast<uint32_t>(image.m_format);
+			header.width = image.m_width;
+			header.height = image.m_height;
+			header.level_count = static_cast<uint32_t>(image.m_levels.size());
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(image.m_data.data()), image.m_data.size());
+			written = static_cast<bool>(file);
+		}
+
+		// a failed write or rename only costs another compression next time, the partial file goes
+		std::error_code error;
+		if (written)
+		{
+			std::filesystem::rename(temp_path, cache_path, error);
+		}
+		if (!written || error)
+		{
+			std::filesystem::remove(temp_path, error);
+		}
+	}
+}
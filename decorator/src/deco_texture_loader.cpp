@@ -0,0 +1,456 @@
+#include "deco_texture_loader.h"
+#include "deco_barrier.h"
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace Deco
+{
+	namespace
+	{
+		// bufferOffset of a copy must be a multiple of the texel block size, 16 covers every format
+		constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+		void imageLevelBarrier(
+			VkCommandBuffer command_buffer,
+			VkImage image,
+			uint32_t level,
+			VkImageLayout old_layout,
+			VkImageLayout new_layout,
+			VkAccessFlags src_access,
+			VkAccessFlags dst_access,
+			VkPipelineStageFlags src_stage,
+			VkPipelineStageFlags dst_stage)
+		{
+			DecoBarrier::image(
+				command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+				old_layout, new_layout,
+				src_stage, src_access,
+				dst_stage, dst_access,
+				level, 1);
+		}
+	}
+
+	DecoTextureLoader::DecoTextureLoader(DecoDevice& device, DecoBindlessHeap* bindless_heap, uint32_t worker_count, VkDeviceSize upload_budget)
+		: m_deco_device(device), m_bindless_heap(bindless_heap), m_upload_budget(upload_budget), m_thread_pool(worker_count)
+	{
+	}
+
+	DecoTextureLoader::~DecoTextureLoader()
+	{
+		m_thread_pool.waitIdle();
+		retireUploads(true);
+	}
+
+	std::shared_ptr<DecoTexture> DecoTextureLoader::createTextureFromFile(
+		const std::string& file_path,
+		VkSampler sampler,
+		DecoTextureCompression compression)
+	{
+		auto texture = std::make_shared<DecoTexture>(m_deco_device, m_bindless_heap);
+
+		DecoCompressedFormats formats{};
+		if (compression != DecoTextureCompression::None)
+		{
+			formats = DecoTextureCompressor::chooseFormats(m_deco_device, compression);
+		}
+		const bool compress = DecoImageData::isBlockCompressed(formats.m_linear) || DecoImageData::isBlockCompressed(formats.m_srgb);
+		if (compress && m_encode_thread_pool == nullptr)
+		{
+			m_encode_thread_pool = std::make_unique<DecoThreadPool>();
+		}
+		DecoThreadPool* encode_thread_pool = m_encode_thread_pool.get();
+
+		m_undecoded_count++;
+		m_thread_pool.enqueue([this, texture, file_path, sampler, compress, formats, encode_thread_pool]()
+			{
+				DecodedTexture decoded{};
+				decoded.m_texture = texture;
+				decoded.m_sampler = sampler;
+				decoded.m_file_path = file_path;
+
+				try
+				{
+					decoded.m_image = compress ?
+						DecoTextureCompressor::loadCompressed(file_path, formats, encode_thread_pool) :
+						DecoImageData::loadFile(file_path);
+				}
+				catch (const std::exception& e)
+				{
+					decoded.m_error = e.what();
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_decoded_mutex);
+					m_decoded_textures.push_back(std::move(decoded));
+				}
+			});
+
+		return texture;
+	}
+
+	std::shared_ptr<DecoTexture> DecoTextureLoader::createTexture(DecoImageData image, VkSampler sampler)
+	{
+		auto texture = std::make_shared<DecoTexture>(m_deco_device, m_bindless_heap);
+
+		DecodedTexture decoded{};
+		decoded.m_texture = texture;
+		decoded.m_image = std::move(image);
+		decoded.m_sampler = sampler;
+		decoded.m_file_path = "<memory>";
+
+		m_undecoded_count++;
+		{
+			std::lock_guard<std::mutex> lock(m_decoded_mutex);
+			m_decoded_textures.push_back(std::move(decoded));
+		}
+		return texture;
+	}
+
+	void DecoTextureLoader::update()
+	{
+		retireUploads(false);
+		startDecodedTextures();
+		submitUploads(false);
+	}
+
+	void DecoTextureLoader::waitIdle()
+	{
+		m_thread_pool.waitIdle();
+		startDecodedTextures();
+		while (!m_streaming_textures.empty())
+		{
+			submitUploads(true);
+		}
+		retireUploads(true);
+	}
+
+	bool DecoTextureLoader::isIdle() const
+	{
+		return m_undecoded_count.load() == 0 && m_streaming_textures.empty() && m_pending_uploads.empty();
+	}
+
+	void DecoTextureLoader::startDecodedTextures()
+	{
+		std::vector<DecodedTexture> decoded_textures;
+		{
+			std::lock_guard<std::mutex> lock(m_decoded_mutex);
+			decoded_textures.swap(m_decoded_textures);
+		}
+		m_undecoded_count -= static_cast<uint32_t>(decoded_textures.size());
+
+		// a texture that cannot be loaded is reported and never becomes ready, the rest of the batch
+		// still streams in
+		for (auto& decoded : decoded_textures)
+		{
+			if (!decoded.m_error.empty())
+			{
+				std::cerr << "Failed to load texture " << decoded.m_file_path << ": " << decoded.m_error << std::endl;
+				continue;
+			}
+
+			const DecoImageData& image = decoded.m_image;
+			const VkFormatProperties format_properties = m_deco_device.getFormatProperties(image.m_format);
+			if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+			{
+				std::cerr << "Failed to load texture " << decoded.m_file_path << ": format cannot be sampled on this device" << std::endl;
+				continue;
+			}
+
+			// without linear blits the texture stays single level rather than getting a point sampled chain
+			const VkFormatFeatureFlags blit_features =
+				VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			const uint32_t full_mip_count = DecoImageData::fullMipCount(image.m_width, image.m_height);
+
+			StreamingTexture streaming{};
+			streaming.m_generate_mips = image.m_levels.size() == 1 && full_mip_count > 1 &&
+				(format_properties.optimalTilingFeatures & blit_features) == blit_features;
+			streaming.m_remaining_levels = static_cast<uint32_t>(image.m_levels.size());
+
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			if (streaming.m_generate_mips)
+			{
+				usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
+
+			auto& texture = *decoded.m_texture;
+			texture.m_sampler = decoded.m_sampler != VK_NULL_HANDLE ? decoded.m_sampler : m_deco_device.getSamplerCache().getLinearSampler();
+			try
+			{
+				texture.createImage(
+					image.m_format,
+					image.m_width,
+					image.m_height,
+					streaming.m_generate_mips ? full_mip_count : static_cast<uint32_t>(image.m_levels.size()),
+					usage);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Failed to load texture " << decoded.m_file_path << ": " << e.what() << std::endl;
+				continue;
+			}
+
+			streaming.m_texture = std::move(decoded.m_texture);
+			streaming.m_image = std::move(decoded.m_image);
+			m_streaming_textures.push_back(std::move(streaming));
+		}
+	}
+
+	void DecoTextureLoader::submitUploads(bool ignore_budget)
+	{
+		if (m_streaming_textures.empty())
+		{
+			return;
+		}
+
+		struct PlannedLevel
+		{
+			size_t m_texture;
+			uint32_t m_level;
+			VkDeviceSize m_staging_offset;
+		};
+
+		// one level per texture per round, coarsest first, so every texture gets something on screen
+		// before any of them spends the budget on its finest levels; the first level always fits
+		std::vector<PlannedLevel> planned;
+		VkDeviceSize staging_size = 0;
+		bool progressed = true;
+		while (progressed)
+		{
+			progressed = false;
+			for (size_t i = 0; i < m_streaming_textures.size(); i++)
+			{
+				auto& streaming = m_streaming_textures[i];
+				if (streaming.m_remaining_levels == 0)
+				{
+					continue;
+				}
+
+				const uint32_t level = streaming.m_remaining_levels - 1;
+				const VkDeviceSize offset = (staging_size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+				const VkDeviceSize end = offset + streaming.m_image.m_levels[level].m_size;
+				if (!ignore_budget && !planned.empty() && end > m_upload_budget)
+				{
+					continue;
+				}
+
+				planned.push_back({ i, level, offset });
+				staging_size = end;
+				streaming.m_remaining_levels--;
+				progressed = true;
+			}
+		}
+
+		if (planned.empty())
+		{
+			return;
+		}
+
+		PendingUpload upload{};
+		upload.m_staging_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			1,
+			static_cast<uint32_t>(staging_size),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		upload.m_staging_buffer->map();
+		auto* staging = static_cast<uint8_t*>(upload.m_staging_buffer->getMappedMemory());
+
+		VkCommandBufferAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandPool = m_deco_device.getCommandPool();
+		alloc_info.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_deco_device.device(), &alloc_info, &upload.m_command_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer");
+		}
+
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(upload.m_command_buffer, &begin_info);
+
+		for (const auto& planned_level : planned)
+		{
+			const auto& streaming = m_streaming_textures[planned_level.m_texture];
+			const auto& level = streaming.m_image.m_levels[planned_level.m_level];
+			std::memcpy(staging + planned_level.m_staging_offset, streaming.m_image.levelData(planned_level.m_level), level.m_size);
+
+			recordLevelUpload(
+				upload.m_command_buffer, streaming, planned_level.m_level, upload.m_staging_buffer->getBuffer(), planned_level.m_staging_offset);
+			if (streaming.m_generate_mips)
+			{
+				recordMipGeneration(upload.m_command_buffer, *streaming.m_texture);
+				upload.m_levels.push_back({ streaming.m_texture, 0, streaming.m_texture->getMipLevels() });
+			}
+			else
+			{
+				upload.m_levels.push_back({ streaming.m_texture, planned_level.m_level, 1 });
+			}
+		}
+
+		vkEndCommandBuffer(upload.m_command_buffer);
+
+		VkFenceCreateInfo fence_info{};
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(m_deco_device.device(), &fence_info, nullptr, &upload.m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload fence");
+		}
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &upload.m_command_buffer;
+
+		{
+			auto queue_lock = m_deco_device.lockQueues();
+			if (vkQueueSubmit(m_deco_device.graphicsQueue(), 1, &submit_info, upload.m_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit upload command buffer");
+			}
+		}
+
+		m_pending_uploads.push_back(std::move(upload));
+
+		auto it = m_streaming_textures.begin();
+		while (it != m_streaming_textures.end())
+		{
+			it = it->m_remaining_levels == 0 ? m_streaming_textures.erase(it) : it + 1;
+		}
+	}
+
+	void DecoTextureLoader::retireUploads(bool wait)
+	{
+		auto it = m_pending_uploads.begin();
+		while (it != m_pending_uploads.end())
+		{
+			if (wait)
+			{
+				vkWaitForFences(m_deco_device.device(), 1, &it->m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			}
+			else if (vkGetFenceStatus(m_deco_device.device(), it->m_fence) != VK_SUCCESS)
+			{
+				++it;
+				continue;
+			}
+
+			for (auto& levels : it->m_levels)
+			{
+				levels.m_texture->completeLevels(levels.m_first_level, levels.m_level_count);
+			}
+
+			vkDestroyFence(m_deco_device.device(), it->m_fence, nullptr);
+			vkFreeCommandBuffers(m_deco_device.device(), m_deco_device.getCommandPool(), 1, &it->m_command_buffer);
+			it = m_pending_uploads.erase(it);
+		}
+	}
+
+	void DecoTextureLoader::recordLevelUpload(
+		VkCommandBuffer command_buffer,
+		const StreamingTexture& streaming,
+		uint32_t level,
+		VkBuffer staging_buffer,
+		VkDeviceSize staging_offset)
+	{
+		const VkImage image = streaming.m_texture->getImage();
+		const auto& image_level = streaming.m_image.m_levels[level];
+
+		imageLevelBarrier(
+			command_buffer, image, level,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = staging_offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { image_level.m_width, image_level.m_height, 1 };
+
+		vkCmdCopyBufferToImage(
+			command_buffer,
+			staging_buffer,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&region);
+
+		// recordMipGeneration reads the base level as a blit source
+		if (!streaming.m_generate_mips)
+		{
+			imageLevelBarrier(
+				command_buffer, image, level,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
+	}
+
+	void DecoTextureLoader::recordMipGeneration(VkCommandBuffer command_buffer, const DecoTexture& texture)
+	{
+		const VkImage image = texture.getImage();
+		int32_t width = static_cast<int32_t>(texture.getWidth());
+		int32_t height = static_cast<int32_t>(texture.getHeight());
+
+		for (uint32_t level = 1; level < texture.getMipLevels(); level++)
+		{
+			const int32_t next_width = width > 1 ? width / 2 : 1;
+			const int32_t next_height = height > 1 ? height / 2 : 1;
+
+			imageLevelBarrier(
+				command_buffer, image, level - 1,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			imageLevelBarrier(
+				command_buffer, image, level,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				0, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[1] = { width, height, 1 };
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = level - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[1] = { next_width, next_height, 1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = level;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+			vkCmdBlitImage(
+				command_buffer,
+				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit,
+				VK_FILTER_LINEAR);
+
+			imageLevelBarrier(
+				command_buffer, image, level - 1,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+			width = next_width;
+			height = next_height;
+		}
+
+		imageLevelBarrier(
+			command_buffer, image, texture.getMipLevels() - 1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+}
@@ -0,0 +1,133 @@
+#include "deco_thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace Deco
+{
+	DecoThreadPool::DecoThreadPool(uint32_t worker_count)
+	{
+		if (worker_count == 0)
+		{
+			uint32_t hardware_threads = std::thread::hardware_concurrency();
+			worker_count = std::max(hardware_threads, 2u) - 1;
+		}
+
+		m_workers.reserve(worker_count);
+		for (uint32_t i = 0; i < worker_count; i++)
+		{
+			m_workers.emplace_back(&DecoThreadPool::workerLoop, this);
+		}
+	}
+
+	DecoThreadPool::~DecoThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_task_available.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	void DecoThreadPool::enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_task_available.notify_one();
+	}
+
+	void DecoThreadPool::parallelFor(uint32_t task_count, const std::function<void(uint32_t)>& task)
+	{
+		if (task_count == 0)
+		{
+			return;
+		}
+
+		struct Batch
+		{
+			std::atomic<uint32_t> m_next_task{ 0 };
+			std::mutex m_mutex;
+			std::condition_variable m_done;
+			uint32_t m_running_helpers{ 0 };
+		};
+		auto batch = std::make_shared<Batch>();
+
+		// helpers and the caller pull task indices until none are left
+		auto runTasks = [batch, &task, task_count]()
+		{
+			for (uint32_t index = batch->m_next_task++; index < task_count; index = batch->m_next_task++)
+			{
+				task(index);
+			}
+		};
+
+		const uint32_t helper_count = std::min(task_count - 1, getWorkerCount());
+		batch->m_running_helpers = helper_count;
+		for (uint32_t i = 0; i < helper_count; i++)
+		{
+			enqueue([batch, runTasks]()
+				{
+					runTasks();
+
+					std::lock_guard<std::mutex> lock(batch->m_mutex);
+					if (--batch->m_running_helpers == 0)
+					{
+						batch->m_done.notify_all();
+					}
+				});
+		}
+
+		runTasks();
+
+		// task is captured by reference, every helper has to be out of it before returning
+		std::unique_lock<std::mutex> lock(batch->m_mutex);
+		batch->m_done.wait(lock, [&batch]() { return batch->m_running_helpers == 0; });
+	}
+
+	void DecoThreadPool::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]() { return m_tasks.empty() && m_busy_workers == 0; });
+	}
+
+	void DecoThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_task_available.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+				// drain the remaining tasks before leaving so nobody waits on a dropped task
+				if (m_stopping && m_tasks.empty())
+				{
+					return;
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+				m_busy_workers++;
+			}
+
+			task();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_busy_workers--;
+				if (m_tasks.empty() && m_busy_workers == 0)
+				{
+					m_idle.notify_all();
+				}
+			}
+		}
+	}
+}
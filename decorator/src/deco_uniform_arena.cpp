@@ -0,0 +1,68 @@
+#include "deco_uniform_arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Deco
+{
+	DecoUniformArena::DecoUniformArena(DecoDevice& device, uint32_t frames_in_flight, VkDeviceSize frame_size)
+		: m_min_alignment(std::max<VkDeviceSize>(device.properties.limits.minUniformBufferOffsetAlignment, 1))
+	{
+		// the instance alignment keeps every frame region, and so every allocation, aligned
+		m_buffer = std::make_unique<DecoBuffer>(
+			device,
+			frame_size,
+			frames_in_flight,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			DecoBuffer::uploadMemoryCandidates(),
+			m_min_alignment);
+		m_buffer->map();
+		m_frame_size = m_buffer->getAlignmentSize();
+
+		assert(m_buffer->getBufferSize() <= UINT32_MAX && "Dynamic offsets are 32 bit");
+	}
+
+	void DecoUniformArena::beginFrame(uint32_t frame_index)
+	{
+		assert(frame_index < m_buffer->getInstanceCount() && "Frame index out of range");
+
+		m_peak_usage = std::max(m_peak_usage, getFrameUsage());
+		m_frame_begin = frame_index * m_frame_size;
+		m_head.store(m_frame_begin);
+	}
+
+	DecoUniformArena::Allocation DecoUniformArena::allocate(VkDeviceSize size)
+	{
+		assert(size > 0 && "Empty uniform allocation");
+
+		// the head only ever moves in aligned steps, so a plain fetch_add keeps it aligned
+		const VkDeviceSize aligned_size = DecoBuffer::getAlignment(size, m_min_alignment);
+		const VkDeviceSize offset = m_head.fetch_add(aligned_size);
+		if (offset + aligned_size > m_frame_begin + m_frame_size)
+		{
+			throw std::runtime_error("Uniform arena frame region exhausted, raise its frame size");
+		}
+
+		return Allocation{
+			static_cast<char*>(m_buffer->getMappedMemory()) + offset,
+			static_cast<uint32_t>(offset) };
+	}
+
+	void DecoUniformArena::addToBatch(DecoUploadBatch& batch)
+	{
+		const VkDeviceSize used = std::min(getFrameUsage(), m_frame_size);
+		if (used == 0)
+		{
+			return;
+		}
+		m_buffer->markDirty(used, m_frame_begin);
+		batch.add(*m_buffer);
+	}
+
+	VkDescriptorBufferInfo DecoUniformArena::descriptorInfo(VkDeviceSize range) const
+	{
+		assert(range <= m_frame_size && "Dynamic uniform range larger than a frame region");
+		return VkDescriptorBufferInfo{ m_buffer->getBuffer(), 0, range };
+	}
+}
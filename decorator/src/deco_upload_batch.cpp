@@ -0,0 +1,35 @@
+#include "deco_upload_batch.h"
+
+namespace Deco
+{
+	void DecoUploadBatch::add(DecoBuffer& buffer)
+	{
+		if (buffer.isCoherent())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_buffers.push_back(&buffer);
+	}
+
+	VkResult DecoUploadBatch::flush()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// a buffer added twice hands over its ranges the first time and nothing the second
+		m_ranges.clear();
+		for (DecoBuffer* buffer : m_buffers)
+		{
+			buffer->collectDirtyRanges(m_ranges);
+		}
+		m_buffers.clear();
+
+		m_flushed_range_count = static_cast<uint32_t>(m_ranges.size());
+		if (m_ranges.empty())
+		{
+			return VK_SUCCESS;
+		}
+		return vkFlushMappedMemoryRanges(m_deco_device.device(), m_flushed_range_count, m_ranges.data());
+	}
+}
@@ -1,15 +1,25 @@
 #pragma once
 
+#include "deco_bindless_heap.h"
+#include "deco_descriptor_allocator.h"
 #include "deco_descriptors.h"
 #include "deco_device.h"
 #include "deco_game_object.h"
+#include "deco_model_loader.h"
+#include "deco_model_registry.h"
+#include "deco_render_queue.h"
 #include "deco_renderer.h"
+#include "deco_texture_loader.h"
+#include "deco_thread_pool.h"
 #include "deco_window.h"
 
 #include <memory>
 #include <vector>
 
 #define MAX_FRAME_TIME 0.03f
+#define LATENCY_REPORT_INTERVAL 2.0f
+// point lights on a POINT_LIGHT_GRID x POINT_LIGHT_GRID grid over the floor
+#define POINT_LIGHT_GRID 32
 
 #error 29
 
@@ -21,7 +31,7 @@ namespace Deco
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
 
-		FirstApp();
+		FirstApp(const DecoRendererSettings& renderer_settings = DecoRendererSettings{});
 		~FirstApp();
 
 		FirstApp(const FirstApp&) = delete;
@@ -35,10 +45,20 @@ namespace Deco
 	private:
 		DecoWindow m_deco_window{ WIDTH, HEIGHT, "Hello Vulkan!" };
 		DecoDevice m_deco_device{ m_deco_window };
-		DecoRenderer m_deco_renderer{ m_deco_window, m_deco_device };
+		DecoRenderer m_deco_renderer; // built in the constructor from the latency mode
+		DecoModelLoader m_model_loader{ m_deco_device };
+		DecoModelRegistry m_model_registry{ m_deco_device, m_model_loader };
+		// per-frame CPU work (render queue sorting), kept apart from the loader's long-running parses
+		DecoThreadPool m_frame_thread_pool{};
+		DecoRenderQueue m_render_queue{ &m_frame_thread_pool };
 
 		// note: order of declarations matters
-		std::unique_ptr<DecoDescriptorPool> m_global_pool{};
+		std::unique_ptr<DecoDescriptorSetLayout> m_global_set_layout{};
+		std::unique_ptr<DecoDescriptorAllocator> m_descriptor_allocator{};
+		// nullptr on devices without descriptor indexing
+		std::unique_ptr<DecoBindlessHeap> m_bindless_heap{};
+		// after the heap, textures hand their slots back to it
+		std::unique_ptr<DecoTextureLoader> m_texture_loader{};
 		DecoGameObject::Map m_deco_game_objects;
 	};
 }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "deco_buffer.h"
+#include "deco_device.h"
+#include "deco_frame_info.h"
+#include "deco_pipeline.h"
+#include "deco_renderer.h"
+
+#include <memory>
+#include <vector>
+
+namespace Deco
+{
+	// Clustered forward lighting: a compute pass bins the point lights into a view space grid of
+	// screen tiles x exponential depth slices, so shading only loops over its own cluster's lights.
+	class LightClusterSystem
+	{
+	public:
+		static constexpr uint32_t GRID_X = 16;
+		static constexpr uint32_t GRID_Y = 9;
+		static constexpr uint32_t GRID_Z = 24;
+		static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+		// matches light_cluster.comp and simple_shader.frag, further lights in a cluster are dropped
+		static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+		// local_size_x of light_cluster.comp
+		static constexpr uint32_t WORKGROUP_SIZE = 128;
+
+		LightClusterSystem(DecoDevice& device, const DecoRenderer& renderer, VkDescriptorSetLayout global_set_layout);
+
+		LightClusterSystem(const LightClusterSystem&) = delete;
+		LightClusterSystem& operator=(const LightClusterSystem&) = delete;
+
+		// global set bindings 2 and 3 of each frame
+		VkDescriptorBufferInfo getLightCountBufferInfo(int frame_index) { return m_light_count_buffers[frame_index]->descriptorInfo(); }
+		VkDescriptorBufferInfo getLightIndexBufferInfo(int frame_index) { return m_light_index_buffers[frame_index]->descriptorInfo(); }
+
+		// grid size and depth slicing for the shaders; ubo.projection has to be a perspective projection
+		void update(GlobalUbo& ubo, VkExtent2D extent);
+		// inside the renderer's compute pass, once the frame's UBO and light buffer are written
+		void buildClusters(FrameInfo& frame_info);
+
+	private:
+		void createBuffers(uint32_t frames_in_flight);
+		void createPipelineLayout(VkDescriptorSetLayout global_set_layout);
+		void createPipeline();
+
+	private:
+		DecoDevice& m_deco_device;
+
+		// written by the compute pass only, one set per frame in flight
+		std::vector<std::unique_ptr<DecoBuffer>> m_light_count_buffers;
+		std::vector<std::unique_ptr<DecoBuffer>> m_light_index_buffers;
+
+		VkPipelineLayout m_pipeline_layout;
+		std::unique_ptr<DecoPipeline> m_deco_pipeline;
+	};
+}
\ No newline at end of file
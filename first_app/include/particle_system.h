@@ -0,0 +1,93 @@
+#pragma once
+
+#include "deco_buffer.h"
+#include "deco_descriptor_allocator.h"
+#include "deco_descriptors.h"
+#include "deco_device.h"
+#include "deco_frame_info.h"
+#include "deco_pipeline.h"
+#include "deco_renderer.h"
+
+#include <memory>
+
+namespace Deco
+{
+	// GPU particles: emission, integration and compaction run in compute passes over a fixed pool, the
+	// live particles are drawn as camera facing billboards by one indirect draw. The CPU only decides
+	// how many particles to emit per frame, it never touches a particle or reads a count back.
+	class ParticleSystem
+	{
+	public:
+		static constexpr uint32_t MAX_PARTICLES = 1u << 20;
+		// local_size_x of particle_emit.comp and particle_simulate.comp
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+		// global_ubo_info is GlobalUbo in the uniform arena, read through the frame's dynamic offset
+		ParticleSystem(DecoDevice& device, const DecoRenderer& renderer, DecoDescriptorAllocator& descriptor_allocator, VkDescriptorBufferInfo global_ubo_info);
+
+		ParticleSystem(const ParticleSystem&) = delete;
+		ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+		// particles spawn on a disc of radius around position and fall back onto the plane through it
+		void setEmitter(const glm::vec3& position, float radius);
+		// particles per second, emission pauses while the pool is exhausted
+		void setEmissionRate(float particles_per_second) { m_emission_rate = particles_per_second; }
+		// seconds, each particle lives between half and all of it
+		void setLifetime(float lifetime) { m_lifetime = lifetime; }
+
+		// inside the renderer's compute pass, before render
+		void simulate(FrameInfo& frame_info);
+		// the particles simulate left alive, as one indirect instanced draw
+		void render(FrameInfo& frame_info);
+
+	private:
+		void createBuffers();
+		void createDescriptorSet(DecoDescriptorAllocator& descriptor_allocator, VkDescriptorBufferInfo global_ubo_info);
+		void createPipelineLayout();
+		void createPipelines(const DecoRenderer& renderer);
+
+	private:
+		// layout matches Push in the particle shaders
+		struct ParticlePush
+		{
+			glm::vec4 emitter{ 0.0f }; // xyz: position, w: spawn radius
+			glm::vec4 params{ 0.0f }; // x: delta time, y: lifetime, z: launch speed, w: gravity
+			glm::uvec4 control{ 0 }; // x: particles to emit, y: alive list read this frame, z: random seed, w: max particles
+		};
+
+		DecoDevice& m_deco_device;
+
+		// device local, only the compute passes write them
+		std::unique_ptr<DecoBuffer> m_particle_buffer;
+		// two lists of MAX_PARTICLES indices, read and compacted into alternately
+		std::unique_ptr<DecoBuffer> m_alive_list_buffer;
+		std::unique_ptr<DecoBuffer> m_dead_list_buffer;
+		// list sizes and the indirect dispatch and draw arguments derived from them
+		std::unique_ptr<DecoBuffer> m_counter_buffer;
+
+		std::unique_ptr<DecoDescriptorSetLayout> m_set_layout;
+		VkDescriptorSet m_descriptor_set{ VK_NULL_HANDLE };
+		VkPipelineLayout m_pipeline_layout;
+
+		// particle_args.comp specialized for before emission and after simulation
+		std::unique_ptr<DecoPipeline> m_begin_args_pipeline;
+		std::unique_ptr<DecoPipeline> m_end_args_pipeline;
+		std::unique_ptr<DecoPipeline> m_emit_pipeline;
+		std::unique_ptr<DecoPipeline> m_simulate_pipeline;
+		std::unique_ptr<DecoPipeline> m_render_pipeline;
+
+		glm::vec3 m_emitter_position{ 0.0f };
+		float m_emitter_radius{ 0.05f };
+		// with lifetimes averaging 3 seconds this keeps the pool close to full
+		float m_emission_rate{ MAX_PARTICLES / 3.0f };
+		float m_lifetime{ 4.0f };
+		float m_launch_speed{ 2.5f };
+		float m_gravity{ 4.0f };
+		// fraction of a particle carried over to the next frame's emission
+		float m_emit_remainder{ 0.0f };
+		uint32_t m_alive_list{ 0 };
+		uint32_t m_frame_seed{ 0 };
+		// what this frame's passes were recorded with, the draw reads the same alive list
+		ParticlePush m_push{};
+	};
+}
\ No newline at end of file
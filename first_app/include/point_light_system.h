@@ -1,9 +1,11 @@
 #pragma once
 
+#include "deco_buffer.h"
 #include "deco_camera.h"
 #include "deco_device.h"
 #include "deco_game_object.h"
 #include "deco_pipeline.h"
+#include "deco_renderer.h"
 #include "deco_frame_info.h"
 
 #include <memory>
@@ -14,20 +16,33 @@ namespace Deco
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(DecoDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
-		~PointLightSystem();
+		PointLightSystem(DecoDevice& device, const DecoRenderer& renderer, VkDescriptorSetLayout global_set_layout);
 
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 
+		// global set binding 1 of each frame
+		VkDescriptorBufferInfo getLightBufferInfo(int frame_index) { return m_light_buffers[frame_index]->descriptorInfo(); }
+
+		// gathers the point light components into the frame's light buffer, sets ubo.cluster_grid.w
+		void update(FrameInfo& frame_info, GlobalUbo& ubo);
+		// all lights as one instanced billboard draw
 		void render(FrameInfo& frame_info);
 	private:
+		void createLightBuffers(uint32_t frames_in_flight);
 		void createPipelineLayout(VkDescriptorSetLayout global_set_layout);
-		void createPipeline(VkRenderPass render_pass);
+		void createPipeline(const DecoRenderer& renderer);
+
+	public:
+		// lights past this are ignored
+		static constexpr uint32_t MAX_LIGHTS = 4096;
 
 	private:
 		DecoDevice& m_deco_device;
 
+		std::vector<std::unique_ptr<DecoBuffer>> m_light_buffers;
+		uint32_t m_light_count{ 0 };
+
 		std::unique_ptr<DecoPipeline> m_deco_pipeline;
 		VkPipelineLayout m_pipeline_layout;
 	};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "deco_buffer.h"
+#include "deco_descriptor_allocator.h"
+#include "deco_descriptors.h"
+#include "deco_device.h"
+#include "deco_frame_info.h"
+#include "deco_pipeline.h"
+#include "deco_renderer.h"
+#include "deco_shadow_map.h"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Deco
+{
+	// Cascaded shadow maps for one directional light. Every frame the camera frustum up to the shadow
+	// distance is split into SHADOW_CASCADE_COUNT slices, each covered by a texel snapped orthographic
+	// projection; the casters each cascade sees are drawn instanced, one draw per model.
+	class ShadowSystem
+	{
+	public:
+		static constexpr uint32_t RESOLUTION = 2048;
+		// caster instances over all cascades per frame, past this casters are dropped and counted
+		static constexpr uint32_t MAX_INSTANCES = 4 * 1024;
+
+		ShadowSystem(DecoDevice& device, const DecoRenderer& renderer, DecoDescriptorAllocator& descriptor_allocator);
+
+		ShadowSystem(const ShadowSystem&) = delete;
+		ShadowSystem& operator=(const ShadowSystem&) = delete;
+
+		// direction the light travels in, intensity 0 turns the light off
+		void setDirectionalLight(const glm::vec3& direction, const glm::vec3& color, float intensity);
+		// view depth the last cascade ends at, at most the camera's far plane
+		void setShadowDistance(float distance) { m_shadow_distance = distance; }
+
+		// global set binding 4
+		VkDescriptorImageInfo getShadowMapInfo() const { return m_shadow_map->getDescriptorInfo(); }
+
+		// fits the cascades to frame_info.camera, culls and gathers the casters and fills the light and
+		// cascade fields of the ubo
+		void update(FrameInfo& frame_info, GlobalUbo& ubo);
+		// the cascades' depth passes, outside any other render pass and before the shading that samples them
+		void render(FrameInfo& frame_info);
+
+		// of the last update, over all cascades; dropped casters did not fit in MAX_INSTANCES
+		uint32_t getInstanceCount() const { return m_instance_count; }
+		uint32_t getDroppedCasterCount() const { return m_dropped_casters; }
+
+	private:
+		void createInstanceBuffers(uint32_t frames_in_flight, DecoDescriptorAllocator& descriptor_allocator);
+		void createPipelineLayout();
+		void createPipeline();
+
+	private:
+		// one model's instances of a cascade, contiguous in the frame's instance buffer
+		struct ShadowDraw
+		{
+			DecoModel* m_model;
+			uint32_t m_first_instance;
+			uint32_t m_instance_count;
+		};
+
+		// the world space casters of a model, gathered once and tested against every cascade
+		struct CasterGroup
+		{
+			DecoModel* m_model;
+			std::vector<glm::mat4> m_model_matrices;
+			std::vector<glm::vec4> m_bounding_spheres;
+		};
+
+		DecoDevice& m_deco_device;
+		std::unique_ptr<DecoShadowMap> m_shadow_map;
+
+		// per frame, mat4 per caster instance, read by shadow.vert through gl_InstanceIndex
+		std::vector<std::unique_ptr<DecoBuffer>> m_instance_buffers;
+		std::unique_ptr<DecoDescriptorSetLayout> m_set_layout;
+		std::vector<VkDescriptorSet> m_descriptor_sets;
+		VkPipelineLayout m_pipeline_layout;
+		std::unique_ptr<DecoPipeline> m_deco_pipeline;
+
+		glm::vec3 m_light_direction{ 0.0f, 1.0f, 0.0f };
+		glm::vec3 m_light_color{ 1.0f };
+		float m_light_intensity{ 0.0f };
+		float m_shadow_distance{ 12.0f };
+
+		// this frame's casters, only valid until the next update; groups and their vectors are kept
+		// across frames and dropped once their model has no casters left
+		std::vector<CasterGroup> m_caster_groups;
+		std::unordered_map<uint32_t, size_t> m_caster_group_indices; // DecoModel::getId()
+		std::array<glm::mat4, SHADOW_CASCADE_COUNT> m_cascade_view_projections{};
+		std::array<std::vector<ShadowDraw>, SHADOW_CASCADE_COUNT> m_cascade_draws;
+		uint32_t m_instance_count{ 0 };
+		uint32_t m_dropped_casters{ 0 };
+	};
+}
\ No newline at end of file
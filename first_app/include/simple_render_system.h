@@ -1,9 +1,12 @@
 #pragma once
 
+#include "deco_bindless_heap.h"
+#include "deco_buffer.h"
 #include "deco_camera.h"
 #include "deco_device.h"
 #include "deco_game_object.h"
 #include "deco_pipeline.h"
+#include "deco_renderer.h"
 #include "deco_frame_info.h"
 
 #include <memory>
@@ -14,22 +17,48 @@ namespace Deco
 	class SimpleRenderSystem
 	{
 	public:
-		SimpleRenderSystem(DecoDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+		// with a bindless heap the object transforms and texture slots go to a per-frame storage buffer
+		// in the heap and draws only push their slot and index, otherwise the matrices are push
+		// constants and objects are drawn untextured
+		SimpleRenderSystem(
+			DecoDevice& device,
+			const DecoRenderer& renderer,
+			VkDescriptorSetLayout global_set_layout,
+			DecoBindlessHeap* bindless_heap = nullptr);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+		// depth-only pass over the sorted opaque draws, then shading with an EQUAL depth test so
+		// every pixel runs the fragment shader once
+		void setDepthPrepassEnabled(bool enabled) { m_depth_prepass_enabled = enabled; }
+		bool isDepthPrepassEnabled() const { return m_depth_prepass_enabled; }
+
+		// queues the objects into frame_info.render_queue, which orders them front to back per model
 		void renderGameObjects(FrameInfo& frame_info);
 	private:
+		void createObjectBuffers(uint32_t frames_in_flight);
 		void createPipelineLayout(VkDescriptorSetLayout global_set_layout);
-		void createPipeline(VkRenderPass render_pass);
+		void createPipeline(const DecoRenderer& renderer);
+
+	public:
+		// objects past this are not drawn in bindless mode
+		static constexpr uint32_t MAX_OBJECTS = 1024;
 
 	private:
 		DecoDevice& m_deco_device;
 
+		// non-owning, nullptr without bindless mode
+		DecoBindlessHeap* m_bindless_heap;
+		std::vector<std::unique_ptr<DecoBuffer>> m_object_buffers;
+		std::vector<uint32_t> m_object_buffer_slots;
+
 		std::unique_ptr<DecoPipeline> m_deco_pipeline;
+		std::unique_ptr<DecoPipeline> m_depth_prepass_pipeline;
+		std::unique_ptr<DecoPipeline> m_depth_equal_pipeline;
 		VkPipelineLayout m_pipeline_layout;
+		bool m_depth_prepass_enabled{ false };
 	};
 }
 
@@ -1,10 +1,14 @@
 #include "first_app.h"
 
-#include "deco_buffer.h"
 #include "deco_camera.h"
+#include "deco_uniform_arena.h"
+#include "deco_upload_batch.h"
 #include "keyboard_movement_controller.h"
+#include "light_cluster_system.h"
+#include "particle_system.h"
 #include "simple_render_system.h"
 #include "point_light_system.h"
+#include "shadow_system.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -13,26 +17,38 @@
 
 #include <array>
 #include <chrono>
+#include <cstddef>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 namespace Deco
 {
-	struct GlobalUbo
+	FirstApp::FirstApp(const DecoRendererSettings& renderer_settings) : m_deco_renderer{ m_deco_window, m_deco_device, renderer_settings }
 	{
-		glm::mat4 projection{ 1.0f };
-		glm::mat4 view{ 1.0f };
-		glm::vec4 ambinetLightColor{ 1.f, 1.f, 1.f, .02f }; // w is intensity
-		glm::vec3 light_position{ -1.f };
-		alignas(16) glm::vec4 light_color{ 1.f }; // w is light intensity
-	};
-
-	FirstApp::FirstApp()
-	{
-		m_global_pool = DecoDescriptorPool::Builder(m_deco_device)
-			.setMaxSets(DecoSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DecoSwapChain::MAX_FRAMES_IN_FLIGHT)
+		// 0: GlobalUbo, 1: point lights, 2: per cluster light counts, 3: per cluster light indices,
+		// 4: directional light shadow cascades
+		const VkShaderStageFlags global_stages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+		m_global_set_layout = DecoDescriptorSetLayout::Builder(m_deco_device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, global_stages)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, global_stages)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, global_stages)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, global_stages)
+			.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, global_stages)
 			.build();
+
+		m_descriptor_allocator = std::make_unique<DecoDescriptorAllocator>(m_deco_device, m_deco_renderer.getFramesInFlight());
+		if (m_deco_device.supportsBindless())
+		{
+			// the global set is the only other set bound next to the heap
+			m_bindless_heap = std::make_unique<DecoBindlessHeap>(m_deco_device, m_global_set_layout->getDescriptorCount());
+		}
+		m_texture_loader = std::make_unique<DecoTextureLoader>(m_deco_device, m_bindless_heap.get());
+
+		m_render_queue.setLayerName(RENDER_LAYER_DEPTH_PREPASS, "depth prepass");
+		m_render_queue.setLayerName(RENDER_LAYER_OPAQUE, "opaque");
+		m_render_queue.setLayerName(RENDER_LAYER_LIGHTS, "point lights");
+		m_render_queue.setLayerName(RENDER_LAYER_PARTICLES, "particles");
 		loadGameObjects();
 	}
 
@@ -40,34 +56,51 @@ namespace Deco
 
 	void FirstApp::run()
 	{
-		std::vector<std::unique_ptr<DecoBuffer>> uboBuffers(DecoSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < uboBuffers.size(); i++)
-		{
-			uboBuffers[i] = std::make_unique<DecoBuffer>(
-				m_deco_device,
-				sizeof(GlobalUbo),
-				1,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT/* | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT*/);
-
-			uboBuffers[i]->map();
-		}
+		// GlobalUbo and any other per-frame constants, bound through dynamic offsets
+		DecoUniformArena uniform_arena{ m_deco_device, m_deco_renderer.getFramesInFlight() };
+		// flushes what the CPU wrote into non-coherent mappings, once per frame
+		DecoUploadBatch upload_batch{ m_deco_device };
 
-		auto global_set_layout = DecoDescriptorSetLayout::Builder(m_deco_device)
-			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+		SimpleRenderSystem simple_render_system{ m_deco_device, m_deco_renderer, m_global_set_layout->getDescriptorSetLayout(), m_bindless_heap.get() };
+		PointLightSystem point_light_system{ m_deco_device, m_deco_renderer, m_global_set_layout->getDescriptorSetLayout() };
+		LightClusterSystem light_cluster_system{ m_deco_device, m_deco_renderer, m_global_set_layout->getDescriptorSetLayout() };
+		ParticleSystem particle_system{ m_deco_device, m_deco_renderer, *m_descriptor_allocator, uniform_arena.descriptorInfo(sizeof(GlobalUbo)) };
+		// a fountain between the vases, falling back onto the floor
+		particle_system.setEmitter({ 0.f, .5f, 0.f }, .05f);
+		ShadowSystem shadow_system{ m_deco_device, m_deco_renderer, *m_descriptor_allocator };
+		// a low warm sun from behind the camera, +y is down
+		shadow_system.setDirectionalLight({ .5f, 1.f, .3f }, { 1.f, .95f, .85f }, .6f);
+
+		// packed in binding order, one templated update writes a whole global set
+		struct GlobalSetDescriptors
+		{
+			VkDescriptorBufferInfo ubo;
+			VkDescriptorBufferInfo lights;
+			VkDescriptorBufferInfo cluster_counts;
+			VkDescriptorBufferInfo cluster_indices;
+			VkDescriptorImageInfo shadow_map;
+		};
+		auto global_set_template = DecoDescriptorUpdateTemplate::Builder(m_deco_device, *m_global_set_layout)
+			.addEntry(0, offsetof(GlobalSetDescriptors, ubo))
+			.addEntry(1, offsetof(GlobalSetDescriptors, lights))
+			.addEntry(2, offsetof(GlobalSetDescriptors, cluster_counts))
+			.addEntry(3, offsetof(GlobalSetDescriptors, cluster_indices))
+			.addEntry(4, offsetof(GlobalSetDescriptors, shadow_map))
 			.build();
 
-		std::vector<VkDescriptorSet> global_descriptor_sets(DecoSwapChain::MAX_FRAMES_IN_FLIGHT);
+		std::vector<VkDescriptorSet> global_descriptor_sets(m_deco_renderer.getFramesInFlight());
 		for (int i = 0; i < global_descriptor_sets.size(); i++)
 		{
-			auto buffer_info = uboBuffers[i]->descriptorInfo();
-			DecoDescriptorWriter(*global_set_layout, *m_global_pool)
-				.writeBuffer(0, &buffer_info)
-				.build(global_descriptor_sets[i]);
+			GlobalSetDescriptors descriptors{
+				uniform_arena.descriptorInfo(sizeof(GlobalUbo)),
+				point_light_system.getLightBufferInfo(i),
+				light_cluster_system.getLightCountBufferInfo(i),
+				light_cluster_system.getLightIndexBufferInfo(i),
+				shadow_system.getShadowMapInfo() };
+			global_descriptor_sets[i] = m_descriptor_allocator->allocate(m_global_set_layout->getDescriptorSetLayout());
+			global_set_template->update(global_descriptor_sets[i], &descriptors);
 		}
 
-		SimpleRenderSystem simple_render_system{ m_deco_device, m_deco_renderer.getSwapChainRenderPass(), global_set_layout->getDescriptorSetLayout() };
-		PointLightSystem point_light_system{ m_deco_device, m_deco_renderer.getSwapChainRenderPass(), global_set_layout->getDescriptorSetLayout() };
 		DecoCamera camera{};
 
 		auto viewer_object = DecoGameObject::createGameObject();
@@ -75,17 +108,60 @@ namespace Deco
 		KeyboardMovementController camera_controller{};
 
 		auto current_time = std::chrono::high_resolution_clock::now();
+		float latency_report_time = 0.0f;
+		bool prepass_key_was_down = false;
 
 		while (!m_deco_window.shouldClose())
 		{
+			// the frame limiter sleeps here, and low-latency mode waits for the GPU here rather than in
+			// beginFrame, so the input below is fresh
+			m_deco_renderer.waitForNextFrame();
 			glfwPollEvents();
+			m_deco_renderer.markInputSampled();
 
 			auto new_time = std::chrono::high_resolution_clock::now();
 			float frame_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
 			current_time = new_time;
 
+			latency_report_time += frame_time;
+			if (latency_report_time >= LATENCY_REPORT_INTERVAL)
+			{
+				const auto& latency = m_deco_renderer.getLatencyStats();
+				std::cout << "Latency (" << getLatencyModeName(m_deco_renderer.getLatencyMode()) << ", "
+					<< m_deco_renderer.getFramesInFlight() << " frames in flight): input->present "
+					<< latency.m_input_to_present_ms << " ms, input->gpu done "
+					<< latency.m_input_to_complete_ms << " ms" << std::endl;
+				m_deco_renderer.getFrameStats().print(std::cout);
+				m_deco_renderer.getGpuProfiler().print(std::cout);
+				m_render_queue.printStats(std::cout);
+				std::cout << "Layout cache: " << m_deco_device.getLayoutCache().getDescriptorSetLayoutCount()
+					<< " descriptor set layouts, " << m_deco_device.getLayoutCache().getPipelineLayoutCount()
+					<< " pipeline layouts, " << m_deco_device.getSamplerCache().getSamplerCount() << " samplers" << std::endl;
+				std::cout << "Uniform arena: " << uniform_arena.getPeakUsage() << " of " << uniform_arena.getFrameSize()
+					<< " bytes per frame at peak, " << upload_batch.getFlushedRangeCount() << " mapped ranges flushed last frame" << std::endl;
+				std::cout << "Shadow casters: " << shadow_system.getInstanceCount() << " instances last frame, "
+					<< shadow_system.getDroppedCasterCount() << " dropped past " << ShadowSystem::MAX_INSTANCES << std::endl;
+				m_deco_device.getMemoryManager().printReport(std::cout);
+				latency_report_time = 0.0f;
+			}
+
 			frame_time = glm::min(frame_time, MAX_FRAME_TIME);
 
+			// P toggles the depth pre-pass, compare the "opaque" GPU time with and without it
+			bool prepass_key_down = glfwGetKey(m_deco_window.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+			if (prepass_key_down && !prepass_key_was_down)
+			{
+				simple_render_system.setDepthPrepassEnabled(!simple_render_system.isDepthPrepassEnabled());
+				std::cout << "Depth pre-pass " << (simple_render_system.isDepthPrepassEnabled() ? "on" : "off") << std::endl;
+			}
+			prepass_key_was_down = prepass_key_down;
+
+			// hand finished parses to the GPU and publish models whose copy has completed
+			m_model_loader.update();
+			m_model_registry.collectGarbage();
+			// uploads the next mip levels, coarsest first, within the per frame budget
+			m_texture_loader->update();
+
 			camera_controller.moveInPlaneXZ(m_deco_window.getGLFWwindow(), frame_time, viewer_object);
 			camera.setViewYXZ(viewer_object.m_transform.m_translation, viewer_object.m_transform.m_rotation);
 
@@ -97,55 +173,102 @@ namespace Deco
 			if (auto command_buffer = m_deco_renderer.beginFrame())
 			{
 				int frame_index = m_deco_renderer.getFrameIndex();
+				// beginFrame waited for this frame slot, its transient descriptor sets and uniforms are free again
+				m_descriptor_allocator->resetFrame(frame_index);
+				uniform_arena.beginFrame(frame_index);
 				FrameInfo frame_info{
 					frame_index,
 					frame_time,
 					command_buffer,
 					camera,
 					global_descriptor_sets[frame_index],
-					m_deco_game_objects
+					m_deco_game_objects,
+					&m_deco_renderer.getGpuProfiler(),
+					&m_render_queue,
+					&uniform_arena,
+					0,
+					&upload_batch
 				};
 
 				//update
 				GlobalUbo ubo{};
 				ubo.projection = camera.getProjection();
 				ubo.view = camera.getView();
-				uboBuffers[frame_index]->writeToBuffer(&ubo);
-				uboBuffers[frame_index]->flush();
+				point_light_system.update(frame_info, ubo);
+				light_cluster_system.update(ubo, m_deco_renderer.getSwapChainExtent());
+				shadow_system.update(frame_info, ubo);
+				frame_info.global_ubo_offset = uniform_arena.push(ubo);
 
-				//render
-				m_deco_renderer.beginSwapChainRenderPass(command_buffer);
+				m_deco_renderer.beginComputePass(command_buffer);
+				light_cluster_system.buildClusters(frame_info);
+				particle_system.simulate(frame_info);
+				m_deco_renderer.endComputePass(command_buffer);
+
+				// the cascades are sampled by the swap chain pass, so they go first
+				shadow_system.render(frame_info);
+
+				//render: the systems only queue draws, the queue orders them by state and records them
+				m_render_queue.clear();
 				simple_render_system.renderGameObjects(frame_info);
 				point_light_system.render(frame_info);
+				particle_system.render(frame_info);
+				m_render_queue.sort();
+
+				// every mapped write of this frame is done, make them visible in one call
+				uniform_arena.addToBatch(upload_batch);
+				upload_batch.flush();
+
+				m_deco_renderer.beginSwapChainRenderPass(command_buffer);
+				m_render_queue.submit(command_buffer, frame_info.gpu_profiler);
 				m_deco_renderer.endSwapChainRenderPass(command_buffer);
 				m_deco_renderer.endFrame();
 			}
 		}
 
-		vkDeviceWaitIdle(m_deco_device.device());
+		m_deco_device.waitIdle();
 	}
 
 	void FirstApp::loadGameObjects()
 	{
-		std::shared_ptr<DecoModel> deco_model = DecoModel::createModelFromFile(m_deco_device, "../resources/objs/flat_vase.obj");
+		std::shared_ptr<DecoModel> deco_model = m_model_registry.acquire("../resources/objs/flat_vase.obj");
 		auto flat_vase = DecoGameObject::createGameObject();
 		flat_vase.m_model = deco_model;
 		flat_vase.m_transform.m_translation = { -.5f, .5f, 0.f };
 		flat_vase.m_transform.m_scale = glm::vec3(3.f);
 		m_deco_game_objects.emplace(flat_vase.getId(), std::move(flat_vase));
 
-		deco_model = DecoModel::createModelFromFile(m_deco_device, "../resources/objs/smooth_vase.obj");
+		deco_model = m_model_registry.acquire("../resources/objs/smooth_vase.obj");
 		auto smooth_vase = DecoGameObject::createGameObject();
 		smooth_vase.m_model = deco_model;
 		smooth_vase.m_transform.m_translation = { .5f, .5f, 0.f };
 		smooth_vase.m_transform.m_scale = glm::vec3(3.f);
 		m_deco_game_objects.emplace(smooth_vase.getId(), std::move(smooth_vase));
 
-		deco_model = DecoModel::createModelFromFile(m_deco_device, "../resources/objs/quad.obj");
+		deco_model = m_model_registry.acquire("../resources/objs/quad.obj");
 		auto floor = DecoGameObject::createGameObject();
 		floor.m_model = deco_model;
+		// sampled in bindless mode only, BC7 (or BC1) encoded on first run and cached next to the source
+		floor.m_texture = m_texture_loader->createTextureFromFile(
+			"../resources/textures/checker.dds", VK_NULL_HANDLE, DecoTextureCompression::Color);
 		floor.m_transform.m_translation = { 0.f, .5f, 0.f };
 		floor.m_transform.m_scale = glm::vec3(3.f);
 		m_deco_game_objects.emplace(floor.getId(), std::move(floor));
+
+		// small short-range lights hovering over the floor, the clusters keep each pixel down to a handful
+		for (int z = 0; z < POINT_LIGHT_GRID; z++)
+		{
+			for (int x = 0; x < POINT_LIGHT_GRID; x++)
+			{
+				const float hue = static_cast<float>(x + z * POINT_LIGHT_GRID) / (POINT_LIGHT_GRID * POINT_LIGHT_GRID);
+				const glm::vec3 color = .5f + .5f * glm::cos(glm::two_pi<float>() * (hue + glm::vec3(0.f, 1.f / 3.f, 2.f / 3.f)));
+
+				auto point_light = DecoGameObject::makePointLight(.02f, .4f, color);
+				point_light.m_transform.m_translation = {
+					-2.5f + 5.f * x / (POINT_LIGHT_GRID - 1),
+					.35f,
+					-2.5f + 5.f * z / (POINT_LIGHT_GRID - 1) };
+				m_deco_game_objects.emplace(point_light.getId(), std::move(point_light));
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "light_cluster_system.h"
+
+#include "deco_pipeline.h"
+
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace Deco
+{
+	LightClusterSystem::LightClusterSystem(DecoDevice& device, const DecoRenderer& renderer, VkDescriptorSetLayout global_set_layout) : m_deco_device(device)
+	{
+		// the pass is recorded into the frame's graphics command buffer
+		uint32_t family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_deco_device.getPhysicalDevice(), &family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_deco_device.getPhysicalDevice(), &family_count, families.data());
+		if ((families[m_deco_device.findPhysicalQueueFamilies().graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0)
+		{
+			throw std::runtime_error("Light clustering needs a graphics queue with compute support");
+		}
+
+		createBuffers(renderer.getFramesInFlight());
+		createPipelineLayout(global_set_layout);
+		createPipeline();
+	}
+
+	void LightClusterSystem::createBuffers(uint32_t frames_in_flight)
+	{
+		for (uint32_t i = 0; i < frames_in_flight; i++)
+		{
+			m_light_count_buffers.push_back(std::make_unique<DecoBuffer>(
+				m_deco_device,
+				sizeof(uint32_t),
+				CLUSTER_COUNT,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+			m_light_index_buffers.push_back(std::make_unique<DecoBuffer>(
+				m_deco_device,
+				sizeof(uint32_t),
+				CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+		}
+	}
+
+	void LightClusterSystem::createPipelineLayout(VkDescriptorSetLayout global_set_layout)
+	{
+		// owned by the device's layout cache
+		m_pipeline_layout = m_deco_device.getLayoutCache().getPipelineLayout({ global_set_layout });
+	}
+
+	void LightClusterSystem::createPipeline()
+	{
+		assert(m_pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		ComputePipelineConfigInfo pipeline_config{};
+		pipeline_config.m_pipeline_layout = m_pipeline_layout;
+		pipeline_config.m_workgroup_size = { WORKGROUP_SIZE, 1, 1 };
+		m_deco_pipeline = std::make_unique<DecoPipeline>(m_deco_device, "../shaders/light_cluster.comp.spv", pipeline_config);
+	}
+
+	void LightClusterSystem::update(GlobalUbo& ubo, VkExtent2D extent)
+	{
+		// near and far plane back out of DecoCamera::setPerspectiveProjection's matrix
+		const float near = -ubo.projection[3][2] / ubo.projection[2][2];
+		const float far = ubo.projection[3][2] / (1.0f - ubo.projection[2][2]);
+		assert(near > 0.0f && far > near && "Light clustering needs a perspective projection");
+
+		// slice = log(z / near) / log(far / near) * GRID_Z, keeps clusters roughly cubic with depth
+		const float slice_scale = static_cast<float>(GRID_Z) / std::log(far / near);
+
+		ubo.cluster_grid.x = GRID_X;
+		ubo.cluster_grid.y = GRID_Y;
+		ubo.cluster_grid.z = GRID_Z;
+		ubo.cluster_params.x = static_cast<float>(extent.width) / GRID_X;
+		ubo.cluster_params.y = static_cast<float>(extent.height) / GRID_Y;
+		ubo.cluster_params.z = slice_scale;
+		ubo.cluster_params.w = slice_scale * std::log(near);
+	}
+
+	void LightClusterSystem::buildClusters(FrameInfo& frame_info)
+	{
+		uint32_t scope = frame_info.gpu_profiler != nullptr ?
+			frame_info.gpu_profiler->beginScope(frame_info.command_buffer, "light clustering") : DecoGpuProfiler::INVALID_SCOPE;
+
+		m_deco_pipeline->bind(frame_info.command_buffer);
+		vkCmdBindDescriptorSets(
+			frame_info.command_buffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			m_pipeline_layout,
+			0,
+			1,
+			&frame_info.global_descriptor_set,
+			1,
+			&frame_info.global_ubo_offset);
+		// the cluster lists reach the fragment shaders through the barrier at the end of the compute pass
+		m_deco_pipeline->dispatchThreads(frame_info.command_buffer, CLUSTER_COUNT);
+
+		if (frame_info.gpu_profiler != nullptr)
+		{
+			frame_info.gpu_profiler->endScope(frame_info.command_buffer, scope);
+		}
+	}
+}
\ No newline at end of file
@@ -1,12 +1,83 @@
 #include "first_app.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main()
+// --latency=low|balanced|throughput
+static Deco::DecoLatencyMode parseLatencyMode(int argc, char** argv)
 {
-	Deco::FirstApp app{};
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--latency=low") == 0)
+		{
+			return Deco::DecoLatencyMode::LowLatency;
+		}
+		if (std::strcmp(argv[i], "--latency=throughput") == 0)
+		{
+			return Deco::DecoLatencyMode::Throughput;
+		}
+	}
+	return Deco::DecoLatencyMode::Balanced;
+}
+
+// --fps=N caps the frame rate, 0 (default) leaves it uncapped
+static double parseTargetFrameRate(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strncmp(argv[i], "--fps=", 6) == 0)
+		{
+			return std::atof(argv[i] + 6);
+		}
+	}
+	return 0.0;
+}
+
+// --msaa=2|4|8, capped by the device; off by default
+static VkSampleCountFlagBits parseMsaaSamples(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--msaa=2") == 0)
+		{
+			return VK_SAMPLE_COUNT_2_BIT;
+		}
+		if (std::strcmp(argv[i], "--msaa=4") == 0)
+		{
+			return VK_SAMPLE_COUNT_4_BIT;
+		}
+		if (std::strcmp(argv[i], "--msaa=8") == 0)
+		{
+			return VK_SAMPLE_COUNT_8_BIT;
+		}
+	}
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+static bool hasFlag(int argc, char** argv, const char* flag)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], flag) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	Deco::DecoRendererSettings renderer_settings{};
+	renderer_settings.m_latency_mode = parseLatencyMode(argc, argv);
+	renderer_settings.m_target_frame_rate = parseTargetFrameRate(argc, argv);
+	renderer_settings.m_msaa_samples = parseMsaaSamples(argc, argv);
+	// --dynamic-rendering, needs Vulkan 1.3 or VK_KHR_dynamic_rendering, ignored otherwise
+	renderer_settings.m_dynamic_rendering = hasFlag(argc, argv, "--dynamic-rendering");
+
+	Deco::FirstApp app{ renderer_settings };
 
 	try
 	{
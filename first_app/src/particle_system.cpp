@@ -0,0 +1,266 @@
+#include "particle_system.h"
+
+#include "deco_barrier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+namespace Deco
+{
+	// layout matches Particle in the particle shaders
+	struct Particle
+	{
+		glm::vec4 position{}; // w is age
+		glm::vec4 velocity{}; // w is lifetime
+	};
+
+	// layout matches ParticleCounters in the particle shaders
+	struct ParticleCounters
+	{
+		uint32_t dead_count;
+		uint32_t alive_count[2];
+		uint32_t emit_count;
+		VkDispatchIndirectCommand emit_dispatch;
+		uint32_t pad0;
+		VkDispatchIndirectCommand simulate_dispatch;
+		uint32_t pad1;
+		VkDrawIndirectCommand draw;
+	};
+	static_assert(offsetof(ParticleCounters, emit_dispatch) == 16, "ParticleCounters does not match the shaders");
+	static_assert(offsetof(ParticleCounters, simulate_dispatch) == 32, "ParticleCounters does not match the shaders");
+	static_assert(offsetof(ParticleCounters, draw) == 48, "ParticleCounters does not match the shaders");
+
+	ParticleSystem::ParticleSystem(DecoDevice& device, const DecoRenderer& renderer, DecoDescriptorAllocator& descriptor_allocator, VkDescriptorBufferInfo global_ubo_info)
+		: m_deco_device(device)
+	{
+		createBuffers();
+		createDescriptorSet(descriptor_allocator, global_ubo_info);
+		createPipelineLayout();
+		createPipelines(renderer);
+	}
+
+	void ParticleSystem::setEmitter(const glm::vec3& position, float radius)
+	{
+		m_emitter_position = position;
+		m_emitter_radius = radius;
+	}
+
+	void ParticleSystem::createBuffers()
+	{
+		m_particle_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			sizeof(Particle),
+			MAX_PARTICLES,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		m_alive_list_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			sizeof(uint32_t),
+			2 * MAX_PARTICLES,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		m_dead_list_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			sizeof(uint32_t),
+			MAX_PARTICLES,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		m_counter_buffer = std::make_unique<DecoBuffer>(
+			m_deco_device,
+			sizeof(ParticleCounters),
+			1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		// every particle starts out dead, the dead list holds all of them
+		const VkDeviceSize dead_list_size = MAX_PARTICLES * sizeof(uint32_t);
+		DecoBuffer staging_buffer{
+			m_deco_device,
+			1,
+			static_cast<uint32_t>(dead_list_size + sizeof(ParticleCounters)),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		};
+		staging_buffer.map();
+
+		auto* dead_list = static_cast<uint32_t*>(staging_buffer.getMappedMemory());
+		std::iota(dead_list, dead_list + MAX_PARTICLES, 0u);
+
+		ParticleCounters counters{};
+		counters.dead_count = MAX_PARTICLES;
+		counters.draw.vertexCount = 6;
+		std::memcpy(static_cast<uint8_t*>(staging_buffer.getMappedMemory()) + dead_list_size, &counters, sizeof(counters));
+
+		DecoSingleTimeCommands commands = m_deco_device.beginSingleTimeCommands();
+		VkBufferCopy dead_list_copy{ 0, 0, dead_list_size };
+		vkCmdCopyBuffer(commands.getCommandBuffer(), staging_buffer.getBuffer(), m_dead_list_buffer->getBuffer(), 1, &dead_list_copy);
+		VkBufferCopy counter_copy{ dead_list_size, 0, sizeof(ParticleCounters) };
+		vkCmdCopyBuffer(commands.getCommandBuffer(), staging_buffer.getBuffer(), m_counter_buffer->getBuffer(), 1, &counter_copy);
+		commands.submit();
+	}
+
+	void ParticleSystem::createDescriptorSet(DecoDescriptorAllocator& descriptor_allocator, VkDescriptorBufferInfo global_ubo_info)
+	{
+		// 0: GlobalUbo, 1: particles, 2: alive lists, 3: dead list, 4: counters and indirect arguments
+		const VkShaderStageFlags shared_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		m_set_layout = DecoDescriptorSetLayout::Builder(m_deco_device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, shared_stages)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, shared_stages)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		auto particle_info = m_particle_buffer->descriptorInfo();
+		auto alive_list_info = m_alive_list_buffer->descriptorInfo();
+		auto dead_list_info = m_dead_list_buffer->descriptorInfo();
+		auto counter_info = m_counter_buffer->descriptorInfo();
+		DecoDescriptorWriter(*m_set_layout, descriptor_allocator)
+			.writeBuffer(0, &global_ubo_info)
+			.writeBuffer(1, &particle_info)
+			.writeBuffer(2, &alive_list_info)
+			.writeBuffer(3, &dead_list_info)
+			.writeBuffer(4, &counter_info)
+			.build(m_descriptor_set);
+	}
+
+	void ParticleSystem::createPipelineLayout()
+	{
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(ParticlePush);
+
+		// owned by the device's layout cache, shared by the compute passes and the draw
+		m_pipeline_layout = m_deco_device.getLayoutCache().getPipelineLayout({ m_set_layout->getDescriptorSetLayout() }, { push_constant_range });
+	}
+
+	void ParticleSystem::createPipelines(const DecoRenderer& renderer)
+	{
+		assert(m_pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		ComputePipelineConfigInfo args_config{};
+		args_config.m_pipeline_layout = m_pipeline_layout;
+		args_config.m_workgroup_size = { 1, 1, 1 };
+		args_config.m_specialization_entries = { { 0, 0, sizeof(uint32_t) } };
+		args_config.m_specialization_data.resize(sizeof(uint32_t));
+
+		uint32_t stage = 0;
+		std::memcpy(args_config.m_specialization_data.data(), &stage, sizeof(stage));
+		m_begin_args_pipeline = std::make_unique<DecoPipeline>(m_deco_device, "../shaders/particle_args.comp.spv", args_config);
+		stage = 1;
+		std::memcpy(args_config.m_specialization_data.data(), &stage, sizeof(stage));
+		m_end_args_pipeline = std::make_unique<DecoPipeline>(m_deco_device, "../shaders/particle_args.comp.spv", args_config);
+
+		ComputePipelineConfigInfo particle_config{};
+		particle_config.m_pipeline_layout = m_pipeline_layout;
+		particle_config.m_workgroup_size = { WORKGROUP_SIZE, 1, 1 };
+		m_emit_pipeline = std::make_unique<DecoPipeline>(m_deco_device, "../shaders/particle_emit.comp.spv", particle_config);
+		m_simulate_pipeline = std::make_unique<DecoPipeline>(m_deco_device, "../shaders/particle_simulate.comp.spv", particle_config);
+
+		PipelineConfigInfo pipeline_config{};
+		DecoPipeline::defaultPipelineConfigInfo(pipeline_config);
+		pipeline_config.attributeDescriptions.clear();
+		pipeline_config.bindingDescriptions.clear();
+		// additive and depth tested without writing depth, so the draw order of particles does not matter
+		pipeline_config.m_color_blend_attachment.blendEnable = VK_TRUE;
+		pipeline_config.m_color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipeline_config.m_color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipeline_config.m_color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		pipeline_config.m_color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipeline_config.m_depth_stencil_info.depthWriteEnable = VK_FALSE;
+		renderer.configurePipeline(pipeline_config);
+		pipeline_config.m_pipeline_layout = m_pipeline_layout;
+		m_render_pipeline = std::make_unique<DecoPipeline>(
+			m_deco_device,
+			"../shaders/particle.vert.spv",
+			"../shaders/particle.frag.spv",
+			pipeline_config);
+	}
+
+	void ParticleSystem::simulate(FrameInfo& frame_info)
+	{
+		VkCommandBuffer command_buffer = frame_info.command_buffer;
+		uint32_t scope = frame_info.gpu_profiler != nullptr ?
+			frame_info.gpu_profiler->beginScope(command_buffer, "particles") : DecoGpuProfiler::INVALID_SCOPE;
+
+		const float emit = m_emission_rate * frame_info.frame_time + m_emit_remainder;
+		const float emit_count = std::floor(std::min(emit, static_cast<float>(MAX_PARTICLES)));
+		// only the fraction carries over, a long frame must not turn into several frames of full bursts
+		m_emit_remainder = emit - std::floor(emit);
+
+		m_push.emitter = glm::vec4(m_emitter_position, m_emitter_radius);
+		m_push.params = glm::vec4(frame_info.frame_time, m_lifetime, m_launch_speed, m_gravity);
+		m_push.control = glm::uvec4(static_cast<uint32_t>(emit_count), m_alive_list, m_frame_seed++, MAX_PARTICLES);
+
+		// the previous frame's draw still reads the alive list and arguments rewritten below, and its
+		// compute passes wrote the lists and counters this frame's passes read
+		DecoBarrier::memory(
+			command_buffer,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindDescriptorSets(
+			command_buffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			m_pipeline_layout,
+			0,
+			1,
+			&m_descriptor_set,
+			1,
+			&frame_info.global_ubo_offset);
+		vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticlePush), &m_push);
+
+		m_begin_args_pipeline->bind(command_buffer);
+		m_begin_args_pipeline->dispatch(command_buffer, 1);
+		DecoBarrier::computeToIndirectCompute(command_buffer);
+
+		m_emit_pipeline->bind(command_buffer);
+		m_emit_pipeline->dispatchIndirect(command_buffer, m_counter_buffer->getBuffer(), offsetof(ParticleCounters, emit_dispatch));
+		DecoBarrier::computeToCompute(command_buffer);
+
+		m_simulate_pipeline->bind(command_buffer);
+		m_simulate_pipeline->dispatchIndirect(command_buffer, m_counter_buffer->getBuffer(), offsetof(ParticleCounters, simulate_dispatch));
+		DecoBarrier::computeToCompute(command_buffer);
+
+		// the renderer's compute pass makes the draw arguments visible to the indirect draw
+		m_end_args_pipeline->bind(command_buffer);
+		m_end_args_pipeline->dispatch(command_buffer, 1);
+
+		// next frame simulates the survivors of this one
+		m_alive_list = 1 - m_alive_list;
+
+		if (frame_info.gpu_profiler != nullptr)
+		{
+			frame_info.gpu_profiler->endScope(command_buffer, scope);
+		}
+	}
+
+	void ParticleSystem::render(FrameInfo& frame_info)
+	{
+		assert(frame_info.render_queue != nullptr && "ParticleSystem draws through the render queue");
+
+		// one billboard per instance, the instance count is the alive count simulate left in the counters
+		DecoDrawCommand command{};
+		command.m_layer = RENDER_LAYER_PARTICLES;
+		command.m_pipeline = m_render_pipeline.get();
+		command.m_pipeline_layout = m_pipeline_layout;
+		command.m_descriptor_set = m_descriptor_set;
+		command.m_dynamic_offsets[0] = frame_info.global_ubo_offset;
+		command.m_dynamic_offset_count = 1;
+		command.m_indirect_buffer = m_counter_buffer->getBuffer();
+		command.m_indirect_offset = offsetof(ParticleCounters, draw);
+		command.m_push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		frame_info.render_queue->push(command, &m_push, sizeof(m_push));
+	}
+}
\ No newline at end of file
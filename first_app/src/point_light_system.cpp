@@ -11,15 +11,33 @@
 
 namespace Deco
 {
-	PointLightSystem::PointLightSystem(DecoDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout) : m_deco_device(device)
+	// layout matches PointLight in the shaders
+	struct PointLight
 	{
+		glm::vec4 position{}; // w is range
+		glm::vec4 color{}; // w is intensity
+	};
+
+	PointLightSystem::PointLightSystem(DecoDevice& device, const DecoRenderer& renderer, VkDescriptorSetLayout global_set_layout) : m_deco_device(device)
+	{
+		createLightBuffers(renderer.getFramesInFlight());
 		createPipelineLayout(global_set_layout);
-		createPipeline(render_pass);
+		createPipeline(renderer);
 	}
 
-	PointLightSystem::~PointLightSystem()
+	void PointLightSystem::createLightBuffers(uint32_t frames_in_flight)
 	{
-		vkDestroyPipelineLayout(m_deco_device.device(), m_pipeline_layout, nullptr);
+		for (uint32_t i = 0; i < frames_in_flight; i++)
+		{
+			auto light_buffer = std::make_unique<DecoBuffer>(
+				m_deco_device,
+				sizeof(PointLight),
+				MAX_LIGHTS,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				DecoBuffer::uploadMemoryCandidates());
+			light_buffer->map();
+			m_light_buffers.push_back(std::move(light_buffer));
+		}
 	}
 
 	void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout global_set_layout)
@@ -29,26 +47,11 @@ namespace Deco
 		//push_constant_range.offset = 0;
 		//push_constant_range.size = sizeof(SimplePushConstantData);
 
-		std::vector<VkDescriptorSetLayout> descriptor_set_layouts{ global_set_layout };
-
-		VkPipelineLayoutCreateInfo pipeline_layout_info{};
-		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
-		pipeline_layout_info.pSetLayouts = descriptor_set_layouts.data();
-		pipeline_layout_info.pushConstantRangeCount = 0;
-		pipeline_layout_info.pPushConstantRanges = nullptr;
-
-		if (vkCreatePipelineLayout(
-			m_deco_device.device(),
-			&pipeline_layout_info,
-			nullptr,
-			&m_pipeline_layout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create pipeline layout!");
-		}
+		// owned by the device's layout cache, the same handle as LightClusterSystem's
+		m_pipeline_layout = m_deco_device.getLayoutCache().getPipelineLayout({ global_set_layout });
 	}
 
-	void PointLightSystem::createPipeline(VkRenderPass render_pass)
+	void PointLightSystem::createPipeline(const DecoRenderer& renderer)
 	{
 		assert(m_pipeline_layout != nullptr && "Cannot create pipeline before swap chain");
 
@@ -56,7 +59,7 @@ namespace Deco
 		DecoPipeline::defaultPipelineConfigInfo(pipeline_config);
 		pipeline_config.attributeDescriptions.clear();
 		pipeline_config.bindingDescriptions.clear();
-		pipeline_config.m_render_pass = render_pass;
+		renderer.configurePipeline(pipeline_config);
 		pipeline_config.m_pipeline_layout = m_pipeline_layout;
 		m_deco_pipeline = std::make_unique<DecoPipeline>(
 			m_deco_device,
@@ -65,20 +68,53 @@ namespace Deco
 			pipeline_config);
 	}
 
-	void PointLightSystem::render(FrameInfo& frame_info)
+	void PointLightSystem::update(FrameInfo& frame_info, GlobalUbo& ubo)
 	{
-		m_deco_pipeline->bind(frame_info.command_buffer);
+		auto& light_buffer = *m_light_buffers[frame_info.frame_index];
+		auto* lights = static_cast<PointLight*>(light_buffer.getMappedMemory());
 
-		vkCmdBindDescriptorSets(
-			frame_info.command_buffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			m_pipeline_layout,
-			0,
-			1,
-			&frame_info.global_descriptor_set,
-			0,
-			nullptr);
+		m_light_count = 0;
+		for (auto& kv : frame_info.game_objects)
+		{
+			auto& object = kv.second;
+			if (object.m_point_light == nullptr) continue;
+			if (m_light_count == MAX_LIGHTS) break;
+
+			PointLight& light = lights[m_light_count++];
+			light.position = glm::vec4(object.m_transform.m_translation, object.m_point_light->m_range);
+			light.color = glm::vec4(object.m_color, object.m_point_light->m_light_intensity);
+		}
+
+		if (m_light_count > 0)
+		{
+			light_buffer.markDirty(m_light_count * sizeof(PointLight));
+			if (frame_info.upload_batch != nullptr)
+			{
+				frame_info.upload_batch->add(light_buffer);
+			}
+			else
+			{
+				light_buffer.flushDirty();
+			}
+		}
+		ubo.cluster_grid.w = m_light_count;
+	}
+
+	void PointLightSystem::render(FrameInfo& frame_info)
+	{
+		assert(frame_info.render_queue != nullptr && "PointLightSystem draws through the render queue");
+		if (m_light_count == 0) return;
 
-		vkCmdDraw(frame_info.command_buffer, 6, 1, 0, 0);
+		// one billboard per instance, expanded from six vertices in the vertex shader
+		DecoDrawCommand command{};
+		command.m_layer = RENDER_LAYER_LIGHTS;
+		command.m_pipeline = m_deco_pipeline.get();
+		command.m_pipeline_layout = m_pipeline_layout;
+		command.m_descriptor_set = frame_info.global_descriptor_set;
+		command.m_dynamic_offsets[0] = frame_info.global_ubo_offset;
+		command.m_dynamic_offset_count = 1;
+		command.m_vertex_count = 6;
+		command.m_instance_count = m_light_count;
+		frame_info.render_queue->push(command);
 	}
 }
\ No newline at end of file
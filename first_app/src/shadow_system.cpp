@@ -0,0 +1,304 @@
+#include "shadow_system.h"
+
+#include "deco_camera.h"
+#include "deco_frustum.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace Deco
+{
+	// 0 splits the shadow distance uniformly, 1 logarithmically; in between keeps the near cascades
+	// tight without starving the far ones
+	static constexpr float SPLIT_LAMBDA = 0.75f;
+	// cascade radii are rounded up to this, so a cascade's size and texel size only change in steps
+	static constexpr float RADIUS_STEP = 1.0f / 16.0f;
+
+	ShadowSystem::ShadowSystem(DecoDevice& device, const DecoRenderer& renderer, DecoDescriptorAllocator& descriptor_allocator)
+		: m_deco_device(device)
+	{
+		m_shadow_map = std::make_unique<DecoShadowMap>(m_deco_device, RESOLUTION, SHADOW_CASCADE_COUNT);
+		createInstanceBuffers(renderer.getFramesInFlight(), descriptor_allocator);
+		createPipelineLayout();
+		createPipeline();
+	}
+
+	void ShadowSystem::setDirectionalLight(const glm::vec3& direction, const glm::vec3& color, float intensity)
+	{
+		assert(glm::dot(direction, direction) > 0.0f && "Directional light without a direction");
+		m_light_direction = glm::normalize(direction);
+		m_light_color = color;
+		m_light_intensity = intensity;
+	}
+
+	void ShadowSystem::createInstanceBuffers(uint32_t frames_in_flight, DecoDescriptorAllocator& descriptor_allocator)
+	{
+		m_set_layout = DecoDescriptorSetLayout::Builder(m_deco_device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.build();
+
+		for (uint32_t i = 0; i < frames_in_flight; i++)
+		{
+			auto instance_buffer = std::make_unique<DecoBuffer>(
+				m_deco_device,
+				sizeof(glm::mat4),
+				MAX_INSTANCES,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				DecoBuffer::uploadMemoryCandidates());
+			instance_buffer->map();
+
+			auto instance_info = instance_buffer->descriptorInfo();
+			VkDescriptorSet descriptor_set;
+			DecoDescriptorWriter(*m_set_layout, descriptor_allocator)
+				.writeBuffer(0, &instance_info)
+				.build(descriptor_set);
+
+			m_descriptor_sets.push_back(descriptor_set);
+			m_instance_buffers.push_back(std::move(instance_buffer));
+		}
+	}
+
+	void ShadowSystem::createPipelineLayout()
+	{
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(glm::mat4);
+
+		// owned by the device's layout cache
+		m_pipeline_layout = m_deco_device.getLayoutCache().getPipelineLayout(
+			{ m_set_layout->getDescriptorSetLayout() }, { push_constant_range });
+	}
+
+	void ShadowSystem::createPipeline()
+	{
+		assert(m_pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		PipelineConfigInfo pipeline_config{};
+		DecoPipeline::defaultPipelineConfigInfo(pipeline_config);
+		pipeline_config.m_render_pass = m_shadow_map->getRenderPass();
+		pipeline_config.m_pipeline_layout = m_pipeline_layout;
+		// depth only, no color attachment to blend into
+		pipeline_config.m_color_blend_info.attachmentCount = 0;
+		// slope scaled bias against acne on surfaces grazing the light, the shaders add a normal offset
+		pipeline_config.m_rasterization_info.depthBiasEnable = VK_TRUE;
+		pipeline_config.m_rasterization_info.depthBiasConstantFactor = 1.25f;
+		pipeline_config.m_rasterization_info.depthBiasSlopeFactor = 1.75f;
+		m_deco_pipeline = std::make_unique<DecoPipeline>(
+			m_deco_device,
+			"../shaders/shadow.vert.spv",
+			"",
+			pipeline_config);
+	}
+
+	void ShadowSystem::update(FrameInfo& frame_info, GlobalUbo& ubo)
+	{
+		ubo.directional_light_direction = glm::vec4(m_light_direction, 0.0f);
+		ubo.directional_light_color = glm::vec4(m_light_color, m_light_intensity);
+
+		for (auto& draws : m_cascade_draws)
+		{
+			draws.clear();
+		}
+		m_instance_count = 0;
+		m_dropped_casters = 0;
+		if (m_light_intensity <= 0.0f)
+		{
+			ubo.cascade_splits = glm::vec4(0.0f);
+			return;
+		}
+
+		// the casters of every model, with the bounds the camera culls them by; the groups keep their
+		// storage between frames, their model pointer is only set by this frame's objects
+		for (auto& group : m_caster_groups)
+		{
+			group.m_model = nullptr;
+			group.m_model_matrices.clear();
+			group.m_bounding_spheres.clear();
+		}
+		for (auto& kv : frame_info.game_objects)
+		{
+			auto& object = kv.second;
+			if (object.m_model == nullptr || !object.m_model->isReady()) continue;
+
+			DecoModel* model = object.m_model.get();
+			auto group_it = m_caster_group_indices.find(model->getId());
+			if (group_it == m_caster_group_indices.end())
+			{
+				group_it = m_caster_group_indices.emplace(model->getId(), m_caster_groups.size()).first;
+				m_caster_groups.push_back({ nullptr, {}, {} });
+			}
+
+			CasterGroup& group = m_caster_groups[group_it->second];
+			group.m_model = model;
+			group.m_model_matrices.push_back(object.m_transform.mat4());
+			group.m_bounding_spheres.push_back(DecoFrustum::transformSphere(group.m_model_matrices.back(), model->getBoundingSphere()));
+		}
+
+		// a group nothing cast into this frame may belong to a model the registry has freed
+		auto unused_begin = std::remove_if(m_caster_groups.begin(), m_caster_groups.end(),
+			[](const CasterGroup& group) { return group.m_model == nullptr; });
+		if (unused_begin != m_caster_groups.end())
+		{
+			m_caster_groups.erase(unused_begin, m_caster_groups.end());
+			m_caster_group_indices.clear();
+			for (size_t i = 0; i < m_caster_groups.size(); i++)
+			{
+				m_caster_group_indices.emplace(m_caster_groups[i].m_model->getId(), i);
+			}
+		}
+
+		const DecoCamera& camera = frame_info.camera;
+		const float near = camera.getNearClip();
+		const float far = std::min(camera.getFarClip(), m_shadow_distance);
+		assert(near > 0.0f && far > near && "Shadow cascades need a perspective camera");
+
+		// a pure rotation, so the cascades' texel grids stay fixed in world space
+		DecoCamera light_camera{};
+		const glm::vec3 up = std::abs(m_light_direction.y) > 0.99f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, -1.0f, 0.0f };
+		light_camera.setViewDirection(glm::vec3{ 0.0f }, m_light_direction, up);
+		const glm::mat4 light_view = light_camera.getView();
+
+		auto& instance_buffer = *m_instance_buffers[frame_info.frame_index];
+		auto* instances = static_cast<glm::mat4*>(instance_buffer.getMappedMemory());
+		uint32_t instance_count = 0;
+
+		float split_near = near;
+		for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+		{
+			const float p = static_cast<float>(cascade + 1) / SHADOW_CASCADE_COUNT;
+			const float uniform_split = near + (far - near) * p;
+			const float log_split = near * std::pow(far / near, p);
+			const float split_far = uniform_split + (log_split - uniform_split) * SPLIT_LAMBDA;
+
+			// a bounding sphere keeps the cascade's extent independent of the camera's rotation
+			const auto corners = camera.getFrustumCorners(split_near, split_far);
+			glm::vec3 center{ 0.0f };
+			for (const auto& corner : corners)
+			{
+				center += corner;
+			}
+			center /= static_cast<float>(corners.size());
+			float radius = 0.0f;
+			for (const auto& corner : corners)
+			{
+				radius = std::max(radius, glm::length(corner - center));
+			}
+			radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+			// moving the window by whole texels only keeps static geometry from shimmering
+			const float texel_size = 2.0f * radius / RESOLUTION;
+			glm::vec3 light_center = glm::vec3(light_view * glm::vec4(center, 1.0f));
+			light_center.x = std::floor(light_center.x / texel_size) * texel_size;
+			light_center.y = std::floor(light_center.y / texel_size) * texel_size;
+
+			DecoCamera cascade_camera{};
+			cascade_camera.setOrthographicProjection(
+				light_center.x - radius, light_center.x + radius,
+				light_center.y - radius, light_center.y + radius,
+				light_center.z - radius, light_center.z + radius);
+			const DecoFrustum cascade_frustum{ cascade_camera.getProjection() * light_view };
+
+			// anything towards the light still casts into the cascade, the near plane is pulled back to
+			// the closest caster instead of culling
+			const uint32_t caster_planes = ((1u << DecoFrustum::PLANE_COUNT) - 1) & ~(1u << DecoFrustum::PLANE_NEAR);
+			float light_near = light_center.z - radius;
+			for (auto& group : m_caster_groups)
+			{
+				const uint32_t first_instance = instance_count;
+				for (size_t i = 0; i < group.m_model_matrices.size(); i++)
+				{
+					const glm::vec4& sphere = group.m_bounding_spheres[i];
+					if (!cascade_frustum.intersectsSphere(sphere, caster_planes)) continue;
+					if (instance_count == MAX_INSTANCES)
+					{
+						m_dropped_casters++;
+						continue;
+					}
+
+					instances[instance_count++] = group.m_model_matrices[i];
+					const float caster_z = (light_view * glm::vec4(glm::vec3(sphere), 1.0f)).z;
+					light_near = std::min(light_near, caster_z - sphere.w);
+				}
+				if (instance_count > first_instance)
+				{
+					m_cascade_draws[cascade].push_back({ group.m_model, first_instance, instance_count - first_instance });
+				}
+			}
+
+			cascade_camera.setOrthographicProjection(
+				light_center.x - radius, light_center.x + radius,
+				light_center.y - radius, light_center.y + radius,
+				light_near, light_center.z + radius);
+			m_cascade_view_projections[cascade] = cascade_camera.getProjection() * light_view;
+
+			ubo.cascade_view_projections[cascade] = m_cascade_view_projections[cascade];
+			ubo.cascade_splits[cascade] = split_far;
+			split_near = split_far;
+		}
+		m_instance_count = instance_count;
+
+		if (instance_count > 0)
+		{
+			instance_buffer.markDirty(instance_count * sizeof(glm::mat4));
+			if (frame_info.upload_batch != nullptr)
+			{
+				frame_info.upload_batch->add(instance_buffer);
+			}
+			else
+			{
+				instance_buffer.flushDirty();
+			}
+		}
+	}
+
+	void ShadowSystem::render(FrameInfo& frame_info)
+	{
+		uint32_t scope = frame_info.gpu_profiler != nullptr ?
+			frame_info.gpu_profiler->beginScope(frame_info.command_buffer, "shadows") : DecoGpuProfiler::INVALID_SCOPE;
+
+		for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+		{
+			// empty cascades are still cleared and transitioned, the shading samples every layer
+			m_shadow_map->beginCascade(frame_info.command_buffer, cascade);
+			if (!m_cascade_draws[cascade].empty())
+			{
+				m_deco_pipeline->bind(frame_info.command_buffer);
+				vkCmdBindDescriptorSets(
+					frame_info.command_buffer,
+					VK_PIPELINE_BIND_POINT_GRAPHICS,
+					m_pipeline_layout,
+					0,
+					1,
+					&m_descriptor_sets[frame_info.frame_index],
+					0,
+					nullptr);
+				vkCmdPushConstants(
+					frame_info.command_buffer,
+					m_pipeline_layout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					sizeof(glm::mat4),
+					&m_cascade_view_projections[cascade]);
+
+				for (const auto& draw : m_cascade_draws[cascade])
+				{
+					draw.m_model->bind(frame_info.command_buffer);
+					draw.m_model->draw(frame_info.command_buffer, draw.m_instance_count, draw.m_first_instance);
+				}
+			}
+			m_shadow_map->endCascade(frame_info.command_buffer);
+		}
+
+		if (frame_info.gpu_profiler != nullptr)
+		{
+			frame_info.gpu_profiler->endScope(frame_info.command_buffer, scope);
+		}
+	}
+}
\ No newline at end of file
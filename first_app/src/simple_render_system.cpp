@@ -1,5 +1,7 @@
 #include "simple_render_system.h"
 
+#include "deco_frustum.h"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
@@ -8,6 +10,7 @@
 #include <array>
 #include <cassert>
 #include <stdexcept>
+#include <string>
 
 namespace Deco
 {
@@ -17,15 +20,64 @@ namespace Deco
 		glm::mat4 normal_matrix{ 1.0f };
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(DecoDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout) : m_deco_device(device)
+	struct ObjectData
+	{
+		glm::mat4 model_matrix{ 1.0f };
+		glm::mat4 normal_matrix{ 1.0f };
+		// x: sampled image slot of the texture, DecoBindlessHeap::INVALID_SLOT for none
+		glm::uvec4 material{ DecoBindlessHeap::INVALID_SLOT, 0, 0, 0 };
+	};
+
+	// bindless mode: ObjectData lives at objects[object_index] of the storage buffer in heap slot
+	// object_buffer_slot
+	struct BindlessPushConstantData
 	{
+		uint32_t object_buffer_slot;
+		uint32_t object_index;
+	};
+
+	SimpleRenderSystem::SimpleRenderSystem(
+		DecoDevice& device,
+		const DecoRenderer& renderer,
+		VkDescriptorSetLayout global_set_layout,
+		DecoBindlessHeap* bindless_heap) : m_deco_device(device), m_bindless_heap(bindless_heap)
+	{
+		if (m_bindless_heap != nullptr)
+		{
+			createObjectBuffers(renderer.getFramesInFlight());
+		}
 		createPipelineLayout(global_set_layout);
-		createPipeline(render_pass);
+		createPipeline(renderer);
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
-		vkDestroyPipelineLayout(m_deco_device.device(), m_pipeline_layout, nullptr);
+		for (uint32_t slot : m_object_buffer_slots)
+		{
+			m_bindless_heap->releaseStorageBuffer(slot);
+		}
+		// the heap may still be read by frames in flight
+		for (auto& object_buffer : m_object_buffers)
+		{
+			m_deco_device.getDeletionQueue().release(std::move(object_buffer));
+		}
+	}
+
+	void SimpleRenderSystem::createObjectBuffers(uint32_t frames_in_flight)
+	{
+		for (uint32_t i = 0; i < frames_in_flight; i++)
+		{
+			auto object_buffer = std::make_unique<DecoBuffer>(
+				m_deco_device,
+				sizeof(ObjectData),
+				MAX_OBJECTS,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				DecoBuffer::uploadMemoryCandidates());
+			object_buffer->map();
+
+			m_object_buffer_slots.push_back(m_bindless_heap->addStorageBuffer(object_buffer->descriptorInfo()));
+			m_object_buffers.push_back(std::move(object_buffer));
+		}
 	}
 
 	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout global_set_layout)
@@ -36,72 +88,142 @@ namespace Deco
 		push_constant_range.size = sizeof(SimplePushConstantData);
 
 		std::vector<VkDescriptorSetLayout> descriptor_set_layouts{ global_set_layout };
-
-		VkPipelineLayoutCreateInfo pipeline_layout_info{};
-		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
-		pipeline_layout_info.pSetLayouts = descriptor_set_layouts.data();
-		pipeline_layout_info.pushConstantRangeCount = 1;
-		pipeline_layout_info.pPushConstantRanges = &push_constant_range;
-
-		if (vkCreatePipelineLayout(
-			m_deco_device.device(),
-			&pipeline_layout_info,
-			nullptr,
-			&m_pipeline_layout) != VK_SUCCESS)
+		if (m_bindless_heap != nullptr)
 		{
-			throw std::runtime_error("Failed to create pipeline layout!");
+			push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+			push_constant_range.size = sizeof(BindlessPushConstantData);
+			descriptor_set_layouts.push_back(m_bindless_heap->getDescriptorSetLayout());
 		}
+
+		// owned by the device's layout cache
+		m_pipeline_layout = m_deco_device.getLayoutCache().getPipelineLayout(descriptor_set_layouts, { push_constant_range });
 	}
 
-	void SimpleRenderSystem::createPipeline(VkRenderPass render_pass)
+	void SimpleRenderSystem::createPipeline(const DecoRenderer& renderer)
 	{
 		assert(m_pipeline_layout != nullptr && "Cannot create pipeline before swap chain");
 
+		const std::string vert_shader_path = m_bindless_heap != nullptr ?
+			"../shaders/simple_shader_bindless.vert.spv" : "../shaders/simple_shader.vert.spv";
+		const std::string frag_shader_path = m_bindless_heap != nullptr ?
+			"../shaders/simple_shader_bindless.frag.spv" : "../shaders/simple_shader.frag.spv";
+
 		PipelineConfigInfo pipeline_config{};
 		DecoPipeline::defaultPipelineConfigInfo(pipeline_config);
-		pipeline_config.m_render_pass = render_pass;
+		renderer.configurePipeline(pipeline_config);
 		pipeline_config.m_pipeline_layout = m_pipeline_layout;
 		m_deco_pipeline = std::make_unique<DecoPipeline>(
 			m_deco_device,
-			"../shaders/simple_shader.vert.spv",
-			"../shaders/simple_shader.frag.spv",
+			vert_shader_path,
+			frag_shader_path,
+			pipeline_config);
+
+		// same vertex shader (gl_Position is invariant), no fragment stage, depth writes only
+		pipeline_config.m_color_blend_attachment.colorWriteMask = 0;
+		m_depth_prepass_pipeline = std::make_unique<DecoPipeline>(
+			m_deco_device,
+			vert_shader_path,
+			"",
+			pipeline_config);
+
+		// depth is final after the pre-pass, only the visible surface passes
+		pipeline_config.m_color_blend_attachment.colorWriteMask =
+			VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		pipeline_config.m_depth_stencil_info.depthWriteEnable = VK_FALSE;
+		pipeline_config.m_depth_stencil_info.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		m_depth_equal_pipeline = std::make_unique<DecoPipeline>(
+			m_deco_device,
+			vert_shader_path,
+			frag_shader_path,
 			pipeline_config);
 	}
 
 	void SimpleRenderSystem::renderGameObjects(FrameInfo& frame_info)
 	{
-		m_deco_pipeline->bind(frame_info.command_buffer);
-
-		vkCmdBindDescriptorSets(
-			frame_info.command_buffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			m_pipeline_layout,
-			0,
-			1,
-			&frame_info.global_descriptor_set,
-			0,
-			nullptr);
+		assert(frame_info.render_queue != nullptr && "SimpleRenderSystem draws through the render queue");
+
+		const glm::mat4 view = frame_info.camera.getView();
+		// ShadowSystem culls its casters by the same bounding spheres
+		const DecoFrustum frustum{ frame_info.camera.getProjection() * view };
+
+		DecoDrawCommand command{};
+		command.m_pipeline_layout = m_pipeline_layout;
+		command.m_descriptor_set = frame_info.global_descriptor_set;
+		command.m_dynamic_offsets[0] = frame_info.global_ubo_offset;
+		command.m_dynamic_offset_count = 1;
+
+		ObjectData* objects = nullptr;
+		BindlessPushConstantData bindless_push{};
+		if (m_bindless_heap != nullptr)
+		{
+			command.m_bindless_set = m_bindless_heap->getDescriptorSet();
+			command.m_push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+			objects = static_cast<ObjectData*>(m_object_buffers[frame_info.frame_index]->getMappedMemory());
+			bindless_push.object_buffer_slot = m_object_buffer_slots[frame_info.frame_index];
+		}
+		else
+		{
+			command.m_push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
 
 		for (auto& kv : frame_info.game_objects)
 		{
 			auto& object = kv.second;
-			if (object.m_model == nullptr) continue;
+			if (object.m_model == nullptr || !object.m_model->isReady()) continue;
 
 			SimplePushConstantData push{};
 			push.model_matrix = object.m_transform.mat4();
+			if (!frustum.intersectsSphere(DecoFrustum::transformSphere(push.model_matrix, object.m_model->getBoundingSphere()))) continue;
 			push.normal_matrix = object.m_transform.normalMatrix();
 
-			vkCmdPushConstants(
-				frame_info.command_buffer,
-				m_pipeline_layout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
+			const void* push_data = &push;
+			uint32_t push_size = sizeof(push);
+			if (objects != nullptr)
+			{
+				if (bindless_push.object_index == MAX_OBJECTS) break;
+				ObjectData& object_data = objects[bindless_push.object_index];
+				object_data.model_matrix = push.model_matrix;
+				object_data.normal_matrix = push.normal_matrix;
+				object_data.material.x = object.m_texture != nullptr && object.m_texture->isReady() ?
+					object.m_texture->getBindlessSlot() : DecoBindlessHeap::INVALID_SLOT;
+				push_data = &bindless_push;
+				push_size = sizeof(bindless_push);
+			}
+
+			command.m_model = object.m_model.get();
+			// the camera looks down +z in view space, smaller z is closer
+			command.m_depth = (view * glm::vec4(object.m_transform.m_translation, 1.0f)).z;
+
+			if (m_depth_prepass_enabled)
+			{
+				command.m_layer = RENDER_LAYER_DEPTH_PREPASS;
+				command.m_pipeline = m_depth_prepass_pipeline.get();
+				frame_info.render_queue->push(command, push_data, push_size);
+
+				command.m_pipeline = m_depth_equal_pipeline.get();
+			}
+			else
+			{
+				command.m_pipeline = m_deco_pipeline.get();
+			}
+
+			command.m_layer = RENDER_LAYER_OPAQUE;
+			frame_info.render_queue->push(command, push_data, push_size);
+			bindless_push.object_index++;
+		}
 
-			object.m_model->bind(frame_info.command_buffer);
-			object.m_model->draw(frame_info.command_buffer);
+		if (objects != nullptr && bindless_push.object_index > 0)
+		{
+			auto& object_buffer = *m_object_buffers[frame_info.frame_index];
+			object_buffer.markDirty(bindless_push.object_index * sizeof(ObjectData));
+			if (frame_info.upload_batch != nullptr)
+			{
+				frame_info.upload_batch->add(object_buffer);
+			}
+			else
+			{
+				object_buffer.flushDirty();
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 450
+
+layout (location = 0) in vec2 fragOffset;
+layout (location = 1) in vec4 fragColor;
+layout (location = 0) out vec4 outColor;
+
+// additive, so the particles need no sorting
+void main() {
+  float falloff = 1.0 - dot(fragOffset, fragOffset);
+  if (falloff <= 0.0) {
+    discard;
+  }
+  outColor = vec4(fragColor.rgb * fragColor.a * falloff, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#version 450
+
+const vec2 OFFSETS[6] = vec2[](
+  vec2(-1.0, -1.0),
+  vec2(-1.0, 1.0),
+  vec2(1.0, -1.0),
+  vec2(1.0, -1.0),
+  vec2(-1.0, 1.0),
+  vec2(1.0, 1.0)
+);
+
+layout (location = 0) out vec2 fragOffset;
+layout (location = 1) out vec4 fragColor;
+
+struct Particle {
+  vec4 position; // w is age
+  vec4 velocity; // w is lifetime
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  vec4 ambientLightColor; // w is intensity
+  uvec4 clusterGrid; // w is point light count
+  vec4 clusterParams;
+} ubo;
+
+layout(std430, set = 0, binding = 1) readonly buffer Particles {
+  Particle particles[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer AliveLists {
+  uint aliveLists[];
+};
+
+layout(push_constant) uniform Push {
+  vec4 emitter; // xyz: position, w: spawn radius
+  vec4 params; // x: delta time, y: lifetime, z: launch speed, w: gravity
+  uvec4 control; // x: particles to emit, y: alive list read this frame, z: random seed, w: max particles
+} push;
+
+const float PARTICLE_RADIUS = 0.006;
+const vec3 YOUNG_COLOR = vec3(1.0, 0.75, 0.3);
+const vec3 OLD_COLOR = vec3(0.6, 0.1, 0.02);
+
+// one instance per live particle, the survivors of this frame's simulation
+void main() {
+  uint aliveOut = 1 - push.control.y;
+  Particle particle = particles[aliveLists[aliveOut * push.control.w + gl_InstanceIndex]];
+  float life = clamp(particle.position.w / particle.velocity.w, 0.0, 1.0);
+
+  fragOffset = OFFSETS[gl_VertexIndex];
+  fragColor = vec4(mix(YOUNG_COLOR, OLD_COLOR, life), 1.0 - life);
+
+  vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
+  vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
+
+  vec3 positionWorld = particle.position.xyz
+    + PARTICLE_RADIUS * fragOffset.x * cameraRightWorld
+    + PARTICLE_RADIUS * fragOffset.y * cameraUpWorld;
+
+  gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
+}
\ No newline at end of file
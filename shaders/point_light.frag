@@ -1,20 +1,13 @@
 #version 450
 
 layout (location = 0) in vec2 fragOffset;
+layout (location = 1) in vec3 fragColor;
 layout (location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 0) uniform GlobalUbo {
-  mat4 projection;
-  mat4 view;
-  vec4 ambientLightColor; // w is intensity
-  vec3 lightPosition;
-  vec4 lightColor;
-} ubo;
-
 void main() {
   float dis = sqrt(dot(fragOffset, fragOffset));
   if (dis >= 1.0) {
     discard;
   }
-  outColor = vec4(ubo.lightColor.xyz, 1.0);
+  outColor = vec4(fragColor, 1.0);
 }
\ No newline at end of file
@@ -10,23 +10,37 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout (location = 0) out vec2 fragOffset;
+layout (location = 1) out vec3 fragColor;
+
+struct PointLight {
+  vec4 position; // w is range
+  vec4 color; // w is intensity
+};
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   vec4 ambientLightColor; // w is intensity
-  vec3 lightPosition;
-  vec4 lightColor;
+  uvec4 clusterGrid; // w is point light count
+  vec4 clusterParams;
 } ubo;
 
-const float LIGHT_RADIUS = 0.05;
+layout(std430, set = 0, binding = 1) readonly buffer PointLights {
+  PointLight lights[];
+};
+
+const float LIGHT_RADIUS = 0.02;
 
+// one instance per light
 void main() {
+  PointLight light = lights[gl_InstanceIndex];
   fragOffset = OFFSETS[gl_VertexIndex];
+  fragColor = light.color.xyz;
+
   vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
   vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-  vec3 positionWorld = ubo.lightPosition.xyz
+  vec3 positionWorld = light.position.xyz
     + LIGHT_RADIUS * fragOffset.x * cameraRightWorld
     + LIGHT_RADIUS * fragOffset.y * cameraUpWorld;
 
@@ -3,8 +3,17 @@
 del *.spv
 
 glslc.exe simple_shader.vert -o simple_shader.vert.spv
+glslc.exe simple_shader_bindless.vert -o simple_shader_bindless.vert.spv
 glslc.exe simple_shader.frag -o simple_shader.frag.spv
+glslc.exe simple_shader_bindless.frag -o simple_shader_bindless.frag.spv
 glslc.exe point_light.vert -o point_light.vert.spv
 glslc.exe point_light.frag -o point_light.frag.spv
+glslc.exe light_cluster.comp -o light_cluster.comp.spv
+glslc.exe particle.vert -o particle.vert.spv
+glslc.exe particle.frag -o particle.frag.spv
+glslc.exe particle_args.comp -o particle_args.comp.spv
+glslc.exe particle_emit.comp -o particle_emit.comp.spv
+glslc.exe particle_simulate.comp -o particle_simulate.comp.spv
+glslc.exe shadow.vert -o shadow.vert.spv
 
 pause
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+// ShadowSystem's instance buffer, the model matrices of one cascade's casters grouped by model
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    mat4 modelMatrices[];
+};
+
+layout(push_constant) uniform Push
+{
+    mat4 viewProjection; // of the cascade being drawn
+} push;
+
+void main()
+{
+    gl_Position = push.viewProjection * modelMatrices[gl_InstanceIndex] * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -6,27 +6,117 @@ layout (location = 2) in vec3 fragNormalWorld;
 
 layout (location = 0) out vec4 outColor;
 
+struct PointLight
+{
+    vec4 position; // w is range
+    vec4 color; // w is intensity
+};
+
+// matches SHADOW_CASCADE_COUNT in deco_frame_info.h
+const uint SHADOW_CASCADE_COUNT = 4;
+
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     vec4 ambinetLightColor;
-    vec3 lightPosition;
-    vec4 lightColor;
+    uvec4 clusterGrid; // w is point light count
+    vec4 clusterParams; // xy: tile size in pixels, zw: depth slice scale and bias
+    vec4 directionalLightDirection; // xyz: direction the light travels in
+    vec4 directionalLightColor; // w is intensity
+    vec4 cascadeSplits; // view depth each cascade ends at
+    mat4 cascadeViewProjections[SHADOW_CASCADE_COUNT];
 } ubo;
 
-layout(push_constant) uniform Push
+layout(std430, set = 0, binding = 1) readonly buffer PointLights {
+    PointLight lights[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer ClusterLightCounts {
+    uint clusterLightCounts[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer ClusterLightIndices {
+    uint clusterLightIndices[];
+};
+
+// ShadowSystem's cascades, one layer each, compared against the reference depth
+layout(set = 0, binding = 4) uniform sampler2DArrayShadow shadowMap;
+
+// matches LightClusterSystem::MAX_LIGHTS_PER_CLUSTER
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+uint clusterIndex(float viewDepth)
+{
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.clusterParams.xy), ubo.clusterGrid.xy - 1);
+    uint slice = uint(max(log(viewDepth) * ubo.clusterParams.z - ubo.clusterParams.w, 0.0));
+    slice = min(slice, ubo.clusterGrid.z - 1);
+    return tile.x + ubo.clusterGrid.x * (tile.y + ubo.clusterGrid.y * slice);
+}
+
+// 1 lit, 0 in shadow, 3x3 PCF in the first cascade that covers the fragment
+float directionalShadow(vec3 normal, float viewDepth)
 {
-    mat4 moodelMatrix;
-    mat4 normalMatrix;
-} push;
+    if (viewDepth > ubo.cascadeSplits[SHADOW_CASCADE_COUNT - 1]) return 1.0;
+
+    uint cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT - 1 && viewDepth > ubo.cascadeSplits[cascade])
+    {
+        cascade++;
+    }
+    mat4 cascadeViewProjection = ubo.cascadeViewProjections[cascade];
+
+    // the light view is a pure rotation, the first row's length is the projection's x scale
+    float texelSize = 1.0 / float(textureSize(shadowMap, 0).x);
+    float worldTexelSize = 2.0 * texelSize / length(vec3(cascadeViewProjection[0][0], cascadeViewProjection[1][0], cascadeViewProjection[2][0]));
+
+    // pushing the lookup out along the normal by a texel or two keeps lit surfaces from self shadowing
+    vec4 shadowPosition = cascadeViewProjection * vec4(fragPosWorld + normal * worldTexelSize * 1.5, 1.0);
+    vec2 shadowUv = shadowPosition.xy * 0.5 + 0.5;
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            lit += texture(shadowMap, vec4(shadowUv + vec2(x, y) * texelSize, float(cascade), shadowPosition.z));
+        }
+    }
+    return lit / 9.0;
+}
 
 void main()
 {
-    vec3 directionToLight = ubo.lightPosition - fragPosWorld;
-    float attenuation = 1.0 / dot(directionToLight, directionToLight);
+    vec3 normal = normalize(fragNormalWorld);
+    float viewDepth = (ubo.view * vec4(fragPosWorld, 1.0)).z;
+
+    // only the lights the compute pass binned into this fragment's cluster
+    uint cluster = clusterIndex(viewDepth);
+    uint lightCount = min(clusterLightCounts[cluster], MAX_LIGHTS_PER_CLUSTER);
+    uint firstLight = cluster * MAX_LIGHTS_PER_CLUSTER;
+
+    vec3 diffuseLight = ubo.ambinetLightColor.xyz * ubo.ambinetLightColor.w;
+    for (uint i = 0; i < lightCount; i++)
+    {
+        PointLight light = lights[clusterLightIndices[firstLight + i]];
+        vec3 directionToLight = light.position.xyz - fragPosWorld;
+        float distanceSquared = dot(directionToLight, directionToLight);
+
+        // inverse square, windowed to reach zero at the light's range
+        float window = clamp(1.0 - pow(distanceSquared / (light.position.w * light.position.w), 2.0), 0.0, 1.0);
+        float attenuation = window * window / max(distanceSquared, 0.0001);
+
+        float cosAngIncidence = max(dot(normal, directionToLight * inversesqrt(distanceSquared)), 0.0);
+        diffuseLight += light.color.xyz * light.color.w * attenuation * cosAngIncidence;
+    }
+
+    if (ubo.directionalLightColor.w > 0.0)
+    {
+        float cosAngIncidence = max(dot(normal, -ubo.directionalLightDirection.xyz), 0.0);
+        if (cosAngIncidence > 0.0)
+        {
+            diffuseLight += ubo.directionalLightColor.xyz * ubo.directionalLightColor.w * cosAngIncidence * directionalShadow(normal, viewDepth);
+        }
+    }
 
-    vec3 lightColor = ubo.lightColor.xyz * ubo.lightColor.w * attenuation;
-    vec3 ambinetLight = ubo.ambinetLightColor.xyz * ubo.ambinetLightColor.w;
-    vec3 diffuseLight = lightColor * max(dot(normalize(fragNormalWorld), normalize(directionToLight)), 0);
-    outColor = vec4((diffuseLight + ambinetLight) * fragColor, 1.0);
+    outColor = vec4(diffuseLight * fragColor, 1.0);
 }
\ No newline at end of file
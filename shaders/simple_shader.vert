@@ -9,12 +9,15 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 
+// the depth pre-pass runs this shader in a second pipeline, the main pass tests EQUAL against it
+invariant gl_Position;
+
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     vec4 ambinetLightColor;
-    vec3 lightPosition;
-    vec4 lightColor;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
 } ubo;
 
 layout(push_constant) uniform Push
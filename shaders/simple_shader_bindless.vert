@@ -0,0 +1,55 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragTextureSlot;
+
+// the depth pre-pass runs this shader in a second pipeline, the main pass tests EQUAL against it
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambinetLightColor;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
+} ubo;
+
+struct ObjectData
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uvec4 material; // x: DecoBindlessHeap sampled image slot, 0xffffffff for none
+};
+
+// DecoBindlessHeap storage buffer array
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffers[];
+
+// slots are the same for the whole draw, no nonuniformEXT needed
+layout(push_constant) uniform Push
+{
+    uint objectBufferSlot;
+    uint objectIndex;
+} push;
+
+void main()
+{
+    ObjectData object = objectBuffers[push.objectBufferSlot].objects[push.objectIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * object.modelMatrix * vec4(position, 1.0);
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = uv;
+    fragTextureSlot = object.material.x;
+}
\ No newline at end of file